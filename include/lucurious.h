@@ -28,6 +28,7 @@
 #define INDEX_IGNORE 1UL << 31
 #define ARR_LEN(var) (sizeof(var) / sizeof(var[0]))
 #define BYTE_ALIGN __attribute__((aligned))
+#define CACHE_LINE_SIZE 64
 #define OFFSET_ALIGN(var, align) while(var%align)var++;
 
 /* Contains linear algebra types used throughout apps */
@@ -30,8 +30,89 @@ bool dlu_otma(dlu_block_type type, dlu_otma_mems ma);
 /* [One Time Buffer Allocater] For sub-allocating blocks of memory from large block */
 bool dlu_otba(dlu_data_type type, void *addr, uint32_t index, uint32_t arr_size);
 
+/**
+* [One Time Slab Allocater] Allocate a struct array exactly like dlu_otba(3) and wrap it
+* in a pool so slots can be handed out and given back at runtime.
+* Supported types: DLU_BUFF_DATA, DLU_DESC_DATA, DLU_TEXT_DATA,
+* DLU_DEVICE_OUTPUT_DATA, DLU_DEVICE_OUTPUT_BUFF_DATA
+* Pools are not thread safe. Reserve room with dlu_otma_mems sp_cnt/spe_cnt.
+*/
+dlu_slab_pool *dlu_otsa(dlu_data_type type, void *addr, uint32_t arr_size);
+
+/* Returns a free slot index, UINT32_MAX if the pool is exhausted */
+uint32_t dlu_slab_get(dlu_slab_pool *pool);
+
+/**
+* Give a slot back to its pool. The slot is reset to the state dlu_otba(3) hands it out in,
+* so any Vulkan/DRM objects it references must be destroyed beforehand.
+*/
+bool dlu_slab_put(dlu_slab_pool *pool, uint32_t index);
+
+/**
+* Sub-allocate bytes from a small block type with the returned address a multiple of align,
+* a power of two (i.e. CACHE_LINE_SIZE or a page). Metadata is kept in front of the padding, so
+* with align >= CACHE_LINE_SIZE it never shares a cache line with the data. When served from a
+* thread arena no metadata is kept at all.
+* Struct arrays from dlu_otba(3) already come back CACHE_LINE_SIZE aligned.
+*/
+void *dlu_alloc_aligned(dlu_block_type type, size_t bytes, size_t align);
+
+/**
+* [One Time Thread Allocater] Carve a per-thread sub-arena of size bytes from a large block.
+* Subsequent small block dlu_alloc(3) calls made by the calling thread are served from it
+* without atomics. Once exhausted allocations fall back to the shared lock-free path.
+* Reserve room with dlu_otma_mems ta_cnt/ta_bytes.
+*/
+bool dlu_otta(dlu_block_type type, size_t bytes);
+
+/**
+* [One Time Frame Allocater] Reserve a frame arena with one slice of bytes per frame in flight.
+* Per-frame scratch (descriptor writes, barrier lists, submit infos) is then a single pointer bump.
+* Reserve room with dlu_otma_mems fa_cnt/fa_bytes.
+*/
+bool dlu_otfa(uint32_t frames, size_t bytes);
+
+/**
+* Start handing out scratch from the slice belonging to frame (taken modulo the frame count).
+* Only call once the GPU is done with the frame's previous use, i.e. after waiting on its fence.
+*/
+void dlu_frame_begin(uint32_t frame);
+
+/**
+* Thread safe scratch allocation from the current frame's slice. Valid until the slice is reused.
+* Returns NULL if no frame arena was reserved, no frame was begun yet or the slice is exhausted.
+*/
+void *dlu_frame_alloc(size_t bytes);
+
 void dlu_release_blocks();
 
+/**
+* Cross process sharing of DLU_LARGE_BLOCK_SHARED, requires DLU_MEM_SHAREABLE in
+* dlu_otma_mems mflags. dlu_send_shared_fd(3) passes the block's memfd over a unix
+* socket (SCM_RIGHTS), the receiver gets it with dlu_recv_shared_fd(3) and maps it
+* with dlu_import_shared(3). After that both processes can call
+* dlu_alloc(DLU_SMALL_BLOCK_SHARED, ...) on the same block.
+* The block is mapped at a different address in each process. Store offsets from
+* dlu_shared_off(3) in shared structs, not pointers, and turn them back into
+* pointers with dlu_shared_ptr(3). An offset of 0 is never valid and maps to NULL.
+*/
+int dlu_shared_fd();
+bool dlu_send_shared_fd(int sock);
+int dlu_recv_shared_fd(int sock);
+bool dlu_import_shared(int fd);
+uint64_t dlu_shared_off(const void *addr);
+void *dlu_shared_ptr(uint64_t off);
+
+/* Query accounting for a given block type or struct array type */
+bool dlu_mm_block_stats(dlu_block_type type, dlu_mm_stats *stats);
+bool dlu_mm_data_stats(dlu_data_type type, dlu_mm_stats *stats);
+
+/**
+* Write every counter to fd as JSON. Set the DLU_MM_STATS environment variable
+* to a file path (or "stderr") to have this done at exit.
+*/
+bool dlu_mm_dump_stats(int fd);
+
 #ifdef DEV_ENV
 void dlu_print_mb(dlu_block_type type);
 #endif
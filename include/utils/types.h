@@ -55,10 +55,47 @@ typedef enum _dlu_data_type {
   DLU_SC_DATA_MEMS = 0x0F01,
   DLU_DESC_DATA_MEMS = 0x0F02,
   DLU_GP_DATA_MEMS = 0x0F03,
+  DLU_CMD_DATA_MEMS = 0x0F04, /* Command buffers of a pool that isn't tied to a swapchain, i.e. per thread pools */
   DLU_DEVICE_OUTPUT_DATA = 0xF001,
   DLU_DEVICE_OUTPUT_BUFF_DATA = 0xF002
 } dlu_data_type;
 
+/**
+* Flags for how dlu_otma(3) maps large blocks, OR'd together into dlu_otma_mems mflags
+* DLU_MEM_HUGE_PAGES: Back the block with huge pages (MAP_HUGETLB), falls back to transparent huge pages
+* DLU_MEM_PREFAULT: Populate every page up front (MAP_POPULATE) so first touch doesn't fault
+* DLU_MEM_LOCK: mlock(2) the block so it can't be swapped out
+* DLU_MEM_SHAREABLE: Back DLU_LARGE_BLOCK_SHARED with a memfd that other processes can map
+*/
+typedef enum _dlu_mem_flags {
+  DLU_MEM_DEFAULT = 0x0000,
+  DLU_MEM_HUGE_PAGES = 0x0001,
+  DLU_MEM_PREFAULT = 0x0002,
+  DLU_MEM_LOCK = 0x0004,
+  DLU_MEM_SHAREABLE = 0x0008
+} dlu_mem_flags;
+
+/**
+* Arena accounting returned by dlu_mm_block_stats(3) and dlu_mm_data_stats(3)
+* requested | Total bytes asked for
+* overhead  | Total metadata bytes (BLOCK_SIZE per block/sub-block)
+* in_use    | Bytes (requested + overhead) currently live, reset by dlu_release_blocks(3)
+* peak      | High-water mark of in_use
+* allocs    | Amount of successful allocations
+* failures  | Amount of failed allocations
+*/
+typedef struct _dlu_mm_stats {
+  uint64_t requested;
+  uint64_t overhead;
+  uint64_t in_use;
+  uint64_t peak;
+  uint64_t allocs;
+  uint64_t failures;
+} dlu_mm_stats;
+
+/* Opaque, fixed size pool of reusable struct array slots */
+typedef struct _dlu_slab_pool dlu_slab_pool;
+
 typedef struct _dlu_otma_mems {
   uint32_t inta_cnt;    /* int array count */
   uint32_t cha_cnt;     /* char array count */
@@ -73,6 +110,7 @@ typedef struct _dlu_otma_mems {
   uint32_t scd_cnt;    /* swap chain data count */
   uint32_t gpd_cnt;    /* graphics pipeline data count */
   uint32_t cmdd_cnt; /* command data count */
+  uint32_t cb_cnt;     /* Command buffers across every DLU_CMD_DATA_MEMS pool */
   uint32_t bd_cnt;      /* buffer data count */
   uint32_t dd_cnt;      /* descriptor data count */
   uint32_t td_cnt;       /* texture data count */
@@ -81,6 +119,14 @@ typedef struct _dlu_otma_mems {
   uint32_t drmc_cnt;  /* dlu_disp_core struct count */
   uint32_t dod_cnt;    /* Device output_data struct count */
   uint32_t dob_cnt;    /* Device Output Buffer Count */
+  uint32_t rg_cnt;      /* Render graph count, see dlu_create_render_graph(3) */
+  uint32_t sp_cnt;      /* Slab pool count, see dlu_otsa(3) */
+  uint32_t spe_cnt;     /* Total amount of slots across every slab pool */
+  uint32_t fa_cnt;      /* Frame arena slice count (frames in flight), see dlu_otfa(3) */
+  size_t fa_bytes;      /* Bytes of scratch per frame */
+  uint32_t ta_cnt;      /* Thread arena count, see dlu_otta(3) */
+  size_t ta_bytes;      /* Bytes reserved per thread arena */
+  uint32_t mflags;      /* dlu_mem_flags bitmask */
 } dlu_otma_mems;
 
 #ifdef INAPI_CALLS
@@ -104,6 +150,8 @@ typedef enum _dlu_err_msg_type {
   DLU_VKCOMP_CMD_POOL = 0x010C,
   DLU_VKCOMP_CMD_BUFFS = 0x010D,
   DLU_VKCOMP_DEVICE_NOT_ASSOC = 0x010E,
+  DLU_VKCOMP_UPLOADER = 0x010F,
+  DLU_VKCOMP_RENDER_GRAPH = 0x0110,
   DLU_BUFF_NOT_ALLOC = 0x0FFC,
   DLU_OP_NOT_PERMITED = 0x0FFD,
   DLU_ALLOC_FAILED = 0x0FFE,
@@ -34,6 +34,12 @@
 #include "utils.h"
 #include "vlayer.h"
 #include "vk_calls.h"
+#include "memory.h"
+#include "upload.h"
+#include "graph.h"
+#include "frame.h"
+#include "cache.h"
+#include "pipeline.h"
 
 #ifdef INAPI_CALLS
 #include "device.h"
@@ -54,6 +54,21 @@ void dlu_bind_vertex_buff_to_cmd_buff(
   const VkDeviceSize *offsets
 );
 
+/**
+* Binds bindingCount buffers starting at firstBinding in one call, i.e. per vertex mesh data at
+* binding 0 and a per instance stream (dlu_create_instance_stream(3)) at binding 1.
+* pBuffs: Indices into app->buff_data, offsets: One offset per buffer
+*/
+void dlu_bind_vertex_buffs_to_cmd_buff(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t firstBinding,
+  uint32_t bindingCount,
+  const uint32_t *pBuffs,
+  const VkDeviceSize *offsets
+);
+
 void dlu_bind_index_buff_to_cmd_buff(
   vkcomp *app,
   uint32_t cur_pool,
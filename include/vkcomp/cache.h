@@ -0,0 +1,46 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#ifndef DLU_VKCOMP_CACHE_H
+#define DLU_VKCOMP_CACHE_H
+
+/**
+* Create app->gp_cache from the pipeline cache saved at path by dlu_save_pipeline_cache(3).
+* The file is keyed by the vendorID, deviceID, driverVersion and pipelineCacheUUID of the
+* physical device behind cur_ld, a file written by another device or driver is ignored.
+* A missing, stale or truncated file isn't an error, an empty cache is created instead.
+* If app->gp_cache already exists the file's pipelines are merged into it.
+* loaded: Set to whether data from path made it into the cache, may be NULL
+*/
+VkResult dlu_load_pipeline_cache(vkcomp *app, uint32_t cur_ld, const char *path, bool *loaded);
+
+/**
+* Write app->gp_cache out to path. Pipelines another process saved there since it was
+* loaded are merged in first with vkMergePipelineCaches. The file is written to a temporary
+* file next to path then renamed over it, readers never see a partially written cache.
+*/
+VkResult dlu_save_pipeline_cache(vkcomp *app, const char *path);
+
+#endif
@@ -123,6 +123,43 @@ VkResult dlu_create_depth_buff(
   VkMemoryPropertyFlags requirements_mask
 );
 
+/**
+* Multisampled color attachment, one is shared by every swapchain image.
+* Make it the render pass color attachment and the swapchain image its resolve
+* attachment (VkSubpassDescription pResolveAttachments) so the resolve happens in the
+* render pass. With VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT and a DONT_CARE storeOp it's
+* backed by lazily allocated memory when available, so it never costs memory on tiled GPUs.
+* img_info->samples must be more than VK_SAMPLE_COUNT_1_BIT
+* The same goes for a depth buffer created with the transient usage bit.
+*/
+VkResult dlu_create_msaa_buff(
+  vkcomp *app,
+  uint32_t cur_scd,
+  VkImageCreateInfo *img_info,
+  VkImageViewCreateInfo *ivi,
+  VkMemoryPropertyFlags requirements_mask
+);
+
+/* Highest sample count usable for both color and depth attachments */
+VkSampleCountFlagBits dlu_get_max_sample_count(vkcomp *app, uint32_t cur_pd);
+
+/**
+* Function creates a host visible vertex buffer holding frameCount slices of maxInstances
+* per-instance attributes (i.e. transforms) of instanceSize bytes. Each frame in flight writes
+* its own slice through dlu_vk_instance_stream_frame(3) while the GPU reads the others, so
+* thousands of copies of a mesh update every frame without stalls and draw in one call.
+* Describe it with a VK_VERTEX_INPUT_RATE_INSTANCE binding, bind it next to the mesh through
+* dlu_bind_vertex_buffs_to_cmd_buff(3).
+*/
+VkResult dlu_create_instance_stream(
+  vkcomp *app,
+  uint32_t cur_ld,
+  uint32_t cur_bd,
+  VkDeviceSize instanceSize,
+  uint32_t maxInstances,
+  uint32_t frameCount
+);
+
 /**
 * Function creates buffers like a uniform buffer so that shaders can access
 * in a read-only fashion constant parameter data. Function also
@@ -181,6 +218,20 @@ VkResult dlu_create_cmd_buffs(
   VkCommandBufferLevel level
 );
 
+/**
+* Per frame recording, one of these exists for every frame in flight. dlu_vk_create_frames(3)
+* creates them, call this directly only when recording with dlu_exec_begin_frame(3) by hand.
+* Function creates a VK_COMMAND_POOL_CREATE_TRANSIENT_BIT command pool holding a single primary
+* command buffer. Memory for the buffer must be allotted with dlu_otba(DLU_CMD_DATA_MEMS, app, cur_pool, 1).
+* The pool is reset as a whole by dlu_exec_begin_frame(3), buffers are never freed individually.
+*/
+VkResult dlu_create_frame_cmd_pool(
+  vkcomp *app,
+  uint32_t cur_ld,
+  uint32_t cur_pool,
+  uint32_t queueFamilyIndex
+);
+
 /**
 * Can find in Vulkan SDK samples/API-Samples/10-init_render_pass
 * A semaphore (or fence) is required in order to acquire a
@@ -190,6 +241,21 @@ VkResult dlu_create_cmd_buffs(
 * creates semaphores
 */
 VkResult dlu_create_syncs(vkcomp *app, uint32_t cur_scd);
+
+/**
+* Create a timeline semaphore for each queue retrieved with dlu_create_device_queue(3).
+* One counter per queue takes the place of a fence per frame, submissions signal increasing
+* values and the CPU (or another queue) waits on whichever value it needs.
+* Requires VK_KHR_timeline_semaphore in dlu_create_logical_device(3) ppEnabledExtensionNames
+*/
+VkResult dlu_create_timelines(vkcomp *app, uint32_t cur_ld);
+
+/**
+* Create the binary semaphores a swap chain recycles for acquiring and presenting
+* images, used by dlu_acquire_sc_image(3) in place of app->sc_data[cur_scd].syncs
+*/
+VkResult dlu_create_sem_pool(vkcomp *app, uint32_t cur_scd);
+
 VkShaderModule dlu_create_shader_module(vkcomp *app, uint32_t cur_ld, char *code, size_t code_size);
 
 VkResult dlu_create_render_pass(
@@ -204,6 +270,23 @@ VkResult dlu_create_render_pass(
   VkRenderPassCreateFlagBits flags
 );
 
+/**
+* Function creates a compute pipeline in app->gp_data[cur_gpd].graphics_pipelines[cur_pl]
+* using the layout made by dlu_create_pipeline_layout(3). Bind it with dlu_bind_pipeline(3)
+* and VK_PIPELINE_BIND_POINT_COMPUTE, then record work with dlu_exec_cmd_dispatch(3).
+* The pipeline the slot held before is released.
+*/
+VkResult dlu_create_compute_pipeline(
+  vkcomp *app,
+  uint32_t cur_gpd,
+  uint32_t cur_pl,
+  const VkPipelineShaderStageCreateInfo *pStage
+);
+
+/**
+* Function creates a graphics pipeline in app->gp_data[cur_gpd].graphics_pipelines[0], one of
+* identical state is shared if it exists. The pipeline the slot held before is released.
+*/
 VkResult dlu_create_graphics_pipelines(
   vkcomp *app,
   uint32_t cur_gpd,
@@ -223,6 +306,24 @@ VkResult dlu_create_graphics_pipelines(
   uint32_t basePipelineIndex
 );
 
+/**
+* Create createInfoCount graphics pipelines in app->gp_data[cur_gpd].graphics_pipelines[cur_pl...]
+* on threadCount threads, 0 for one per online CPU. The calling thread is one of them.
+* A create info whose layout or renderPass is VK_NULL_HANDLE uses the ones of cur_gpd.
+* Every thread compiles through app->gp_cache, pipeline caches are internally synchronized.
+* States already created, or repeated within the batch, are shared instead of compiled again.
+* Pipelines the range held before are released, as with dlu_vk_destroy(3) DLU_DESTROY_PIPELINE.
+* Returns the first failure, the whole range is then left VK_NULL_HANDLE and nothing it created is kept.
+*/
+VkResult dlu_create_graphics_pipeline_batch(
+  vkcomp *app,
+  uint32_t cur_gpd,
+  uint32_t cur_pl,
+  uint32_t createInfoCount,
+  const VkGraphicsPipelineCreateInfo *pCreateInfos,
+  uint32_t threadCount
+);
+
 VkResult dlu_create_pipeline_cache(vkcomp *app, uint32_t cur_ld, size_t initialDataSize, const void *pInitialData);
 
 /* Informs the driver what types of resources need to be accessed at a given pipeline */
@@ -281,6 +382,24 @@ VkResult dlu_create_texture_image(
   VkMemoryPropertyFlags requirements_mask
 );
 
+/**
+* Attachments whose lifetimes never overlap (render targets of passes that don't run at
+* the same time, intermediates consumed before the next one is written) can share memory.
+* Creates imageCount images and views at text_data[cur_tex] onward, all bound to the start of
+* one allocation sized for the largest. Contents are undefined whenever a different alias was
+* written last, transition from VK_IMAGE_LAYOUT_UNDEFINED on first use. Transient images prefer
+* lazily allocated memory. Only text_data[cur_tex] owns the memory, give it back with dlu_vk_free_mem(3)
+*/
+VkResult dlu_create_aliased_images(
+  vkcomp *app,
+  uint32_t cur_ld,
+  uint32_t cur_tex,
+  uint32_t imageCount,
+  VkImageCreateInfo *img_infos,
+  VkImageViewCreateInfo *ivis,
+  VkMemoryPropertyFlags requirements_mask
+);
+
 /**
 * Concept of Sampling: https://www.tutorialspoint.com/dip/concept_of_sampling.htm
 * Generally textures are accessed through samplers.
@@ -94,4 +94,48 @@ VkResult dlu_queue_present_queue(
   VkResult *pResults
 );
 
+/**
+* Acquire a swap chain image signaling a semaphore taken from app->sc_data[cur_scd].sem_pool.
+* The next dlu_queue_graphics_timeline(3) waits on it. Returns VK_NOT_READY if every
+* pooled semaphore is still in use, see dlu_create_sem_pool(3)
+* timeout: nanoseconds to wait for an image, UINT64_MAX to wait forever
+*/
+VkResult dlu_acquire_sc_image(vkcomp *app, uint32_t cur_scd, uint64_t timeout, uint32_t *cur_img);
+
+/**
+* Submit command buffers rendering into cur_img to the graphics queue. Waits on the acquire
+* semaphore at waitDstStageMask, signals a present semaphore and the next value of the
+* graphics timeline. value receives it, wait on it with dlu_vk_wait_timeline(3) rather than a fence.
+*/
+VkResult dlu_queue_graphics_timeline(
+  vkcomp *app,
+  uint32_t cur_scd,
+  uint32_t cur_img,
+  uint32_t commandBufferCount,
+  const VkCommandBuffer *pCommandBuffers,
+  VkPipelineStageFlags waitDstStageMask,
+  uint64_t *value
+);
+
+/**
+* Submit command buffers to a queue signaling the next value of its timeline.
+* Before running they wait for each pWaitQueues timeline to reach pWaitValues.
+* Handy for graphics waiting on uploads (or compute) without a fence round trip.
+*/
+VkResult dlu_queue_timeline_submit(
+  vkcomp *app,
+  uint32_t cur_ld,
+  dlu_queue_type queue,
+  uint32_t commandBufferCount,
+  const VkCommandBuffer *pCommandBuffers,
+  uint32_t waitCount,
+  const dlu_queue_type *pWaitQueues,
+  const uint64_t *pWaitValues,
+  const VkPipelineStageFlags *pWaitDstStageMask,
+  uint64_t *value
+);
+
+/* Present cur_img once the last dlu_queue_graphics_timeline(3) submission is done with it */
+VkResult dlu_queue_present_timeline(vkcomp *app, uint32_t cur_scd, uint32_t cur_img);
+
 #endif
@@ -25,10 +25,22 @@
 #ifndef DLU_VKCOMP_EXEC_H
 #define DLU_VKCOMP_EXEC_H
  
-/* Function creates VkCommandBuffer */
+/**
+* Function begins a one time VkCommandBuffer, for layout transitions, readbacks, small copies.
+* cur_pool: Selects the logical device. Buffers come from a free list kept per logical device
+* (app->ld_data[ldi].one_shots), backed by a graphics queue family pool owned by the library.
+* A buffer and its fence are reused once the fence signals, nothing is allocated after warm up.
+* Waits on submitted buffers if all DLU_VK_ONE_SHOT_CNT are in flight.
+*/
 VkCommandBuffer dlu_exec_begin_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool);
 
-/* Function submits and closes one time VkCommandBuffer to the graphics queue */
+/**
+* Function ends and submits a one time VkCommandBuffer to the graphics queue without waiting.
+* The buffer returns to the free list on its own when the GPU is done with it.
+*/
+VkResult dlu_exec_submit_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool, VkCommandBuffer *cmd_buff);
+
+/* Function submits a one time VkCommandBuffer to the graphics queue and waits on its fence */
 VkResult dlu_exec_end_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool, VkCommandBuffer *cmd_buff);
 
 /**
@@ -46,6 +58,19 @@ void dlu_exec_copy_buffer(
   VkCommandBuffer cmd_buff
 );
 
+/**
+* Fills size bytes (a multiple of 4) of cur_bd with the 4 byte word data.
+* Used to clear GPU written counters, i.e. the draw count of a culling pass.
+*/
+void dlu_exec_fill_buffer(
+  vkcomp *app,
+  uint32_t cur_bd,
+  VkDeviceSize dstOffset,
+  VkDeviceSize size,
+  uint32_t data,
+  VkCommandBuffer cmd_buff
+);
+
 /**
 * cur_pool: Function uses one time command buffer allocate/submit
 * cur_bd: must be a valid VkBuffer that contains your image pixels
@@ -108,6 +133,71 @@ VkResult dlu_exec_begin_cmd_buffs(
 
 VkResult dlu_exec_stop_cmd_buffs(vkcomp *app, uint32_t cur_pool, uint32_t cur_scd); 
 
+/**
+* Parallel recording, one command pool per recording thread.
+* VkCommandPool isn't thread safe so every thread gets its own cur_pool created with
+* dlu_create_cmd_pool(3), buffers allotted with dlu_otba(DLU_CMD_DATA_MEMS, app, cur_pool, sic)
+* and dlu_create_cmd_buffs(3) using VK_COMMAND_BUFFER_LEVEL_SECONDARY.
+*
+* Function begins the secondary command buffer of every swap chain image in cur_pool.
+* Each buffer inherits the cur_gpd render pass, the given subpass and the image's framebuffer.
+* Record draws with dlu_exec_cmd_draw(3) and friends, then dlu_exec_stop_cmd_buffs(3).
+*/
+VkResult dlu_exec_begin_secondary_cmd_buffs(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_scd,
+  uint32_t cur_gpd,
+  uint32_t subpass,
+  VkCommandBufferUsageFlags flags
+);
+
+/**
+* Function executes the secondary command buffers of every pool in pPools from the primary
+* command buffers in cur_pool. Call it on one thread after the recording threads joined, inside
+* a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+* The handle list is scratch from the frame begun with dlu_frame_begin(3), stack space otherwise.
+*/
+void dlu_exec_secondary_cmd_buffs(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_scd,
+  uint32_t poolCount,
+  const uint32_t *pPools
+);
+
+/**
+* Per frame recording, an alternative to recording every swap chain image's command buffer once.
+* cur_pool: A pool made with dlu_create_frame_cmd_pool(3)
+*
+* Function resets the transient pool with vkResetCommandPool and begins the pool's primary command
+* buffer for one time submit, end it with dlu_exec_stop_frame(3). Only the current frame gets recorded,
+* so the contents may change from frame to frame. Draw with cur_buff = 0. The GPU must be done with
+* the pool, dlu_vk_begin_frame(3) builds on this and waits for the frame slot before resetting it.
+* Returns the command buffer being recorded, VK_NULL_HANDLE on failure.
+*/
+VkCommandBuffer dlu_exec_begin_frame(vkcomp *app, uint32_t cur_pool);
+
+/* cur_img: Swap chain image acquired for this frame, selects the framebuffer */
+void dlu_exec_begin_frame_render_pass(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_scd,
+  uint32_t cur_gpd,
+  uint32_t cur_img,
+  uint32_t x,
+  uint32_t y,
+  uint32_t width,
+  uint32_t height,
+  uint32_t clearValueCount,
+  const VkClearValue *pClearValues,
+  VkSubpassContents contents
+);
+
+void dlu_exec_stop_frame_render_pass(vkcomp *app, uint32_t cur_pool);
+
+VkResult dlu_exec_stop_frame(vkcomp *app, uint32_t cur_pool);
+
 void dlu_exec_cmd_draw(
   vkcomp *app,
   uint32_t cur_pool,
@@ -129,6 +219,48 @@ void dlu_exec_cmd_draw_indexed(
   uint32_t firstInstance
 );
 
+/**
+* GPU driven drawing. Draw parameters are read from cur_bd, a VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+* buffer of VkDrawIndexedIndirectCommand, usually written by a compute pass (see dlu_exec_cmd_dispatch(3)).
+* The CPU cost of recording is the same for one draw or a hundred thousand.
+*/
+void dlu_exec_cmd_draw_indexed_indirect(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t cur_bd,
+  VkDeviceSize offset,
+  uint32_t drawCount,
+  uint32_t stride
+);
+
+/**
+* Same as above, but the draw count is read from count_bd at countBufferOffset (clamped to maxDrawCount).
+* A culling pass writes the surviving draws and their count, so no CPU readback is needed.
+* Requires VK_KHR_draw_indirect_count be passed to dlu_create_logical_device(3).
+*/
+void dlu_exec_cmd_draw_indexed_indirect_count(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t cur_bd,
+  VkDeviceSize offset,
+  uint32_t count_bd,
+  VkDeviceSize countBufferOffset,
+  uint32_t maxDrawCount,
+  uint32_t stride
+);
+
+/* Records a compute pipeline dispatch, see dlu_create_compute_pipeline(3) */
+void dlu_exec_cmd_dispatch(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t groupCountX,
+  uint32_t groupCountY,
+  uint32_t groupCountZ
+);
+
 void dlu_exec_cmd_set_viewport(
   vkcomp *app,
   VkViewport *viewport,
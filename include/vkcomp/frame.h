@@ -0,0 +1,64 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#ifndef DLU_VKCOMP_FRAME_H
+#define DLU_VKCOMP_FRAME_H
+
+/**
+* The frame path. Replaces recording every swap chain image's command buffer once, frames are
+* recorded with dlu_exec_begin_frame(3) and dlu_exec_stop_frame(3) on the slots' pools.
+*
+* Create the per-frame command pools of a swap chain and set how many frames may be in flight.
+* Slot i owns app->cmd_data[cur_pool+i], made with dlu_create_frame_cmd_pool(3), for every i
+* below DLU_VK_MAX_FRAMES. Each needs dlu_otba(DLU_CMD_DATA_MEMS, app, cur_pool+i, 1).
+* Frames are paced with the graphics timeline, the timelines and semaphore pool are created if need be.
+* Without a swap chain (app->sc_data[cur_scd].ldi set by hand) frames are submitted but never presented.
+* Requires VK_KHR_timeline_semaphore, see dlu_create_timelines(3)
+*/
+VkResult dlu_vk_create_frames(vkcomp *app, uint32_t cur_scd, uint32_t cur_pool, uint32_t frameCount);
+
+/**
+* Change the amount of frames in flight, 1 to DLU_VK_MAX_FRAMES, takes effect on the next
+* dlu_vk_begin_frame(3). One frame has the lowest latency, the CPU waits for the GPU every frame.
+* More frames let the CPU record while the GPU renders, trading latency for throughput.
+*/
+VkResult dlu_vk_set_frames_in_flight(vkcomp *app, uint32_t cur_scd, uint32_t frameCount);
+
+/**
+* Wait until a frame slot is free, acquire the next swap chain image into cur_img, then reset
+* the slot's pool and begin its command buffer. cur_pool receives the slot's cmd_data index,
+* record the frame with the dlu_exec_* and dlu_bind_* functions passing it and cur_buff 0.
+* Returns the command buffer, VK_NULL_HANDLE on failure or if timeout (in nanoseconds) expired.
+*/
+VkCommandBuffer dlu_vk_begin_frame(vkcomp *app, uint32_t cur_scd, uint64_t timeout, uint32_t *cur_pool, uint32_t *cur_img);
+
+/**
+* End the frame's command buffer, submit it to the graphics queue waiting on the acquired
+* image at waitDstStageMask, then present. value receives the graphics timeline value the
+* frame signals once done. Returns the result of the present (i.e. VK_SUBOPTIMAL_KHR).
+*/
+VkResult dlu_vk_end_frame(vkcomp *app, uint32_t cur_scd, VkPipelineStageFlags waitDstStageMask, uint64_t *value);
+
+#endif
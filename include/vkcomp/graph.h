@@ -0,0 +1,113 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#ifndef DLU_VKCOMP_GRAPH_H
+#define DLU_VKCOMP_GRAPH_H
+
+/**
+* Frame graph layered over dlu_exec_pipeline_barrier(3). Passes declare the images and
+* buffers they read and write, dlu_graph_compile(3) then culls passes nothing depends on,
+* derives the barriers between passes and aliases transient resources. Build a graph once,
+* compile it once, then dlu_graph_execute(3) it every frame.
+* Must reserve memory with dlu_otma_mems.rg_cnt
+*/
+dlu_render_graph *dlu_create_render_graph(vkcomp *app, uint32_t cur_ld);
+
+/**
+* Import an image the graph doesn't own (texture, swap chain image, ...). Imported resources
+* are the graph's outputs, passes writing to them are never culled.
+* initialLayout: Layout the image is in before the first pass
+* finalLayout: Layout to leave it in after the last pass, VK_IMAGE_LAYOUT_UNDEFINED to leave it as is
+* Returns the resource index, UINT32_MAX on failure
+*/
+uint32_t dlu_graph_import_image(
+  dlu_render_graph *graph,
+  VkImage image,
+  VkImageSubresourceRange range,
+  VkImageLayout initialLayout,
+  VkImageLayout finalLayout
+);
+
+/* Import the buffer at cur_bd, returns the resource index, UINT32_MAX on failure */
+uint32_t dlu_graph_import_buff(dlu_render_graph *graph, uint32_t cur_bd);
+
+/**
+* Declare a transient image, it's created at app->text_data[cur_tex] by dlu_graph_compile(3)
+* only if a live pass uses it. The contents don't survive past its last use.
+* ivi->image is filled in by the graph. Returns the resource index, UINT32_MAX on failure
+*/
+uint32_t dlu_graph_create_image(
+  dlu_render_graph *graph,
+  uint32_t cur_tex,
+  const VkImageCreateInfo *img_info,
+  const VkImageViewCreateInfo *ivi
+);
+
+/* Declare a transient buffer created at app->buff_data[cur_bd], see dlu_graph_create_image(3) */
+uint32_t dlu_graph_create_buff(dlu_render_graph *graph, uint32_t cur_bd, VkDeviceSize size, VkBufferUsageFlags usage);
+
+/**
+* Append a pass, passes execute in the order they're added.
+* record: Called with the graph's command buffer once the pass's barriers are recorded
+* Returns the pass index, UINT32_MAX on failure
+*/
+uint32_t dlu_graph_add_pass(dlu_render_graph *graph, const char *name, dlu_graph_record_func record, void *data);
+
+/**
+* Declare that pass accesses res. Whether it's a read or a write is taken from access.
+* layout is the layout the pass expects res in, ignored for buffers.
+* Declaring the same resource again in a pass merges the stages and access masks.
+*/
+bool dlu_graph_use(
+  dlu_render_graph *graph,
+  uint32_t pass,
+  uint32_t res,
+  VkPipelineStageFlags stage,
+  VkAccessFlags access,
+  VkImageLayout layout
+);
+
+/**
+* Cull unused passes, create and alias transient resources, then derive the barriers.
+* Barriers assume the graph runs every frame on one queue, the first use of a resource waits
+* on its last use in the previous frame.
+*/
+VkResult dlu_graph_compile(vkcomp *app, dlu_render_graph *graph);
+
+/* Record every live pass with its barriers into cmd_buff */
+void dlu_graph_execute(vkcomp *app, dlu_render_graph *graph, VkCommandBuffer cmd_buff);
+
+/* The VkImage, VkImageView or VkBuffer behind a resource, VK_NULL_HANDLE if it was culled */
+VkImage dlu_graph_image(vkcomp *app, dlu_render_graph *graph, uint32_t res);
+VkImageView dlu_graph_image_view(vkcomp *app, dlu_render_graph *graph, uint32_t res);
+VkBuffer dlu_graph_buff(vkcomp *app, dlu_render_graph *graph, uint32_t res);
+
+/**
+* Write the compiled graph to fd as JSON. Passes (culled or not) with their barriers,
+* resource lifetimes with their memory slots and the bytes saved by aliasing.
+*/
+bool dlu_graph_dump(dlu_render_graph *graph, int fd);
+
+#endif
@@ -0,0 +1,93 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#ifndef DLU_VKCOMP_MEMORY_H
+#define DLU_VKCOMP_MEMORY_H
+
+/**
+* Give the device memory of a buffer or texture back to the sub-allocator. The only way
+* to release it, the VkDeviceMemory is shared with other resources.
+*/
+void dlu_vk_free_mem(dlu_mem_map_type type, vkcomp *app, uint32_t cur_idx);
+
+/**
+* Buffers in host visible memory stay mapped for their whole lifetime, app->buff_data[cur_bd].mapped.
+* Writes through that pointer are plain stores, non-coherent memory must be flushed after
+* writing and invalidated before reading GPU writes. dlu_vk_write_buff(3) copies and flushes.
+* offset is relative to the buffer.
+*/
+VkResult dlu_vk_write_buff(vkcomp *app, uint32_t cur_bd, VkDeviceSize offset, const void *data, VkDeviceSize size);
+VkResult dlu_vk_flush_buff(vkcomp *app, uint32_t cur_bd, VkDeviceSize offset, VkDeviceSize size);
+VkResult dlu_vk_invalidate_buff(vkcomp *app, uint32_t cur_bd, VkDeviceSize offset, VkDeviceSize size);
+
+/**
+* Function returns the mapped slice of instance stream cur_bd for frame in flight cur_frame
+* and its offset into the buffer, pass the offset when binding. Only write a slice once the GPU
+* is done with the frame slot (dlu_vk_begin_frame(3) waits for it, cur_frame is then
+* app->sc_data[cur_scd].frames.cur), then dlu_vk_flush_buff(3) what was written.
+*/
+void *dlu_vk_instance_stream_frame(vkcomp *app, uint32_t cur_bd, uint32_t cur_frame, VkDeviceSize *offset);
+
+/* Per heap device memory sub-allocator statistics, for a given logical device */
+bool dlu_vk_get_mem_stats(vkcomp *app, uint32_t cur_ld, uint32_t heap, dlu_vk_mem_stats *stats);
+
+/**
+* Fills budgets[VK_MAX_MEMORY_HEAPS] with each heap's usage and budget, returns the heap count.
+* Exact when VK_KHR_get_physical_device_properties2 was enabled on the instance and
+* VK_EXT_memory_budget on the logical device, otherwise estimated from the sub-allocator.
+* Check before large allocations to evict resources before vkAllocateMemory fails.
+*/
+uint32_t dlu_vk_get_mem_budget(vkcomp *app, uint32_t cur_ld, dlu_vk_heap_budget *budgets);
+
+#ifdef INAPI_CALLS
+/**
+* Sub-allocate device memory for a resource from a shared VkDeviceMemory block of a
+* suitable memory type. Set optimal for VK_IMAGE_TILING_OPTIMAL images. The resource
+* must be bound at *offset in *mem and *size handed back to dlu_vk_mem_free(3).
+* If mapped isn't NULL it receives the persistent mapping of the resource, NULL if not host visible.
+*/
+VkResult dlu_vk_mem_alloc(
+  vkcomp *app,
+  uint32_t cur_ld,
+  VkMemoryRequirements *mem_reqs,
+  VkMemoryPropertyFlags requirements_mask,
+  bool optimal,
+  VkDeviceMemory *mem,
+  VkDeviceSize *offset,
+  VkDeviceSize *size,
+  void **mapped
+);
+
+/* Flush (or invalidate) a range of mem, a no-op for coherent memory */
+VkResult dlu_vk_mem_flush(vkcomp *app, uint32_t cur_ld, VkDeviceMemory mem, VkDeviceSize offset, VkDeviceSize size, bool invalidate);
+
+/* Give a sub-allocation back, a block is freed once nothing lives in it */
+void dlu_vk_mem_free(vkcomp *app, uint32_t cur_ld, VkDeviceMemory mem, VkDeviceSize offset, VkDeviceSize size);
+
+/* Free every block of a logical device, called right before the VkDevice is destroyed */
+void dlu_vk_mem_destroy(vkcomp *app, uint32_t cur_ld);
+#endif
+
+#endif
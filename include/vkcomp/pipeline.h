@@ -0,0 +1,99 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#ifndef DLU_VKCOMP_PIPELINE_H
+#define DLU_VKCOMP_PIPELINE_H
+
+/**
+* Content hash of everything that makes up a graphics pipeline on cur_ld. Shader modules,
+* the render pass and the pipeline layout are hashed by what they were created from, so two
+* compatible render passes give the same hash. Viewports, scissors and blend constants
+* are left out when they're dynamic state. Returns 0 if the state can't be hashed, i.e. it
+* has a pNext chain or refers to an object not created through lucurious.
+*/
+uint64_t dlu_hash_graphics_pipeline(vkcomp *app, uint32_t cur_ld, const VkGraphicsPipelineCreateInfo *info);
+
+/**
+* Amount of graphics_pipelines slots sharing pipeline, dlu_create_graphics_pipelines(3)
+* and dlu_create_graphics_pipeline_batch(3) hand out existing pipelines for duplicate state.
+* Returns 0 for pipelines that aren't shared.
+*/
+uint32_t dlu_graphics_pipeline_refs(vkcomp *app, VkPipeline pipeline);
+
+#ifdef INAPI_CALLS
+/* Remember the content hash of a shader module, render pass or pipeline layout */
+void set_obj_hash(vkcomp *app, uint64_t handle, uint64_t hash);
+void forget_obj_hash(vkcomp *app, uint64_t handle);
+
+uint64_t hash_render_pass_info(const VkRenderPassCreateInfo *info);
+
+uint64_t hash_pipeline_layout_info(
+  uint32_t layout_count,
+  const VkDescriptorSetLayoutCreateInfo *layout_infos,
+  uint32_t pushConstantRangeCount,
+  const VkPushConstantRange *pPushConstantRanges,
+  VkPipelineLayoutCreateFlags flags
+);
+
+/**
+* Canonical bytes of everything dlu_hash_graphics_pipeline(3) hashes. A shared pipeline keeps
+* them, a hash hit only counts if they compare equal.
+* hash  | Same value dlu_hash_graphics_pipeline(3) returns, 0 if the state can't be shared
+* size  | Bytes of state in bytes
+* cap   | Bytes allocated for bytes
+* bytes | The state, freed with free_pipe_key(3) unless add_shared_pipeline(3) took it
+* keep  | Record bytes, not only the hash
+* oom   | bytes couldn't grow, the state is treated as unshareable
+*/
+typedef struct _dlu_pipe_key {
+  uint64_t hash;
+  size_t size;
+  size_t cap;
+  unsigned char *bytes;
+  bool keep;
+  bool oom;
+} dlu_pipe_key;
+
+/* Returns the key's hash, a key that can't be shared holds no bytes */
+uint64_t get_pipe_key(vkcomp *app, uint32_t cur_ld, const VkGraphicsPipelineCreateInfo *info, dlu_pipe_key *key);
+void free_pipe_key(dlu_pipe_key *key);
+
+/* Both keys describe the same shareable state */
+bool same_pipe_key(const dlu_pipe_key *a, const dlu_pipe_key *b);
+
+/* Returns the shared pipeline for key, taking a reference, VK_NULL_HANDLE if there is none */
+VkPipeline get_shared_pipeline(vkcomp *app, uint32_t cur_ld, const dlu_pipe_key *key);
+
+/**
+* Share a newly created pipeline, it holds one reference and takes over the key's bytes.
+* No-op for hash 0, logs a warning if the map is full.
+*/
+void add_shared_pipeline(vkcomp *app, uint32_t cur_ld, dlu_pipe_key *key, VkPipeline pipeline);
+
+/* Drop a reference, pipelines that aren't shared are destroyed right away */
+void release_pipeline(vkcomp *app, uint32_t cur_ld, VkPipeline pipeline);
+#endif
+
+#endif
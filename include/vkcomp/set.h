@@ -512,6 +512,37 @@ static inline VkPipelineDynamicStateCreateInfo dlu_set_dynamic_state_info(
   };
 }
 
+/**
+* For dlu_create_graphics_pipeline_batch(3), leave layout and renderPass
+* VK_NULL_HANDLE to use the ones of the app->gp_data the batch is created in
+*/
+static inline VkGraphicsPipelineCreateInfo dlu_set_graphics_pipeline_info(
+  uint32_t stageCount,
+  const VkPipelineShaderStageCreateInfo *pStages,
+  const VkPipelineVertexInputStateCreateInfo *pVertexInputState,
+  const VkPipelineInputAssemblyStateCreateInfo *pInputAssemblyState,
+  const VkPipelineTessellationStateCreateInfo *pTessellationState,
+  const VkPipelineViewportStateCreateInfo *pViewportState,
+  const VkPipelineRasterizationStateCreateInfo *pRasterizationState,
+  const VkPipelineMultisampleStateCreateInfo *pMultisampleState,
+  const VkPipelineDepthStencilStateCreateInfo *pDepthStencilState,
+  const VkPipelineColorBlendStateCreateInfo *pColorBlendState,
+  const VkPipelineDynamicStateCreateInfo *pDynamicState,
+  VkPipelineLayout layout,
+  VkRenderPass renderPass,
+  uint32_t subpass
+) {
+
+  return (VkGraphicsPipelineCreateInfo) {
+         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+         .pNext = NULL, .flags = 0, .stageCount = stageCount, .pStages = pStages, .pVertexInputState = pVertexInputState,
+         .pInputAssemblyState = pInputAssemblyState, .pTessellationState = pTessellationState, .pViewportState = pViewportState,
+         .pRasterizationState = pRasterizationState, .pMultisampleState = pMultisampleState, .pDepthStencilState = pDepthStencilState,
+         .pColorBlendState = pColorBlendState, .pDynamicState = pDynamicState, .layout = layout, .renderPass = renderPass,
+         .subpass = subpass, .basePipelineHandle = VK_NULL_HANDLE, .basePipelineIndex = -1
+  };
+}
+
 static inline VkDescriptorSetLayoutBinding dlu_set_desc_set_layout_binding(
   uint32_t binding,
   VkDescriptorType descriptorType,
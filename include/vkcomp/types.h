@@ -44,10 +44,18 @@ typedef enum _dlu_sync_type {
   DLU_VK_GET_RENDER_FENCE = 0x0004      /* Get the state of the fence */
 } dlu_sync_type;
 
+/* Queues with a timeline semaphore of their own, see dlu_create_timelines(3) */
+typedef enum _dlu_queue_type {
+  DLU_VK_GRAPHICS_QUEUE = 0x0000,
+  DLU_VK_TRANSFER_QUEUE = 0x0001,
+  DLU_VK_COMPUTE_QUEUE = 0x0002,
+  DLU_VK_QUEUE_CNT = 0x0003
+} dlu_queue_type;
+
 typedef enum _dlu_destroy_type {
   DLU_DESTROY_VK_SHADER = 0x0000, /* Destroy VkShaderModule Objects */
   DLU_DESTROY_VK_BUFFER = 0x0001, /* Destroy VkBuffer Objects */
-  DLU_DESTROY_VK_MEMORY = 0x0002, /* Destroy VkMemory Objects */
+  /* 0x0002 was DLU_DESTROY_VK_MEMORY, device memory is sub-allocated, see dlu_vk_free_mem(3) */
   DLU_DESTROY_VK_CMD_POOL = 0x0003, /* Destroy VkCommandPool Objects */
   DLU_DESTROY_VK_DESC_POOL = 0x0004, /* Destroy VkDescriptorPool Objects */
   DLU_DESTROY_VK_DESC_SET_LAYOUT = 0x0005, /* Destroy VkDescriptorSetLayout Objects */
@@ -65,6 +73,66 @@ typedef enum _dlu_destroy_type {
   DLU_DESTROY_VK_LOGIC_DEVICE = 0x0011 /* Destroy VkDevice Objects */
 } dlu_destroy_type;
 
+/**
+* Size of the VkDeviceMemory blocks resources are sub-allocated from. Shrinks down
+* to an eighth of the heap on small heaps. Resources over half a block get their own.
+*/
+#define DLU_VK_MEM_BLOCK_SIZE (1UL << 26)
+
+/**
+* Device memory sub-allocator statistics for a single heap
+* block_cnt | Amount of VkDeviceMemory objects allocated
+* alloc_cnt | Amount of live sub-allocations
+* allocated | Bytes allocated with vkAllocateMemory
+* used      | Bytes handed out to resources, includes rounding to a power of two
+*/
+typedef struct _dlu_vk_mem_stats {
+  uint32_t block_cnt;
+  uint32_t alloc_cnt;
+  VkDeviceSize allocated;
+  VkDeviceSize used;
+} dlu_vk_mem_stats;
+
+/**
+* Amount of upload command buffers that can be in flight on the transfer queue
+* at once, see dlu_vk_create_uploader(3)
+*/
+#define DLU_VK_UPLOAD_SLOTS 8
+
+/**
+* Amount of recycled one time command buffers (and their fences) kept
+* per logical device, see dlu_exec_begin_single_time_cmd_buff(3)
+*/
+#define DLU_VK_ONE_SHOT_CNT 8
+
+/**
+* Amount of binary semaphores each swap chain recycles for acquiring
+* and presenting images, see dlu_create_sem_pool(3)
+*/
+#define DLU_VK_SEM_POOL_CNT 16
+
+/* Most frames a swap chain can have in flight, see dlu_vk_create_frames(3) */
+#define DLU_VK_MAX_FRAMES 3
+
+/* Shader modules, render passes and pipeline layouts whose content hash is remembered */
+#define DLU_VK_OBJ_HASH_CNT 128
+
+/* Distinct graphics pipelines shared by content hash, see dlu_hash_graphics_pipeline(3) */
+#define DLU_VK_PIPE_MAP_CNT 256
+
+/* Alignment of data placed in the staging ring, satisfies buffer to image copy offsets */
+#define DLU_VK_UPLOAD_ALIGN 16
+
+/**
+* Heap budget, see dlu_vk_get_mem_budget(3)
+* usage  | Bytes of the heap in use by this process
+* budget | Bytes this process can allocate from the heap before allocations may fail or hurt performance
+*/
+typedef struct _dlu_vk_heap_budget {
+  VkDeviceSize usage;
+  VkDeviceSize budget;
+} dlu_vk_heap_budget;
+
 typedef enum _dlu_mem_map_type {
   DLU_VK_BUFFER = 0x0000,
   DLU_TEXT_VK_IMAGE = 0x0001
@@ -83,6 +151,9 @@ typedef struct _vkcomp {
   PFN_vkDestroyDebugUtilsMessengerEXT dbg_destroy_utils_msg;
   VkDebugUtilsMessengerEXT debug_utils_msg;
 
+  /* Loaded if VK_KHR_get_physical_device_properties2 is enabled, used for heap budgets */
+  PFN_vkGetPhysicalDeviceMemoryProperties2KHR get_mem_props2;
+
   VkInstance instance;
   VkSurfaceKHR surface;
 
@@ -92,6 +163,8 @@ typedef struct _vkcomp {
     uint32_t gfam_idx; /* Graphics Queue, Queue Family Index */
     uint32_t tfam_idx; /* Transfer Queue, Queue Family Index */ 
     uint32_t cfam_idx; /* Compute Queue, Queue Family Index */
+    VkPhysicalDeviceMemoryProperties mem_props; /* Memory types and heaps, they never change */
+    bool mem_budget; /* VK_EXT_memory_budget enabled on a logical device */
   } *pd_data;
 
   uint32_t ldc; /* Logical device count */
@@ -101,6 +174,35 @@ typedef struct _vkcomp {
     VkQueue compute;
     VkDevice device;
     uint32_t pdi; /* Physical device data index */
+
+    /* VkDeviceMemory blocks resources are sub-allocated from, see dlu_vk_mem_alloc(3) */
+    struct _dlu_vk_mem_block *mem_blocks;
+
+    /* Loaded if VK_KHR_draw_indirect_count is enabled, see dlu_exec_cmd_draw_indexed_indirect_count(3) */
+    PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count;
+
+    /**
+    * Free list of one time command buffers, a buffer is reused once its fence signals
+    * one_shot_pool: Graphics queue family pool, buffers in it can be reset individually
+    * recording: Handed out by dlu_exec_begin_single_time_cmd_buff(3) and not yet submitted
+    */
+    VkCommandPool one_shot_pool;
+    struct _one_shot {
+      VkCommandBuffer cmd_buff;
+      VkFence fence;
+      bool recording;
+    } one_shots[DLU_VK_ONE_SHOT_CNT];
+
+    /**
+    * Loaded if VK_KHR_timeline_semaphore is enabled, see dlu_create_timelines(3)
+    * timelines: One counter per queue, value is the last one a submission will signal
+    */
+    PFN_vkWaitSemaphoresKHR wait_sems;
+    PFN_vkGetSemaphoreCounterValueKHR get_sem_value;
+    struct _timeline {
+      VkSemaphore sem;
+      uint64_t value;
+    } timelines[DLU_VK_QUEUE_CNT];
   } *ld_data;
 
   uint32_t sdc; /* swap chain data count */
@@ -131,12 +233,53 @@ typedef struct _vkcomp {
       } sem;
     } *syncs;
 
+    /**
+    * Binary semaphores handed out by dlu_acquire_sc_image(3) and dlu_queue_graphics_timeline(3)
+    * value: Acquire semaphores retire once the graphics timeline reaches it
+    * img: Present semaphores retire once the image they were presented with is acquired again
+    * acquire: Pool entry of the last acquire, waited on by the next submission
+    * present: Pool entry signaled by the last submission, waited on by dlu_queue_present_timeline(3)
+    */
+    struct _sem_pool {
+      VkSemaphore sem;
+      uint64_t value;
+      uint32_t img;
+      bool in_use;
+    } sem_pool[DLU_VK_SEM_POOL_CNT];
+    uint32_t acquire;
+    uint32_t present;
+
+    /**
+    * Frames in flight, see dlu_vk_create_frames(3)
+    * pool: First of the DLU_VK_MAX_FRAMES cmd_data entries, one per frame slot
+    * count: Frames the CPU may record ahead of the GPU, 1 to DLU_VK_MAX_FRAMES
+    * cur: Slot of the frame being recorded, img the swap chain image it renders to
+    * frame: Frames submitted so far
+    * history: Graphics timeline value of the last frames, indexed by frame % DLU_VK_MAX_FRAMES
+    * retire: Graphics timeline value that frees up a slot's command pool
+    */
+    struct _frame_data {
+      uint32_t pool;
+      uint32_t count;
+      uint32_t cur;
+      uint32_t img;
+      uint64_t frame;
+      uint64_t history[DLU_VK_MAX_FRAMES];
+      uint64_t retire[DLU_VK_MAX_FRAMES];
+    } frames;
+
     /* Generally only need one depth buffer for multiple swap chain images */
-    struct _depth_buffer {
+    /**
+    * depth: Depth buffer, see dlu_create_depth_buff(3)
+    * msaa: Multisampled color attachment resolved into the swapchain image, see dlu_create_msaa_buff(3)
+    */
+    struct _attachment_buffer {
       VkImage image;
       VkImageView view;
       VkDeviceMemory mem;
-    } depth;
+      VkDeviceSize offset; /* Offset into mem the image is bound at */
+      VkDeviceSize size;   /* Size of the sub-allocation */
+    } depth, msaa;
 
     /* logical device index, Used to keep track of active VkDevice */
     uint32_t ldi;
@@ -149,6 +292,67 @@ typedef struct _vkcomp {
     uint32_t ldi;
   } gp_cache;
 
+  /**
+  * Content hashes of the objects a graphics pipeline refers to, recorded when
+  * dlu_create_shader_module(3), dlu_create_render_pass(3) and dlu_create_pipeline_layout(3)
+  * create them and dropped by dlu_vk_destroy(3). Pipelines using any other object aren't shared.
+  */
+  struct _obj_hash {
+    uint64_t handle;
+    uint64_t hash;
+  } obj_hashes[DLU_VK_OBJ_HASH_CNT];
+
+  /**
+  * Graphics pipelines by the hash of their full state. Identical requests get the same
+  * VkPipeline, it's destroyed once the last of its graphics_pipelines slots is destroyed.
+  * key holds the canonical state that was hashed, a hash hit is confirmed against it.
+  */
+  struct _pipe_entry {
+    uint64_t hash;
+    unsigned char *key;
+    size_t key_size;
+    VkPipeline pipeline;
+    uint32_t refs;
+    uint32_t ldi;
+  } pipe_map[DLU_VK_PIPE_MAP_CNT];
+
+  /**
+  * Asynchronous uploads recorded on the transfer queue. A slot is a command buffer
+  * that can be reused once its fence signals, nothing waits on the host for it
+  */
+  struct _upload_data {
+    VkCommandPool cmd_pool;
+    VkQueue queue;     /* Queue uploads are submitted to */
+    uint32_t qfam_idx; /* Queue family of the queue above */
+    struct _upload_slot {
+      VkCommandBuffer cmd_buff;
+      VkFence fence;   /* Signals once the copies recorded in the slot completed */
+      VkSemaphore sem; /* Optionally signaled alongside the fence for the graphics queue */
+      bool recording;
+      bool sem_pending; /* sem was signaled and not yet handed to a graphics submission */
+      uint64_t seq;     /* Order slots were begun in */
+      VkDeviceSize ring_begin, ring_end; /* Staging ring range the slot copies from */
+    } slots[DLU_VK_UPLOAD_SLOTS];
+    uint64_t seq;
+
+    /**
+    * Host visible staging ring. Space is handed out at ring_head and given back
+    * once the fence of the slot that copies from it signals
+    */
+    struct _upload_ring {
+      VkBuffer buff;
+      VkDeviceMemory mem;
+      VkDeviceSize offset;   /* Offset of the sub-allocation in mem */
+      VkDeviceSize mem_size; /* Size of the sub-allocation */
+      VkDeviceSize size;
+      VkDeviceSize head;
+      void *mapped;
+    } ring;
+
+    /* logical device index, Used to keep track of active VkDevice */
+    uint32_t ldi;
+  } upload;
+
   uint32_t gdc;
   struct _gp_data {
     VkRenderPass render_pass;
@@ -173,6 +377,10 @@ typedef struct _vkcomp {
   struct _buff_data {
     VkBuffer buff;
     VkDeviceMemory mem;
+    VkDeviceSize offset; /* Offset into mem the buffer is bound at */
+    VkDeviceSize size;   /* Size of the sub-allocation */
+    void *mapped;        /* Persistently mapped pointer to the buffer, NULL if not host visible */
+    VkDeviceSize frame_size; /* Bytes per frame of an instance stream, see dlu_create_instance_stream(3) */
 
     /* logical device index, Used to keep track of active VkDevice */
     uint32_t ldi;
@@ -194,6 +402,9 @@ typedef struct _vkcomp {
     VkImage image;
     VkImageView view;
     VkDeviceMemory mem;
+    VkDeviceSize offset; /* Offset into mem the image is bound at */
+    VkDeviceSize size;   /* Size of the sub-allocation */
+    void *mapped;        /* Persistently mapped pointer to the image, NULL if not host visible */
     VkSampler sampler;
 
     /* logical device index, Used to keep track of active VkDevice */
@@ -201,4 +412,87 @@ typedef struct _vkcomp {
   } *text_data;
 } vkcomp;
 
+/**
+* Limits of a render graph, see dlu_create_render_graph(3). A pass declares each
+* resource it touches once, at most DLU_GRAPH_MAX_USES of them.
+*/
+#define DLU_GRAPH_MAX_PASSES 32
+#define DLU_GRAPH_MAX_RESOURCES 32
+#define DLU_GRAPH_MAX_USES 8
+
+/* Records the commands of a render graph pass, see dlu_graph_add_pass(3) */
+typedef void (*dlu_graph_record_func)(vkcomp *app, VkCommandBuffer cmd_buff, void *data);
+
+/**
+* Barriers recorded in front of a pass, merged into a single vkCmdPipelineBarrier.
+* Buffer hazards and images that keep their layout share one global VkMemoryBarrier.
+* ibi | First image barrier in dlu_render_graph.img_barriers
+* ibc | Amount of image barriers
+*/
+struct _graph_batch {
+  VkPipelineStageFlags src_stage;
+  VkPipelineStageFlags dst_stage;
+  uint32_t mbc;
+  VkMemoryBarrier mem_barrier;
+  uint32_t ibi;
+  uint32_t ibc;
+};
+
+typedef struct _dlu_render_graph {
+  uint32_t ldi;  /* logical device index, Used to keep track of active VkDevice */
+  bool compiled;
+
+  uint32_t rc; /* resource count */
+  struct _graph_res {
+    bool image;
+    bool transient;   /* Created and aliased by the graph */
+    uint32_t idx;     /* text_data index of images, buff_data index of buffers */
+    VkImage vk_image; /* Imported images need not live in text_data (swap chain images) */
+    VkImageSubresourceRange range;
+    VkImageLayout initial_layout;
+    VkImageLayout final_layout;
+    VkImageCreateInfo img_info;
+    VkImageViewCreateInfo view_info;
+    VkBufferCreateInfo buff_info;
+    VkMemoryRequirements reqs;
+    uint32_t first; /* First live pass using the resource, UINT32_MAX if none */
+    uint32_t last;  /* Last live pass using the resource */
+    uint32_t slot;  /* Memory slot of transient resources */
+  } res[DLU_GRAPH_MAX_RESOURCES];
+
+  uint32_t pc; /* pass count */
+  struct _graph_pass {
+    const char *name;
+    dlu_graph_record_func record;
+    void *data;
+    bool culled;
+    uint32_t uc; /* use count */
+    struct _graph_use {
+      uint32_t res;
+      VkPipelineStageFlags stage;
+      VkAccessFlags access;
+      VkImageLayout layout;
+    } uses[DLU_GRAPH_MAX_USES];
+    struct _graph_batch batch;
+  } passes[DLU_GRAPH_MAX_PASSES];
+
+  /* Transitions imported images into their final layout after the last pass */
+  struct _graph_batch final;
+
+  uint32_t ibc; /* image barrier count */
+  VkImageMemoryBarrier img_barriers[DLU_GRAPH_MAX_PASSES * DLU_GRAPH_MAX_USES + DLU_GRAPH_MAX_RESOURCES];
+
+  /**
+  * Transient resources whose lifetimes don't overlap share a slot's memory
+  * owner | Resource that owns the sub-allocation, aliases are bound to it with no size
+  */
+  uint32_t sc; /* slot count */
+  struct _graph_slot {
+    uint32_t owner;
+    uint32_t last;
+    VkMemoryRequirements reqs;
+    bool lazy;
+  } slots[DLU_GRAPH_MAX_RESOURCES];
+} dlu_render_graph;
+
 #endif
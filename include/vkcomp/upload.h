@@ -0,0 +1,138 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#ifndef DLU_VKCOMP_UPLOAD_H
+#define DLU_VKCOMP_UPLOAD_H
+
+/**
+* Create the command pool, command buffers, fences and semaphores used to record
+* copies on the transfer queue. Falls back to the graphics queue if
+* dlu_create_device_queue(3) wasn't given VK_QUEUE_TRANSFER_BIT.
+* staging_size: bytes of the host visible staging ring, 0 to skip creating it
+*/
+VkResult dlu_vk_create_uploader(vkcomp *app, uint32_t cur_ld, VkDeviceSize staging_size);
+
+/**
+* Begin recording into a free upload slot. Never waits, returns VK_NULL_HANDLE
+* if every slot is still in flight. Record copies with dlu_exec_copy_buffer(3) and
+* dlu_exec_copy_buff_to_image(3) passing the returned command buffer.
+*/
+VkCommandBuffer dlu_vk_upload_begin(vkcomp *app, uint32_t *slot);
+
+/**
+* Submit a slot to the transfer queue. Its fence signals once the copies are done.
+* If signal_sem is set the slot's semaphore is signaled as well, it must be waited
+* on by a graphics submission, see dlu_vk_upload_wait_sem(3)
+*/
+VkResult dlu_vk_upload_submit(vkcomp *app, uint32_t slot, bool signal_sem);
+
+/* Non-blocking check, returns true once the copies recorded in a slot completed */
+bool dlu_vk_upload_done(vkcomp *app, uint32_t slot);
+
+/* Blocks until a slot completed or timeout (in nanoseconds) expires */
+VkResult dlu_vk_upload_wait(vkcomp *app, uint32_t slot, uint64_t timeout);
+
+/**
+* Hand out the semaphore signaled by dlu_vk_upload_submit(3). Place it in the
+* pWaitSemaphores of the next graphics VkSubmitInfo. A slot isn't reused until it's taken.
+*/
+VkSemaphore dlu_vk_upload_wait_sem(vkcomp *app, uint32_t slot);
+
+/**
+* Batched uploads, any amount of copies is recorded into one slot and goes out with a
+* single dlu_vk_upload_submit(3). Data is copied into the staging ring, that space is
+* recycled once the slot's fence signals. Returns VK_NOT_READY if the ring is full,
+* submit the slot and try again later.
+*/
+VkResult dlu_vk_upload_stage(vkcomp *app, uint32_t slot, const void *data, VkDeviceSize size, VkDeviceSize *offset);
+
+/* Stage data and record a copy into cur_bd at dstOffset */
+VkResult dlu_vk_upload_buff(vkcomp *app, uint32_t slot, uint32_t cur_bd, VkDeviceSize dstOffset, const void *data, VkDeviceSize size);
+
+/**
+* Stage data and record the whole image upload. The bufferOffset of each region is
+* relative to data. The image is transitioned to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+* copied into, then released to the graphics family in finalLayout.
+* Acquire it with dlu_vk_upload_acquire_image(3) passing
+* VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL and finalLayout.
+*/
+VkResult dlu_vk_upload_image(
+  vkcomp *app,
+  uint32_t slot,
+  uint32_t cur_tex,
+  const void *data,
+  VkDeviceSize size,
+  uint32_t regionCount,
+  const VkBufferImageCopy *pRegions,
+  VkImageSubresourceRange subresourceRange,
+  VkImageLayout finalLayout
+);
+
+/**
+* Queue family ownership transfer, transfer queue -> graphics queue.
+* The release half is recorded into the upload slot after the copies, the acquire half
+* into a graphics command buffer that executes after the upload semaphore (or fence) signaled.
+* Both halves must be given the same layouts. dstStageMask/dstAccessMask describe the
+* first use on the graphics queue. When both queues share a family the release half
+* does a regular barrier and the acquire half records nothing.
+*/
+void dlu_vk_upload_release_image(
+  vkcomp *app,
+  uint32_t slot,
+  uint32_t cur_tex,
+  VkImageLayout oldLayout,
+  VkImageLayout newLayout,
+  VkImageSubresourceRange subresourceRange
+);
+
+void dlu_vk_upload_acquire_image(
+  vkcomp *app,
+  uint32_t cur_tex,
+  VkImageLayout oldLayout,
+  VkImageLayout newLayout,
+  VkImageSubresourceRange subresourceRange,
+  VkPipelineStageFlags dstStageMask,
+  VkAccessFlags dstAccessMask,
+  VkCommandBuffer cmd_buff
+);
+
+void dlu_vk_upload_release_buff(vkcomp *app, uint32_t slot, uint32_t cur_bd, VkDeviceSize offset, VkDeviceSize size);
+
+void dlu_vk_upload_acquire_buff(
+  vkcomp *app,
+  uint32_t cur_bd,
+  VkDeviceSize offset,
+  VkDeviceSize size,
+  VkPipelineStageFlags dstStageMask,
+  VkAccessFlags dstAccessMask,
+  VkCommandBuffer cmd_buff
+);
+
+#ifdef INAPI_CALLS
+/* Destroy the uploader, called from dlu_freeup_vk(3) */
+void dlu_vk_destroy_uploader(vkcomp *app);
+#endif
+
+#endif
@@ -26,6 +26,9 @@
 #define DLU_VKCOMP_UTILS_H
 
 #ifdef INAPI_CALLS
+/* Memory properties of a physical device, queried once and cached in app->pd_data[pdi] */
+VkPhysicalDeviceMemoryProperties *get_memory_properties(vkcomp *app, uint32_t pdi);
+
 /**
 * Can find in vulkan SDK API-Samples/utils/util.cpp
 * Used to find a suitable memory type
@@ -37,6 +40,11 @@ bool memory_type_from_properties(
   VkFlags requirements_mask,
   uint32_t *typeIndex
 );
+
+#define DLU_HASH_SEED 0xcbf29ce484222325
+
+/* FNV-1a, chain calls by passing the previous result as hash, start with DLU_HASH_SEED */
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size);
 #endif
 
 #endif
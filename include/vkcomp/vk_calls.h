@@ -28,6 +28,15 @@
 /* Allows for vulkan synchronization function calling within lucurious */
 VkResult dlu_vk_sync(dlu_sync_type type, vkcomp *app, uint32_t cur_scd, uint32_t synci);
 
+/**
+* Block until the timeline of queue reaches value or timeout (in nanoseconds) expires.
+* Returns VK_TIMEOUT if it didn't, see dlu_create_timelines(3)
+*/
+VkResult dlu_vk_wait_timeline(vkcomp *app, uint32_t cur_ld, dlu_queue_type queue, uint64_t value, uint64_t timeout);
+
+/* Non-blocking, value receives the last value the GPU signaled on the timeline of queue */
+VkResult dlu_vk_get_timeline(vkcomp *app, uint32_t cur_ld, dlu_queue_type queue, uint64_t *value);
+
 /* Allows for more developer vulkan object destruction control */
 void dlu_vk_destroy(dlu_destroy_type type, vkcomp *app, uint32_t cur_ld, void *data);
 
@@ -193,6 +193,13 @@ void _show_err_msg(uint32_t dlu_err, int vkerr, const char *dlu_msg) {
       dlu_log_me(DLU_DANGER, "[x] Must have a VkDevice or a VkPhysicalDevice association");
       dlu_log_me(DLU_DANGER, "[x] Must make a call to %s to create that association", dlu_msg);
       break;
+    case DLU_VKCOMP_UPLOADER:
+      dlu_log_me(DLU_DANGER, "[x] No upload command buffers to record into");
+      dlu_log_me(DLU_DANGER, "[x] Must make a call to dlu_vk_create_uploader()");
+      break;
+    case DLU_VKCOMP_RENDER_GRAPH:
+      dlu_log_me(DLU_DANGER, "[x] Render graph: %s", dlu_msg);
+      break;
     case DLU_BUFF_NOT_ALLOC:
       dlu_log_me(DLU_DANGER, "[x] Must make a call to dlu_otba(): %s", dlu_msg);
       break;
@@ -22,10 +22,14 @@
 * THE SOFTWARE.
 */
 
+#define _GNU_SOURCE /* memfd_create(2) */
 #include <sys/mman.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/socket.h>
 #include <fcntl.h>
+#include <inttypes.h>
+#include <stdatomic.h>
 
 #include <lucom.h>
 #include "../../include/vkcomp/types.h"
@@ -33,122 +37,422 @@
 
 /**
 * Struct that stores block metadata
-* Using Doubly linked list to keep track of memory allocated
 * size     | allocated memory size
-* abytes   | available bytes left in block
+* abytes   | available bytes left in block, only ever decremented with a CAS
 * saddr    | Starting address of the block where data is assigned
-* prev     | Points to the previous block
-* next     | Points to the next memory block
+* prev     | Points to the previous large block in the chain
+* next     | Points to the next large block in the chain, only ever set with a CAS
 */
 typedef struct mblock {
   size_t size;
-  size_t abytes;
+  _Atomic size_t abytes;
   void *saddr;
   struct mblock *prev;
-  struct mblock *next;
+  struct mblock *_Atomic next;
 } BYTE_ALIGN dlu_mem_block_t;
 
 #define BLOCK_SIZE sizeof(dlu_mem_block_t)
 
+/* Default huge page size on x86_64 and aarch64 (4K granule) */
+#define HUGE_PAGE_SIZE (1UL << 21)
+
 /**
 * Globals used to keep track of memory blocks
-* sstart_addr_priv: Keep track of first allocated private small block address
-* large_block_priv: A struct to keep track of one large allocated private block
-* small_block_priv: A linked list for smaller allocated private block
-* sstart_addr_shared: Keep track of first allocated small shared block address
+* large_block_priv: First block in the chain of large allocated private blocks
+* cur_block_priv: Block in the private chain small blocks are currently carved from
 * large_block_shared: A struct to keep track of one large allocated shared block
-* small_block_shared: linked list for smaller allocated shared blocks
+* block_gen: Bumped every time the large blocks are created or released. Thread
+*            arenas carved from an older generation are considered stale.
+* Sub-blocks are laid out back to back after a large block's metadata, so the
+* block list is walked by size instead of through a linked list.
+*
+* Private blocks grow on demand. Once the current block runs out a new one at least
+* twice its size is mmap'd and linked onto the chain. Existing blocks never move, so
+* pointers handed out earlier stay valid. Shared blocks stay a single fixed mapping,
+* as growing them after a fork(2) would not be visible to other processes.
+*/
+static dlu_mem_block_t *_Atomic large_block_priv = NULL;
+static dlu_mem_block_t *_Atomic cur_block_priv = NULL;
+static dlu_mem_block_t *_Atomic large_block_shared = NULL;
+static atomic_uint_fast64_t block_gen = 1;
+
+/* dlu_mem_flags given to dlu_otma(3), grown private blocks are mapped the same way */
+static uint32_t mflags_priv = DLU_MEM_DEFAULT;
+static uint32_t mflags_shared = DLU_MEM_DEFAULT;
+
+/* memfd backing large_block_shared when DLU_MEM_SHAREABLE is set or it was imported */
+static int shared_fd = NEG_ONE;
+
+/**
+* Per-thread sub-arena carved from a large block with dlu_otta(3)
+* chunk | sub-block owned by the calling thread
+* used  | bytes of the chunk already handed out
+* gen   | block_gen value at the time the chunk was carved
+*/
+struct thread_arena {
+  dlu_mem_block_t *chunk;
+  size_t used;
+  uint_fast64_t gen;
+};
+
+static _Thread_local struct thread_arena tarena_priv;
+static _Thread_local struct thread_arena tarena_shared;
+
+/**
+* Frame arena reserved with dlu_otfa(3). One slice per frame in flight,
+* the current slice is bumped atomically and reset by dlu_frame_begin(3).
+* base   | Starting address of the first slice
+* bytes  | Size of a single slice
+* frames | Amount of slices (frames in flight)
+* cur    | Slice currently handed out
+* used   | Bytes of the current slice already handed out
+* begun  | Set by the first dlu_frame_begin(3), nothing is handed out before it
+* gen    | block_gen value at the time the arena was reserved
 */
-static void *sstart_addr_priv = NULL;
-static dlu_mem_block_t *large_block_priv = NULL;
-static dlu_mem_block_t *small_block_priv = NULL;
+struct frame_arena {
+  void *base;
+  size_t bytes;
+  uint32_t frames;
+  _Atomic uint32_t cur;
+  _Atomic size_t used;
+  atomic_bool begun;
+  uint_fast64_t gen;
+};
+
+static struct frame_arena farena;
+
+/**
+* Accounting kept for every dlu_block_type and dlu_data_type, see dlu_mm_stats.
+* Allocations served from a thread or frame arena aren't counted individually,
+* carving the arena is.
+*/
+struct mm_counters {
+  _Atomic uint64_t requested;
+  _Atomic uint64_t overhead;
+  _Atomic uint64_t in_use;
+  _Atomic uint64_t allocs;
+  _Atomic uint64_t failures;
+};
+
+#define BLOCK_STATS_CNT 4
+#define DATA_STATS_CNT 14
+
+/**
+* Counters are sharded per thread. Only the owning thread writes its shard, so updates are
+* a plain load and store on cache lines no other thread touches. Queries add every shard up.
+* Shards are never freed, what a thread counted still adds up after it exited. Threads that
+* couldn't get a shard share base_shard and update it with atomics.
+*/
+struct mm_shard {
+  struct mm_counters block[BLOCK_STATS_CNT];
+  struct mm_counters data[DATA_STATS_CNT];
+  struct mm_shard *next;
+};
+
+static struct mm_shard base_shard;
+static struct mm_shard *_Atomic shards = &base_shard;
+static _Thread_local struct mm_shard *tshard = NULL;
+
+/**
+* Small blocks are never freed, in_use only drops when every block is released.
+* So the high-water mark is taken on every query and right before a release.
+*/
+static _Atomic uint64_t block_peaks[BLOCK_STATS_CNT];
+static _Atomic uint64_t data_peaks[DATA_STATS_CNT];
+
+static const char *block_stats_names[BLOCK_STATS_CNT] = {
+  "DLU_LARGE_BLOCK_PRIV", "DLU_SMALL_BLOCK_PRIV", "DLU_LARGE_BLOCK_SHARED", "DLU_SMALL_BLOCK_SHARED"
+};
+
+static const char *data_stats_names[DATA_STATS_CNT] = {
+  "DLU_SC_DATA", "DLU_GP_DATA", "DLU_CMD_DATA", "DLU_BUFF_DATA", "DLU_DESC_DATA", "DLU_TEXT_DATA",
+  "DLU_PD_DATA", "DLU_LD_DATA", "DLU_SC_DATA_MEMS", "DLU_DESC_DATA_MEMS", "DLU_GP_DATA_MEMS",
+  "DLU_CMD_DATA_MEMS", "DLU_DEVICE_OUTPUT_DATA", "DLU_DEVICE_OUTPUT_BUFF_DATA"
+};
+
+static int block_stats_idx(dlu_block_type type) {
+  switch (type) {
+    case DLU_LARGE_BLOCK_PRIV: return 0;
+    case DLU_SMALL_BLOCK_PRIV: return 1;
+    case DLU_LARGE_BLOCK_SHARED: return 2;
+    case DLU_SMALL_BLOCK_SHARED: return 3;
+    default: return NEG_ONE;
+  }
+}
+
+static int data_stats_idx(dlu_data_type type) {
+  if (type <= DLU_LD_DATA) return type;
+  if (type >= DLU_SC_DATA_MEMS && type <= DLU_CMD_DATA_MEMS) return 8 + (type - DLU_SC_DATA_MEMS);
+  if (type >= DLU_DEVICE_OUTPUT_DATA && type <= DLU_DEVICE_OUTPUT_BUFF_DATA) return 12 + (type - DLU_DEVICE_OUTPUT_DATA);
+  return NEG_ONE;
+}
+
+static struct mm_shard *get_shard() {
+  if (tshard) return tshard;
+
+  /* Rounded up to whole cache lines, aligned_alloc(3) requires a multiple of the alignment */
+  size_t bytes = (sizeof(struct mm_shard) + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+  struct mm_shard *shard = aligned_alloc(CACHE_LINE_SIZE, bytes);
+  if (!shard) return &base_shard;
+  memset(shard, 0, bytes);
+
+  shard->next = atomic_load_explicit(&shards, memory_order_relaxed);
+  while (!atomic_compare_exchange_weak_explicit(&shards, &shard->next, shard, memory_order_release, memory_order_relaxed));
+
+  return tshard = shard;
+}
+
+static struct mm_counters *get_block_stats(dlu_block_type type) {
+  int i = block_stats_idx(type);
+  return (i == NEG_ONE) ? NULL : &get_shard()->block[i];
+}
+
+static struct mm_counters *get_data_stats(dlu_data_type type) {
+  int i = data_stats_idx(type);
+  return (i == NEG_ONE) ? NULL : &get_shard()->data[i];
+}
+
+/* Only called right after get_shard(3), tshard tells whether the counter is ours alone */
+static void counter_add(_Atomic uint64_t *c, uint64_t val) {
+  if (tshard) atomic_store_explicit(c, atomic_load_explicit(c, memory_order_relaxed) + val, memory_order_relaxed);
+  else atomic_fetch_add_explicit(c, val, memory_order_relaxed);
+}
+
+static void stats_add(struct mm_counters *c, size_t bytes, size_t overhead) {
+  if (!c) return;
+  counter_add(&c->requested, bytes);
+  counter_add(&c->overhead, overhead);
+  counter_add(&c->allocs, 1);
+  counter_add(&c->in_use, bytes + overhead);
+}
+
+/* Unsigned wrap around, a shard may go "negative" as long as the sum of all of them doesn't */
+static void stats_sub(struct mm_counters *c, size_t bytes) {
+  if (c) counter_add(&c->in_use, -(uint64_t) bytes);
+}
+
+static void stats_fail(struct mm_counters *c) {
+  if (c) counter_add(&c->failures, 1);
+}
+
+static void dump_stats_at_exit();
+
+/* Scratch handed out by dlu_frame_alloc(3) is suitable for any type */
+#define FRAME_ALIGN _Alignof(max_align_t)
 
-static void *sstart_addr_shared = NULL;
-static dlu_mem_block_t *large_block_shared = NULL;
-static dlu_mem_block_t *small_block_shared = NULL;
+/**
+* Slab pool handed out by dlu_otsa(3)
+* type      | Which struct array the pool manages
+* addr      | vkcomp or dlu_disp_core the array belongs to
+* size      | Amount of slots in the array
+* fcnt      | Amount of indices currently on the free list
+* in_use    | Guard against double frees and frees of unknown indices
+* free_list | Stack of free slot indices, O(1) get and put
+*/
+struct _dlu_slab_pool {
+  dlu_data_type type;
+  void *addr;
+  uint32_t size;
+  uint32_t fcnt;
+  bool *in_use;
+  uint32_t free_list[];
+};
+
+static dlu_mem_block_t *get_large_block(dlu_block_type type) {
+  switch (type) {
+    case DLU_LARGE_BLOCK_PRIV: case DLU_SMALL_BLOCK_PRIV: return large_block_priv;
+    case DLU_LARGE_BLOCK_SHARED: case DLU_SMALL_BLOCK_SHARED: return large_block_shared;
+    default: return NULL;
+  }
+}
 
 /**
-* Helps in ensuring one does not waste cycles in context switching
-* First check if sub-block was allocated and is currently free
-* If block not free, sub allocate more from larger memory block
+* Lock-free fallback path. Reserve a sub-block whose data starts on an align boundary
+* (a power of two) by decrementing the large block's available bytes with a CAS.
+* The reservation covers BLOCK_SIZE, the padding between the header and the data and
+* bytes. Padding is counted in the sub-block's size, so blocks can still be walked
+* header to header. Each thread that wins the CAS owns the reserved range, so the
+* sub-block metadata can be written without a lock.
 */
-static dlu_mem_block_t *get_free_block(dlu_block_type type, size_t bytes) {
-  dlu_mem_block_t *current = NULL;
-  size_t abytes = 0;
+static dlu_mem_block_t *bump_block(dlu_mem_block_t *large, size_t bytes, size_t align) {
+  dlu_mem_block_t *block = NULL;
+  size_t nbytes = 0, pad = 0;
+  size_t abytes = atomic_load_explicit(&large->abytes, memory_order_relaxed);
 
   /**
-  * If next block doesn't exists use large_block_priv/shared->saddr address
-  * else set current to next block (which would be the block waiting to be allocated)
+  * Offset from the start of the large block's data to the reserved range.
+  * Not using large->saddr as a shared block may be mapped at a different
+  * address in the process that created it.
   */
-  switch(type) {
-    case DLU_SMALL_BLOCK_PRIV:
-      abytes = large_block_priv->abytes;
-      current = (!small_block_priv->next) ? (dlu_mem_block_t *) sstart_addr_priv : small_block_priv->next;
-      break;
-    case DLU_SMALL_BLOCK_SHARED:
-      abytes = large_block_shared->abytes;
-      current = (!small_block_shared->next) ? (dlu_mem_block_t *) sstart_addr_shared : small_block_shared->next;
-      break;
-    default: break;
+  do {
+    uintptr_t start = (uintptr_t) large + BLOCK_SIZE + (large->size - abytes) + BLOCK_SIZE;
+    pad = ((start + align - 1) & ~(align - 1)) - start;
+    nbytes = BLOCK_SIZE + pad + bytes;
+    if (abytes < nbytes) return NULL;
+  } while (!atomic_compare_exchange_weak_explicit(&large->abytes, &abytes, abytes - nbytes,
+                                                  memory_order_acq_rel, memory_order_relaxed));
+
+  block = ((void*)large) + BLOCK_SIZE + (large->size - abytes);
+  block->size = pad + bytes;
+  atomic_init(&block->abytes, 0);
+  block->saddr = ((void*)block) + BLOCK_SIZE + pad;
+  block->prev = NULL;
+  atomic_init(&block->next, NULL);
+
+  return block;
+}
+
+static dlu_mem_block_t *alloc_mem_block(dlu_block_type type, size_t bytes, int *mfd);
+
+/**
+* Link nblock after the last block in the private chain starting at head. Whoever loses
+* the CAS on a next pointer simply moves on to the block that won. The winner of the chain
+* publishes cur_block_priv only after head, walk from head until it shows up.
+*/
+static void append_large_block(dlu_mem_block_t *head, dlu_mem_block_t *nblock) {
+  dlu_mem_block_t *tail = atomic_load(&cur_block_priv), *expected = NULL;
+  if (!tail) tail = head;
+
+  while (!atomic_compare_exchange_weak(&tail->next, &expected, nblock)) {
+    if (expected) tail = expected;
+    expected = NULL;
   }
 
-  /* An extra check, although this should never be NULL */
-  if (!current) return NULL;
-
-  if (abytes >= bytes) {
-    /* current block thats about to be allocated set few metadata */
-    dlu_mem_block_t *block = current;
-    block->size = bytes;
-    /* Put saddr at an address that doesn't contain metadata */
-    block->saddr = ((void*)current) + BLOCK_SIZE;
-
-    /**
-    * This is written this way because one needs the return address
-    * to be the starting address of the next block not the current one.
-    * Basically offset the memory address. Thus, allocating space.
-    */
-    block = ((void*)current) + BLOCK_SIZE + bytes;
-    block->prev = current;
-
-    /* Decrement larger block available memory */
-    switch(type) {
-      case DLU_SMALL_BLOCK_SHARED: large_block_shared->abytes -= (BLOCK_SIZE + bytes); break;
-      case DLU_SMALL_BLOCK_PRIV: large_block_priv->abytes -= (BLOCK_SIZE + bytes); break;
-      default: break;
-    }
+  nblock->prev = tail;
+}
 
-    return block;
+/**
+* Return the block after cur, mapping a new one if cur is the end of the chain.
+* Blocks grow geometrically so the amount of mmap(2) calls stays logarithmic.
+*/
+static dlu_mem_block_t *grow_large_block(dlu_mem_block_t *cur, size_t bytes) {
+  dlu_mem_block_t *nblock = cur->next, *expected = NULL;
+
+  if (!nblock) {
+    size_t size = cur->size << 1;
+    if (size < BLOCK_SIZE + bytes) size = BLOCK_SIZE + bytes;
+
+    nblock = alloc_mem_block(DLU_LARGE_BLOCK_PRIV, size, NULL);
+    if (!nblock) return NULL;
+    nblock->prev = cur;
+
+    /* Another thread grew the chain first, use theirs */
+    if (!atomic_compare_exchange_strong(&cur->next, &expected, nblock)) {
+      stats_sub(get_block_stats(DLU_LARGE_BLOCK_PRIV), BLOCK_SIZE + nblock->size);
+      munmap(nblock, BLOCK_SIZE + nblock->size);
+      nblock = expected;
+    }
   }
 
-  return NULL;
+  /* Move the allocation cursor forward, fine if someone else already did */
+  atomic_compare_exchange_strong(&cur_block_priv, &cur, nblock);
+
+  return nblock;
 }
 
-static dlu_mem_block_t *alloc_mem_block(dlu_block_type type, size_t bytes) {
-  dlu_mem_block_t *block = NULL;
+static dlu_mem_block_t *get_free_block(dlu_block_type type, size_t bytes, size_t align) {
+  dlu_mem_block_t *large = NULL, *block = NULL;
 
-  /* Allows for zeros to be written into values of bytes allocated */
-  int fd = open("/dev/zero", O_RDWR);
-  if (fd == NEG_ONE) {
-    dlu_log_me(DLU_DANGER, "[x] open: %s", strerror(errno));
-    goto finish_alloc_mem_block;
+  switch (type) {
+    case DLU_SMALL_BLOCK_PRIV: large = cur_block_priv; break;
+    case DLU_SMALL_BLOCK_SHARED: large = large_block_shared; break;
+    default: return NULL;
   }
 
+  while (large) {
+    block = bump_block(large, bytes, align);
+    if (block || type == DLU_SMALL_BLOCK_SHARED) break;
+    large = grow_large_block(large, bytes + align - 1);
+  }
+
+  /* Alignment padding is bookkept as overhead */
+  if (block) stats_add(get_block_stats(type), bytes, BLOCK_SIZE + (block->size - bytes));
+  else stats_fail(get_block_stats(type));
+
+  return block;
+}
+
+/* Fast path, no atomics. Only the owning thread ever touches its arena */
+static void *get_thread_block(struct thread_arena *ta, size_t bytes, size_t align) {
+  if (!ta->chunk || ta->gen != atomic_load_explicit(&block_gen, memory_order_acquire)) return NULL;
+
+  uintptr_t start = (uintptr_t) ta->chunk->saddr + ta->used;
+  size_t pad = ((start + align - 1) & ~(align - 1)) - start;
+  if (ta->chunk->size - ta->used < pad + bytes) return NULL;
+
+  void *addr = ta->chunk->saddr + ta->used + pad;
+  ta->used += pad + bytes;
+  return addr;
+}
+
+/**
+* Map a large block. MAP_ANONYMOUS already hands back zeroed pages, no need for /dev/zero.
+* The mapping length is rounded up when huge pages are requested, the extra room is
+* handed to the block rather than wasted.
+*/
+/* If mfd isn't NULL the block's memfd is returned through it, NEG_ONE otherwise */
+static dlu_mem_block_t *alloc_mem_block(dlu_block_type type, size_t bytes, int *mfd) {
+  dlu_mem_block_t *block = MAP_FAILED;
+  uint32_t mflags = (type == DLU_LARGE_BLOCK_SHARED) ? mflags_shared : mflags_priv;
+  size_t len = BLOCK_SIZE + bytes;
+  int fd = NEG_ONE;
+
   /* Can only allocate up to 8GB, 2^33, or 1ULL << 33 */
   int flags = (type == DLU_LARGE_BLOCK_SHARED) ? MAP_SHARED : MAP_PRIVATE;
-  block = mmap(NULL, BLOCK_SIZE + bytes, PROT_READ | PROT_WRITE, flags | MAP_ANONYMOUS, fd, 0);
+  if (mflags & DLU_MEM_PREFAULT) flags |= MAP_POPULATE;
+  if (mflags & DLU_MEM_HUGE_PAGES) len = (len + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+
+  /* A memfd lets the block be handed to another process, see dlu_send_shared_fd(3) */
+  if (type == DLU_LARGE_BLOCK_SHARED && mflags & DLU_MEM_SHAREABLE && mfd) {
+    fd = memfd_create("dlu_shared_block", MFD_CLOEXEC);
+    if (fd == NEG_ONE) {
+      dlu_log_me(DLU_DANGER, "[x] memfd_create: %s", strerror(errno));
+      stats_fail(get_block_stats(type));
+      return NULL;
+    }
+
+    if (ftruncate(fd, len) == NEG_ONE) {
+      dlu_log_me(DLU_DANGER, "[x] ftruncate: %s", strerror(errno));
+      stats_fail(get_block_stats(type));
+      close(fd); return NULL;
+    }
+  } else {
+    flags |= MAP_ANONYMOUS;
+  }
+
+  /* Explicit huge pages need a reserved pool (vm.nr_hugepages), fall back to THP */
+  if (mflags & DLU_MEM_HUGE_PAGES && fd == NEG_ONE)
+    block = mmap(NULL, len, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, fd, 0);
+
+  if (block == MAP_FAILED) {
+    block = mmap(NULL, len, PROT_READ | PROT_WRITE, flags, fd, 0);
+    if (mflags & DLU_MEM_HUGE_PAGES && block != MAP_FAILED && madvise(block, len, MADV_HUGEPAGE) == NEG_ONE)
+      dlu_log_me(DLU_WARNING, "[x] madvise: %s", strerror(errno));
+  }
+
   if (block == MAP_FAILED) {
     dlu_log_me(DLU_DANGER, "[x] mmap: %s", strerror(errno));
-    goto finish_alloc_mem_block;
+    stats_fail(get_block_stats(type));
+    if (fd != NEG_ONE) close(fd);
+    return NULL;
   }
 
-  block->next = NULL;
-  block->size = block->abytes = bytes;
+  if (mfd) *mfd = fd;
+
+  stats_add(get_block_stats(type), len - BLOCK_SIZE, BLOCK_SIZE);
+
+  /* Not fatal, RLIMIT_MEMLOCK is commonly small for unprivileged users */
+  if (mflags & DLU_MEM_LOCK && mlock(block, len) == NEG_ONE)
+    dlu_log_me(DLU_WARNING, "[x] mlock: %s", strerror(errno));
+
+  block->prev = NULL;
+  atomic_init(&block->next, NULL);
+  block->size = len - BLOCK_SIZE;
+  atomic_init(&block->abytes, block->size);
 
   /* Put saddr at an address that doesn't contain metadata */
   block->saddr = ((void*)block) + BLOCK_SIZE;
-finish_alloc_mem_block:
-  if (close(fd) == NEG_ONE)
-    dlu_log_me(DLU_DANGER, "[x] close: %s", strerror(errno));
+
   return block;
 }
 
@@ -156,82 +460,120 @@ finish_alloc_mem_block:
 * This function is reserve for one time use. Only used when allocating space for struct members
 * It works similiar to how sbrk works. Basically it creates a new block of memory, but it returns
 * the ending address of the previous block.
+*
+* Small block allocations are thread safe. If the calling thread created an arena with dlu_otta(3)
+* memory comes from there, otherwise (or once the arena is exhausted) the large block is bumped
+* with a CAS. Private large blocks may be requested more than once, each extra one is chained
+* after the existing blocks.
 */
 void *dlu_alloc(dlu_block_type type, size_t bytes) {
-  dlu_mem_block_t *nblock = NULL;
+  dlu_mem_block_t *nblock = NULL, *expected = NULL;
+  dlu_mem_block_t *_Atomic *large = NULL;
+  struct thread_arena *ta = NULL;
+  void *addr = NULL;
+  int fd = NEG_ONE;
 
-  /**
-  * This will create large block of memory
-  * Then create a linked list of smaller blocks from the larger one
-  * Retrieve last used memory block
-  * O(1) appending to end of linked-list
-  * reset linked list to starting address of linked list
-  */
-
-  /* TODO: Possible rewrite of switch statement */
   switch (type) {
     case DLU_LARGE_BLOCK_PRIV:
-      /* If large block allocated don't allocate another one */
-      if (large_block_priv) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return NULL; }
-
-      nblock = alloc_mem_block(type, bytes);
-      if (!nblock) return NULL;
-      large_block_priv = nblock;
-
-      /**
-      * Set small block allocation addr to address that
-      * doesn't include larger block metadata
-      */
-      small_block_priv = sstart_addr_priv = nblock->saddr;
+      large = &large_block_priv;
+      break;
+    case DLU_LARGE_BLOCK_SHARED:
+      large = &large_block_shared;
       break;
     case DLU_SMALL_BLOCK_PRIV:
-      /* If large block not allocated return NULL until allocated */
-      if (!large_block_priv) return NULL;
+      ta = &tarena_priv;
+      break;
+    case DLU_SMALL_BLOCK_SHARED:
+      ta = &tarena_shared;
+      break;
+    default: return NULL;
+  }
 
-      nblock = get_free_block(type, bytes);
-      if (!nblock) return NULL;
+  if (large) {
+    /* Only one shared large block may exist */
+    if (type == DLU_LARGE_BLOCK_SHARED && *large) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return NULL; }
+
+    nblock = alloc_mem_block(type, bytes, &fd);
+    if (!nblock) return NULL;
+
+    /* Start a new chain, if another thread raced us here chain onto theirs */
+    if (atomic_compare_exchange_strong(large, &expected, nblock)) {
+      if (type == DLU_LARGE_BLOCK_PRIV) cur_block_priv = nblock;
+      if (type == DLU_LARGE_BLOCK_SHARED) shared_fd = fd;
+      atomic_fetch_add_explicit(&block_gen, 1, memory_order_acq_rel);
+    } else if (type == DLU_LARGE_BLOCK_PRIV) {
+      append_large_block(expected, nblock);
+    } else {
+      stats_sub(get_block_stats(type), BLOCK_SIZE + nblock->size);
+      munmap(nblock, BLOCK_SIZE + nblock->size);
+      if (fd != NEG_ONE) close(fd);
+      PERR(DLU_ALREADY_ALLOC, 0, NULL);
+      return NULL;
+    }
 
-      /* set small block list to address of the previous block in the list */
-      small_block_priv = nblock->prev;
-      small_block_priv->next = nblock;
+    return nblock->saddr;
+  }
 
-      /* Move back to previous block (for return status) */
-      nblock = small_block_priv;
-      break;
-    case DLU_LARGE_BLOCK_SHARED:
-      /* If large block allocated don't allocate another one */
-      if (large_block_shared) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return NULL; }
-
-      nblock = alloc_mem_block(type, bytes);
-      if (!nblock) return NULL;
-      large_block_shared = nblock;
-
-      /**
-      * Set small block allocation addr to address that
-      * doesn't include larger block metadata
-      */
-      small_block_shared = sstart_addr_shared = nblock->saddr;
-      break;
-    case DLU_SMALL_BLOCK_SHARED:
-      /* If large block not allocated return NULL until allocated */
-      if (!large_block_shared) return NULL;
+  addr = get_thread_block(ta, bytes, 1);
+  if (addr) return addr;
 
-      nblock = get_free_block(type, bytes);
-      if (!nblock) return NULL;
+  /* If large block not allocated return NULL until allocated */
+  nblock = get_free_block(type, bytes, 1);
+  if (!nblock) return NULL;
 
-      /* set small block list to address of the previous block in the list */
-      small_block_shared = nblock->prev;
-      small_block_shared->next = nblock;
+  return nblock->saddr;
+}
 
-      /* Move back to previous block (for return status) */
-      nblock = small_block_shared;
-      break;
-    default: break;
+void *dlu_alloc_aligned(dlu_block_type type, size_t bytes, size_t align) {
+  dlu_mem_block_t *nblock = NULL;
+  struct thread_arena *ta = NULL;
+  void *addr = NULL;
+
+  switch (type) {
+    case DLU_SMALL_BLOCK_PRIV: ta = &tarena_priv; break;
+    case DLU_SMALL_BLOCK_SHARED: ta = &tarena_shared; break;
+    default: PERR(DLU_OP_NOT_PERMITED, 0, NULL); return NULL;
   }
 
+  if (!align || (align & (align - 1))) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return NULL; }
+
+  /* Thread arenas keep no metadata at all, consecutive arrays stay densely packed */
+  addr = get_thread_block(ta, bytes, align);
+  if (addr) return addr;
+
+  nblock = get_free_block(type, bytes, align);
+  if (!nblock) return NULL;
+
   return nblock->saddr;
 }
 
+bool dlu_otta(dlu_block_type type, size_t bytes) {
+  struct thread_arena *ta = NULL;
+
+  switch (type) {
+    case DLU_SMALL_BLOCK_PRIV: ta = &tarena_priv; break;
+    case DLU_SMALL_BLOCK_SHARED: ta = &tarena_shared; break;
+    default: PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false;
+  }
+
+  if (!get_large_block(type)) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+
+  /**
+  * Capture the generation before carving so a concurrent dlu_release_blocks(3)
+  * leaves this arena stale rather than pointing into unmapped pages
+  */
+  uint_fast64_t gen = atomic_load_explicit(&block_gen, memory_order_acquire);
+
+  dlu_mem_block_t *chunk = get_free_block(type, bytes, CACHE_LINE_SIZE);
+  if (!chunk) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+
+  ta->chunk = chunk;
+  ta->used = 0;
+  ta->gen = gen;
+
+  return true;
+}
+
 bool dlu_otma(dlu_block_type type, dlu_otma_mems ma) {
   size_t size = 0;
 
@@ -240,8 +582,8 @@ bool dlu_otma(dlu_block_type type, dlu_otma_mems ma) {
     return false;
   }
 
-  if (large_block_priv) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return false; }
-  if (large_block_shared) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return false; }
+  /* Private blocks chain onto the existing ones, see dlu_alloc(3) */
+  if (type == DLU_LARGE_BLOCK_SHARED && large_block_shared) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return false; }
 
   /* This allows for exact byte allocation. Resulting in no fragmented memory */
   size += (ma.inta_cnt) ? (BLOCK_SIZE + (ma.inta_cnt * sizeof(int))) : 0;
@@ -262,6 +604,7 @@ bool dlu_otma(dlu_block_type type, dlu_otma_mems ma) {
 
   size += (ma.si_cnt)   ? (BLOCK_SIZE + (ma.si_cnt * sizeof(VkCommandBuffer))) : 0;
   size += (ma.cmdd_cnt) ? (BLOCK_SIZE + (ma.cmdd_cnt * sizeof(struct _cmd_data))) : 0;
+  size += (ma.cb_cnt)   ? ((ma.cmdd_cnt * BLOCK_SIZE) + (ma.cb_cnt * sizeof(VkCommandBuffer))) : 0;
 
   size += (ma.bd_cnt) ? (BLOCK_SIZE + (ma.bd_cnt * sizeof(struct _buff_data))) : 0;
 
@@ -279,111 +622,200 @@ bool dlu_otma(dlu_block_type type, dlu_otma_mems ma) {
 
   size += (ma.dob_cnt) ? (BLOCK_SIZE + (ma.dob_cnt * sizeof(struct _drm_buff_data))) : 0;
 
+  size += (ma.rg_cnt) ? (ma.rg_cnt * (BLOCK_SIZE + sizeof(dlu_render_graph))) : 0;
+
+  /* Struct arrays from dlu_otba(3) start on a cache line, reserve the worst case padding */
+  size += (!!ma.scd_cnt + !!ma.gpd_cnt + !!ma.cmdd_cnt + !!ma.bd_cnt + !!ma.dd_cnt + !!ma.td_cnt +
+           !!ma.pd_cnt + !!ma.ld_cnt + !!ma.dod_cnt + !!ma.dob_cnt) * (CACHE_LINE_SIZE - 1);
+
+  /* The frame arena is a single sub-block holding every (FRAME_ALIGN rounded) slice */
+  size += (ma.fa_cnt) ? (BLOCK_SIZE + FRAME_ALIGN - 1 +
+                         (ma.fa_cnt * ((ma.fa_bytes + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1)))) : 0;
+
+  /**
+  * Slab pool metadata, the struct arrays themselves are reserved through their usual counts.
+  * Each pool may need up to FRAME_ALIGN - 1 bytes of padding in front and of rounding behind.
+  */
+  size += (ma.sp_cnt) ? (ma.sp_cnt * (BLOCK_SIZE + sizeof(dlu_slab_pool) + 2 * (FRAME_ALIGN - 1))) : 0;
+  size += (ma.spe_cnt * (sizeof(uint32_t) + sizeof(bool)));
+
+  /* Each thread arena is a single cache line aligned sub-block, allocations inside of it carry no metadata */
+  size += (ma.ta_cnt) ? (ma.ta_cnt * (BLOCK_SIZE + CACHE_LINE_SIZE - 1 + ma.ta_bytes)) : 0;
+
+  /* Only pay for the exit hook when someone asked for the dump */
+  static atomic_flag exit_hook = ATOMIC_FLAG_INIT;
+  if (getenv("DLU_MM_STATS") && !atomic_flag_test_and_set(&exit_hook))
+    atexit(dump_stats_at_exit);
+
+  if (type == DLU_LARGE_BLOCK_SHARED) mflags_shared = ma.mflags;
+  else mflags_priv = ma.mflags;
+
   if (!dlu_alloc(type, size)) return false;
 
   return true;
 }
 
-bool dlu_otba(dlu_data_type type, void *addr, uint32_t index, uint32_t arr_size) {
+/**
+* Put the slot at index back into the state dlu_otba(3) hands it out in.
+* Zero out the struct then populate the members used for error checking.
+*/
+static void reset_data(dlu_data_type type, void *addr, uint32_t i) {
   switch (type) {
     case DLU_SC_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->sc_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _sc_data));
-        if (!app->sc_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+        memset(&app->sc_data[i], 0, sizeof(struct _sc_data));
+        app->sc_data[i].ldi = UINT32_MAX;
+        break;
+      }
+    case DLU_GP_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->gp_data[i], 0, sizeof(struct _gp_data));
+        app->gp_data[i].ldi = UINT32_MAX;
+        break;
+      }
+    case DLU_CMD_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->cmd_data[i], 0, sizeof(struct _cmd_data));
+        app->cmd_data[i].ldi = UINT32_MAX;
+        break;
+      }
+    case DLU_BUFF_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->buff_data[i], 0, sizeof(struct _buff_data));
+        app->buff_data[i].ldi = UINT32_MAX;
+        break;
+      }
+    case DLU_DESC_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->desc_data[i], 0, sizeof(struct _desc_data));
+        app->desc_data[i].ldi = UINT32_MAX;
+        break;
+      }
+    case DLU_TEXT_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->text_data[i], 0, sizeof(struct _text_data));
+        app->text_data[i].ldi = UINT32_MAX;
+        break;
+      }
+    case DLU_PD_DATA:
+      {
+        /* need for dlu_create_queue_families(3) */
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->pd_data[i], 0, sizeof(struct _pd_data));
+        app->pd_data[i].gfam_idx = UINT32_MAX;
+        app->pd_data[i].cfam_idx = UINT32_MAX;
+        app->pd_data[i].tfam_idx = UINT32_MAX;
+        break;
+      }
+    case DLU_LD_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        memset(&app->ld_data[i], 0, sizeof(struct _ld_data));
+        app->ld_data[i].pdi = UINT32_MAX;
+        break;
+      }
+    case DLU_DEVICE_OUTPUT_DATA:
+      {
+        dlu_disp_core *core = (dlu_disp_core *) addr;
+        memset(&core->output_data[i], 0, sizeof(struct _output_data));
+        break;
+      }
+    case DLU_DEVICE_OUTPUT_BUFF_DATA:
+      {
+        dlu_disp_core *core = (dlu_disp_core *) addr;
+        memset(&core->buff_data[i], 0, sizeof(struct _drm_buff_data));
+        core->buff_data[i].fb_id = UINT32_MAX;
+        core->buff_data[i].odid = UINT32_MAX;
+        for (uint32_t j = 0; j < ARR_LEN(core->buff_data[i].dma_buf_fds); j++)
+          core->buff_data[i].dma_buf_fds[j] = NEG_ONE;
+        break;
+      }
+    default: break;
+  }
+}
 
-        /* Populate ldi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->sc_data[i].ldi = UINT32_MAX;
+/**
+* dlu_alloc(3) wrapper that keeps per dlu_data_type accounting. Top level struct
+* arrays are indexed every frame, so they start on a cache line.
+*/
+static void *otba_alloc(dlu_data_type type, size_t bytes) {
+  bool mems = (type == DLU_SC_DATA_MEMS || type == DLU_DESC_DATA_MEMS || type == DLU_GP_DATA_MEMS || type == DLU_CMD_DATA_MEMS);
+  size_t align = (mems) ? 1 : CACHE_LINE_SIZE;
+
+  /* Same as dlu_alloc_aligned(3), but only a block costs a header and alignment padding */
+  void *addr = get_thread_block(&tarena_priv, bytes, align);
+  if (addr) { stats_add(get_data_stats(type), bytes, 0); return addr; }
+
+  dlu_mem_block_t *block = get_free_block(DLU_SMALL_BLOCK_PRIV, bytes, align);
+  if (block) stats_add(get_data_stats(type), bytes, BLOCK_SIZE + (block->size - bytes));
+  else stats_fail(get_data_stats(type));
+
+  return (block) ? block->saddr : NULL;
+}
 
-        app->sdc = arr_size; return true;
+bool dlu_otba(dlu_data_type type, void *addr, uint32_t index, uint32_t arr_size) {
+  switch (type) {
+    case DLU_SC_DATA:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        app->sc_data = otba_alloc(type, arr_size * sizeof(struct _sc_data));
+        if (!app->sc_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+        app->sdc = arr_size; break;
       }
     case DLU_GP_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->gp_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _gp_data));
+        app->gp_data = otba_alloc(type, arr_size * sizeof(struct _gp_data));
         if (!app->gp_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* Populate ldi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->gp_data[i].ldi = UINT32_MAX;
-
-        app->gdc = arr_size; return true;
+        app->gdc = arr_size; break;
       }
     case DLU_CMD_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->cmd_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _cmd_data));
+        app->cmd_data = otba_alloc(type, arr_size * sizeof(struct _cmd_data));
         if (!app->cmd_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* Populate ldi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->cmd_data[i].ldi = UINT32_MAX;
-
-        app->cdc = arr_size; return true;
+        app->cdc = arr_size; break;
       }
     case DLU_BUFF_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->buff_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _buff_data));
+        app->buff_data = otba_alloc(type, arr_size * sizeof(struct _buff_data));
         if (!app->buff_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* Populate ldi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->buff_data[i].ldi = UINT32_MAX;
-
-        app->bdc = arr_size; return true;
+        app->bdc = arr_size; break;
       }
     case DLU_DESC_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->desc_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _desc_data));
+        app->desc_data = otba_alloc(type, arr_size * sizeof(struct _desc_data));
         if (!app->desc_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* Populate ldi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->gp_data[i].ldi = UINT32_MAX;
-
-        app->ddc = arr_size; return true;
+        app->ddc = arr_size; break;
       }
     case DLU_TEXT_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->text_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _text_data));
+        app->text_data = otba_alloc(type, arr_size * sizeof(struct _text_data));
         if (!app->text_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* Populate ldi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->gp_data[i].ldi = UINT32_MAX;
-
-        app->tdc = arr_size; return true;
+        app->tdc = arr_size; break;
       }
     case DLU_PD_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->pd_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _pd_data));
+        app->pd_data = otba_alloc(type, arr_size * sizeof(struct _pd_data));
         if (!app->pd_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* need for dlu_create_queue_families(3) */
-        for (uint32_t i = 0; i < arr_size; i++) {
-          app->pd_data[i].gfam_idx = UINT32_MAX;
-          app->pd_data[i].cfam_idx = UINT32_MAX;
-          app->pd_data[i].tfam_idx = UINT32_MAX;
-        }
-
-        app->pdc = arr_size; return true;
+        app->pdc = arr_size; break;
       }
     case DLU_LD_DATA:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->ld_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _ld_data));
+        app->ld_data = otba_alloc(type, arr_size * sizeof(struct _ld_data));
         if (!app->ld_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-
-        /* Populate pdi for error checking */
-        for (uint32_t i = 0; i < arr_size; i++)
-          app->ld_data[i].pdi = UINT32_MAX;
-
-        app->ldc = arr_size; return true;
+        app->ldc = arr_size; break;
       }
     case DLU_SC_DATA_MEMS:
       {
@@ -396,15 +828,15 @@ bool dlu_otba(dlu_data_type type, void *addr, uint32_t index, uint32_t arr_size)
         arr_size += 1;
 
         /* Allocate SwapChain Buffers (VkImage, VkImageView, VkFramebuffer) */
-        app->sc_data[index].sc_buffs = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _swap_chain_buffers));
+        app->sc_data[index].sc_buffs = otba_alloc(type, arr_size * sizeof(struct _swap_chain_buffers));
         if (!app->sc_data[index].sc_buffs) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
 
         /* Allocate CommandBuffers */
-        app->cmd_data[index].cmd_buffs = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(VkCommandBuffer));
+        app->cmd_data[index].cmd_buffs = otba_alloc(type, arr_size * sizeof(VkCommandBuffer));
         if (!app->cmd_data[index].cmd_buffs) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
 
         /* Allocate Semaphores */
-        app->sc_data[index].syncs = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _sync_fence) * sizeof(struct _sync_sem));
+        app->sc_data[index].syncs = otba_alloc(type, arr_size * sizeof(struct _sync_fence) * sizeof(struct _sync_sem));
         if (!app->sc_data[index].syncs) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
 
         app->sc_data[index].sic = arr_size; return true;
@@ -413,10 +845,10 @@ bool dlu_otba(dlu_data_type type, void *addr, uint32_t index, uint32_t arr_size)
       {
         vkcomp *app = (vkcomp *) addr;
 
-        app->desc_data[index].layouts = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(VkDescriptorSetLayout));
+        app->desc_data[index].layouts = otba_alloc(type, arr_size * sizeof(VkDescriptorSetLayout));
         if (!app->desc_data[index].layouts) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
 
-        app->desc_data[index].desc_set = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(VkDescriptorSet));
+        app->desc_data[index].desc_set = otba_alloc(type, arr_size * sizeof(VkDescriptorSet));
         if (!app->desc_data[index].desc_set) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
 
         app->desc_data[index].dlsc = arr_size; return true;
@@ -424,66 +856,391 @@ bool dlu_otba(dlu_data_type type, void *addr, uint32_t index, uint32_t arr_size)
     case DLU_GP_DATA_MEMS:
       {
         vkcomp *app = (vkcomp *) addr;
-        app->gp_data[index].graphics_pipelines = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(VkPipeline));
+        app->gp_data[index].graphics_pipelines = otba_alloc(type, arr_size * sizeof(VkPipeline));
         if (!app->gp_data[index].graphics_pipelines) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
         app->gp_data[index].gpc = arr_size; return true;
       }
+    case DLU_CMD_DATA_MEMS:
+      {
+        vkcomp *app = (vkcomp *) addr;
+        app->cmd_data[index].cmd_buffs = otba_alloc(type, arr_size * sizeof(VkCommandBuffer));
+        if (!app->cmd_data[index].cmd_buffs) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+        return true;
+      }
     case DLU_DEVICE_OUTPUT_DATA:
       {
         dlu_disp_core *core = (dlu_disp_core *) addr;
-        core->output_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _output_data));
+        core->output_data = otba_alloc(type, arr_size * sizeof(struct _output_data));
         if (!core->output_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
-        core->odc = arr_size; return true;
+        core->odc = arr_size; break;
       }
     case DLU_DEVICE_OUTPUT_BUFF_DATA:
       {
         dlu_disp_core *core = (dlu_disp_core *) addr;
-        core->buff_data = dlu_alloc(DLU_SMALL_BLOCK_PRIV, arr_size * sizeof(struct _drm_buff_data));
+        core->buff_data = otba_alloc(type, arr_size * sizeof(struct _drm_buff_data));
         if (!core->buff_data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+        core->odbc = arr_size; break;
+      }
+    default: return false;
+  }
 
-        for (uint32_t i = 0; i < arr_size; i++) {
-          core->buff_data[i].fb_id = UINT32_MAX;
-          core->buff_data[i].odid = UINT32_MAX;
-          for (uint32_t j = 0; j < ARR_LEN(core->buff_data[i].dma_buf_fds); j++)
-            core->buff_data[i].dma_buf_fds[j] = NEG_ONE;
-        }
+  /* Populate ldi, pdi, etc... for error checking */
+  for (uint32_t i = 0; i < arr_size; i++)
+    reset_data(type, addr, i);
 
-        core->odbc = arr_size; return true;
-      }
-    default: break;
+  return true;
+}
+
+dlu_slab_pool *dlu_otsa(dlu_data_type type, void *addr, uint32_t arr_size) {
+  dlu_slab_pool *pool = NULL;
+
+  switch (type) {
+    case DLU_BUFF_DATA: case DLU_DESC_DATA: case DLU_TEXT_DATA:
+    case DLU_DEVICE_OUTPUT_DATA: case DLU_DEVICE_OUTPUT_BUFF_DATA:
+      break;
+    default: PERR(DLU_OP_NOT_PERMITED, 0, NULL); return NULL;
+  }
+
+  /**
+  * Sub-blocks can't be handed back, so allot the array before the pool. If the pool
+  * can't be had the array is still a plain dlu_otba(3) array rather than orphaned memory.
+  */
+  if (!dlu_otba(type, addr, INDEX_IGNORE, arr_size)) return NULL;
+
+  /**
+  * One sub-block holds the pool, its free list, then its in use flags. Keep it on a
+  * FRAME_ALIGN boundary and a multiple of it, so the pool's pointers are never
+  * misaligned and neither is whatever gets carved after it.
+  */
+  size_t bytes = sizeof(dlu_slab_pool) + arr_size * (sizeof(uint32_t) + sizeof(bool));
+  bytes = (bytes + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+  pool = dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, bytes, FRAME_ALIGN);
+  if (!pool) { PERR(DLU_ALLOC_FAILED, 0, NULL); return NULL; }
+
+  pool->type = type;
+  pool->addr = addr;
+  pool->size = pool->fcnt = arr_size;
+  pool->in_use = (bool *) &pool->free_list[arr_size];
+
+  /* Hand out lower indices first */
+  for (uint32_t i = 0; i < arr_size; i++) {
+    pool->free_list[i] = arr_size - i - 1;
+    pool->in_use[i] = false;
+  }
+
+  return pool;
+}
+
+uint32_t dlu_slab_get(dlu_slab_pool *pool) {
+  if (!pool || !pool->fcnt) return UINT32_MAX;
+
+  uint32_t index = pool->free_list[--pool->fcnt];
+  pool->in_use[index] = true;
+
+  return index;
+}
+
+bool dlu_slab_put(dlu_slab_pool *pool, uint32_t index) {
+  if (!pool || index >= pool->size || !pool->in_use[index]) {
+    PERR(DLU_OP_NOT_PERMITED, 0, NULL);
+    return false;
   }
 
-  return false;
+  reset_data(pool->type, pool->addr, index);
+
+  pool->in_use[index] = false;
+  pool->free_list[pool->fcnt++] = index;
+
+  return true;
+}
+
+bool dlu_otfa(uint32_t frames, size_t bytes) {
+  if (!frames || !bytes) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+
+  /* Keep every slice aligned so the first allocation of each frame is as well */
+  bytes = (bytes + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+
+  uint_fast64_t gen = atomic_load_explicit(&block_gen, memory_order_acquire);
+
+  dlu_mem_block_t *block = get_free_block(DLU_SMALL_BLOCK_PRIV, frames * bytes, FRAME_ALIGN);
+  if (!block) { PERR(DLU_ALLOC_FAILED, 0, NULL); return false; }
+
+  farena.base = block->saddr;
+  farena.bytes = bytes;
+  farena.frames = frames;
+  farena.gen = gen;
+  atomic_store(&farena.cur, 0);
+  atomic_store(&farena.used, 0);
+  atomic_store(&farena.begun, false);
+
+  return true;
+}
+
+void dlu_frame_begin(uint32_t frame) {
+  if (!farena.base) return;
+  atomic_store_explicit(&farena.cur, frame % farena.frames, memory_order_relaxed);
+  atomic_store_explicit(&farena.used, 0, memory_order_release);
+  atomic_store_explicit(&farena.begun, true, memory_order_release);
+}
+
+void *dlu_frame_alloc(size_t bytes) {
+  if (!farena.base || farena.gen != atomic_load_explicit(&block_gen, memory_order_acquire)) return NULL;
+  if (!atomic_load_explicit(&farena.begun, memory_order_acquire)) return NULL;
+
+  bytes = (bytes + FRAME_ALIGN - 1) & ~(FRAME_ALIGN - 1);
+
+  size_t offset = atomic_fetch_add_explicit(&farena.used, bytes, memory_order_acq_rel);
+  if (offset + bytes > farena.bytes) return NULL;
+
+  return farena.base + (atomic_load_explicit(&farena.cur, memory_order_relaxed) * farena.bytes) + offset;
+}
+
+int dlu_shared_fd() {
+  return shared_fd;
+}
+
+bool dlu_send_shared_fd(int sock) {
+  char buf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg = {0};
+  struct cmsghdr *cmsg = NULL;
+  uint64_t size = 0;
+
+  if (shared_fd == NEG_ONE) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+
+  /* Send the size along so the receiver can check what it's mapping */
+  size = BLOCK_SIZE + large_block_shared->size;
+  struct iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+
+  memset(buf, 0, sizeof(buf));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = buf;
+  msg.msg_controllen = sizeof(buf);
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &shared_fd, sizeof(int));
+
+  if (sendmsg(sock, &msg, MSG_NOSIGNAL) == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] sendmsg: %s", strerror(errno));
+    return false;
+  }
+
+  return true;
+}
+
+int dlu_recv_shared_fd(int sock) {
+  char buf[CMSG_SPACE(sizeof(int))];
+  struct msghdr msg = {0};
+  struct cmsghdr *cmsg = NULL;
+  uint64_t size = 0;
+  int fd = NEG_ONE;
+
+  struct iovec iov = { .iov_base = &size, .iov_len = sizeof(size) };
+
+  memset(buf, 0, sizeof(buf));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = buf;
+  msg.msg_controllen = sizeof(buf);
+
+  if (recvmsg(sock, &msg, MSG_CMSG_CLOEXEC) == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] recvmsg: %s", strerror(errno));
+    return NEG_ONE;
+  }
+
+  cmsg = CMSG_FIRSTHDR(&msg);
+  if (!cmsg || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) {
+    dlu_log_me(DLU_DANGER, "[x] recvmsg: no file descriptor was passed");
+    return NEG_ONE;
+  }
+
+  memcpy(&fd, CMSG_DATA(cmsg), sizeof(int));
+
+  struct stat st;
+  if (fstat(fd, &st) == NEG_ONE || (uint64_t) st.st_size != size) {
+    dlu_log_me(DLU_DANGER, "[x] received shared block doesn't match its advertised size");
+    close(fd); return NEG_ONE;
+  }
+
+  return fd;
+}
+
+bool dlu_import_shared(int fd) {
+  dlu_mem_block_t *block = MAP_FAILED, *expected = NULL;
+  struct stat st;
+
+  if (large_block_shared) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return false; }
+
+  if (fstat(fd, &st) == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] fstat: %s", strerror(errno));
+    return false;
+  }
+
+  if ((size_t) st.st_size < BLOCK_SIZE) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+
+  block = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (block == MAP_FAILED) {
+    dlu_log_me(DLU_DANGER, "[x] mmap: %s", strerror(errno));
+    return false;
+  }
+
+  /* Header was written by the creator, sub-allocations bump the same abytes */
+  if (block->size != st.st_size - BLOCK_SIZE || !atomic_compare_exchange_strong(&large_block_shared, &expected, block)) {
+    munmap(block, st.st_size);
+    PERR(DLU_OP_NOT_PERMITED, 0, NULL);
+    return false;
+  }
+
+  shared_fd = fd;
+  atomic_fetch_add_explicit(&block_gen, 1, memory_order_acq_rel);
+
+  return true;
+}
+
+uint64_t dlu_shared_off(const void *addr) {
+  const void *base = large_block_shared;
+  if (!base || !addr || addr < base || addr >= base + BLOCK_SIZE + large_block_shared->size) return 0;
+  return (uint64_t) (addr - base);
+}
+
+void *dlu_shared_ptr(uint64_t off) {
+  void *base = large_block_shared;
+  if (!base || off < BLOCK_SIZE || off >= BLOCK_SIZE + large_block_shared->size) return NULL;
+  return base + off;
+}
+
+/* Sum counter idx of every shard, the peak is raised to the current total if that's higher */
+static void load_stats(bool block, uint32_t idx, dlu_mm_stats *stats) {
+  _Atomic uint64_t *peak = (block) ? &block_peaks[idx] : &data_peaks[idx];
+
+  memset(stats, 0, sizeof(dlu_mm_stats));
+  for (struct mm_shard *shard = atomic_load_explicit(&shards, memory_order_acquire); shard; shard = shard->next) {
+    struct mm_counters *c = (block) ? &shard->block[idx] : &shard->data[idx];
+    stats->requested += atomic_load_explicit(&c->requested, memory_order_relaxed);
+    stats->overhead += atomic_load_explicit(&c->overhead, memory_order_relaxed);
+    stats->in_use += atomic_load_explicit(&c->in_use, memory_order_relaxed);
+    stats->allocs += atomic_load_explicit(&c->allocs, memory_order_relaxed);
+    stats->failures += atomic_load_explicit(&c->failures, memory_order_relaxed);
+  }
+
+  stats->peak = atomic_load_explicit(peak, memory_order_relaxed);
+  while (stats->in_use > stats->peak && !atomic_compare_exchange_weak_explicit(peak, &stats->peak, stats->in_use,
+                                                                             memory_order_relaxed, memory_order_relaxed));
+  if (stats->in_use > stats->peak) stats->peak = stats->in_use;
+}
+
+bool dlu_mm_block_stats(dlu_block_type type, dlu_mm_stats *stats) {
+  int i = block_stats_idx(type);
+  if (i == NEG_ONE || !stats) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+  load_stats(true, i, stats);
+  return true;
+}
+
+bool dlu_mm_data_stats(dlu_data_type type, dlu_mm_stats *stats) {
+  int i = data_stats_idx(type);
+  if (i == NEG_ONE || !stats) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+  load_stats(false, i, stats);
+  return true;
+}
+
+static void dump_stats_group(int fd, const char *group, bool block, const char **names, uint32_t cnt, bool last) {
+  dlu_mm_stats stats;
+
+  dprintf(fd, "  \"%s\": {\n", group);
+  for (uint32_t i = 0; i < cnt; i++) {
+    load_stats(block, i, &stats);
+    dprintf(fd, "    \"%s\": { \"requested\": %" PRIu64 ", \"overhead\": %" PRIu64 ", \"in_use\": %" PRIu64
+                ", \"peak\": %" PRIu64 ", \"allocs\": %" PRIu64 ", \"failures\": %" PRIu64 " }%s\n",
+                names[i], stats.requested, stats.overhead, stats.in_use, stats.peak,
+                stats.allocs, stats.failures, (i + 1 < cnt) ? "," : "");
+  }
+  dprintf(fd, "  }%s\n", (last) ? "" : ",");
+}
+
+bool dlu_mm_dump_stats(int fd) {
+  if (fd < 0) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+
+  dprintf(fd, "{\n");
+  dump_stats_group(fd, "blocks", true, block_stats_names, BLOCK_STATS_CNT, false);
+  dump_stats_group(fd, "data", false, data_stats_names, DATA_STATS_CNT, true);
+  dprintf(fd, "}\n");
+
+  return true;
+}
+
+/* Registered with atexit(3), DLU_MM_STATS names the file to write to or "stderr" */
+static void dump_stats_at_exit() {
+  const char *path = getenv("DLU_MM_STATS");
+  if (!path) return;
+
+  if (!strcmp(path, "stderr")) { dlu_mm_dump_stats(STDERR_FILENO); return; }
+
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] open: %s", strerror(errno));
+    return;
+  }
+
+  dlu_mm_dump_stats(fd);
+
+  if (close(fd) == NEG_ONE)
+    dlu_log_me(DLU_DANGER, "[x] close: %s", strerror(errno));
 }
 
 /**
 * Releasing memory in this case means to
 * unmap all virtual pages (remove page tables)
+* Every thread arena is invalidated by bumping the block generation.
 */
 void dlu_release_blocks() {
-  if (large_block_priv) {
-    if (munmap(large_block_priv, BLOCK_SIZE + large_block_priv->size) == NEG_ONE) {
+  dlu_mem_block_t *block = NULL, *next = NULL;
+
+  atomic_fetch_add_explicit(&block_gen, 1, memory_order_acq_rel);
+
+  cur_block_priv = NULL;
+  for (block = atomic_exchange(&large_block_priv, NULL); block; block = next) {
+    next = block->next;
+    if (munmap(block, BLOCK_SIZE + block->size) == NEG_ONE)
       dlu_log_me(DLU_DANGER, "[x] munmap: %s", strerror(errno));
-      return;
-    }
-    large_block_priv = NULL;
   }
 
-  if (large_block_shared) {
-    if (munmap(large_block_shared, BLOCK_SIZE + large_block_shared->size) == NEG_ONE) {
-      dlu_log_me(DLU_DANGER, "[x] munmap: %s", strerror(errno));
-      return;
-    }
-    large_block_shared = NULL;
+  block = atomic_exchange(&large_block_shared, NULL);
+  mflags_priv = mflags_shared = DLU_MEM_DEFAULT;
+
+  /* Peaks and totals are kept across releases, only what's live is reset */
+  dlu_mm_stats stats;
+  for (uint32_t i = 0; i < BLOCK_STATS_CNT; i++) load_stats(true, i, &stats);
+  for (uint32_t i = 0; i < DATA_STATS_CNT; i++) load_stats(false, i, &stats);
+
+  for (struct mm_shard *shard = atomic_load(&shards); shard; shard = shard->next) {
+    for (uint32_t i = 0; i < BLOCK_STATS_CNT; i++) atomic_store(&shard->block[i].in_use, 0);
+    for (uint32_t i = 0; i < DATA_STATS_CNT; i++) atomic_store(&shard->data[i].in_use, 0);
   }
+
+  memset(&farena, 0, sizeof(farena));
+  if (block && munmap(block, BLOCK_SIZE + block->size) == NEG_ONE)
+    dlu_log_me(DLU_DANGER, "[x] munmap: %s", strerror(errno));
+
+  if (shared_fd != NEG_ONE && close(shared_fd) == NEG_ONE)
+    dlu_log_me(DLU_DANGER, "[x] close: %s", strerror(errno));
+  shared_fd = NEG_ONE;
 }
 
 /* This is an INAPI_CALL */
 void dlu_print_mb(dlu_block_type type) {
-  dlu_mem_block_t *current = (type == DLU_SMALL_BLOCK_SHARED) ? sstart_addr_shared : sstart_addr_priv;
-  while (current->next) {
-    dlu_log_me(DLU_INFO, "current block = %p, next block = %p, block size = %d, saddr = %p",
-                          current, current->next, current->size, current->saddr);
-    current = current->next;
+  for (dlu_mem_block_t *large = get_large_block(type); large; large = large->next) {
+    dlu_log_me(DLU_INFO, "large block = %p, block size = %zu, available bytes = %zu",
+                          large, large->size, atomic_load(&large->abytes));
+
+    size_t used = large->size - atomic_load(&large->abytes);
+    for (size_t offset = 0; offset < used; ) {
+      dlu_mem_block_t *current = ((void*)large) + BLOCK_SIZE + offset;
+      dlu_log_me(DLU_INFO, "current block = %p, block size = %zu, saddr = %p",
+                            current, current->size, current->saddr);
+      offset += BLOCK_SIZE + current->size;
+    }
   }
 }
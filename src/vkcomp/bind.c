@@ -67,6 +67,23 @@ void dlu_bind_vertex_buff_to_cmd_buff(
   vkCmdBindVertexBuffers(app->cmd_data[cur_pool].cmd_buffs[cur_buff], firstBinding, 1, &app->buff_data[cur_bd].buff, offsets);
 }
 
+void dlu_bind_vertex_buffs_to_cmd_buff(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t firstBinding,
+  uint32_t bindingCount,
+  const uint32_t *pBuffs,
+  const VkDeviceSize *offsets
+) {
+
+  VkBuffer *buffs = (VkBuffer *) alloca(bindingCount * sizeof(VkBuffer));
+  for (uint32_t i = 0; i < bindingCount; i++)
+    buffs[i] = app->buff_data[pBuffs[i]].buff;
+
+  vkCmdBindVertexBuffers(app->cmd_data[cur_pool].cmd_buffs[cur_buff], firstBinding, bindingCount, buffs, offsets);
+}
+
 void dlu_bind_index_buff_to_cmd_buff(
   vkcomp *app,
   uint32_t cur_pool,
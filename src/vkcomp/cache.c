@@ -0,0 +1,237 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#include <lucom.h>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+
+#define CACHE_MAGIC 0x43504c44 /* "DLPC" */
+#define CACHE_VERSION 1
+
+/**
+* Prepended to the data vkGetPipelineCacheData(3) returns. The driver's own header lacks
+* driverVersion, a driver update that keeps its cache UUID would otherwise hand back stale data.
+*/
+struct cache_header {
+  uint32_t magic;
+  uint32_t version;
+  uint32_t vendorID;
+  uint32_t deviceID;
+  uint32_t driverVersion;
+  uint8_t uuid[VK_UUID_SIZE];
+  uint32_t reserved;
+  uint64_t size; /* Bytes of cache data following the header */
+  uint64_t hash; /* FNV-1a of the cache data, catches truncated or torn files */
+};
+
+static void set_key(vkcomp *app, uint32_t cur_ld, struct cache_header *key) {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(app->pd_data[app->ld_data[cur_ld].pdi].phys_dev, &props);
+
+  memset(key, 0, sizeof(struct cache_header));
+  key->magic = CACHE_MAGIC;
+  key->version = CACHE_VERSION;
+  key->vendorID = props.vendorID;
+  key->deviceID = props.deviceID;
+  key->driverVersion = props.driverVersion;
+  memcpy(key->uuid, props.pipelineCacheUUID, VK_UUID_SIZE);
+}
+
+static bool read_all(int fd, void *buf, size_t size) {
+  for (ssize_t n = 0; size; buf += n, size -= n) {
+    n = read(fd, buf, size);
+    if (n == NEG_ONE && errno == EINTR) { n = 0; continue; }
+    if (n <= 0) return false;
+  }
+  return true;
+}
+
+static bool write_all(int fd, const void *buf, size_t size) {
+  for (ssize_t n = 0; size; buf += n, size -= n) {
+    n = write(fd, buf, size);
+    if (n == NEG_ONE && errno == EINTR) { n = 0; continue; }
+    if (n <= 0) return false;
+  }
+  return true;
+}
+
+/* Returns the cache data saved at path, NULL if there is none or it doesn't belong to key's device */
+static void *read_cache(const char *path, const struct cache_header *key, size_t *size) {
+  struct cache_header hdr;
+  struct stat st;
+  void *data = NULL;
+
+  int fd = open(path, O_RDONLY | O_CLOEXEC);
+  if (fd == NEG_ONE) {
+    if (errno != ENOENT) dlu_log_me(DLU_WARNING, "[x] open: %s: %s", path, strerror(errno));
+    return NULL;
+  }
+
+  if (fstat(fd, &st) == NEG_ONE || !read_all(fd, &hdr, sizeof(hdr))) {
+    dlu_log_me(DLU_WARNING, "Pipeline cache %s: unreadable header, ignoring it", path);
+    goto exit_close;
+  }
+
+  if (hdr.magic != key->magic || hdr.version != key->version || hdr.vendorID != key->vendorID ||
+      hdr.deviceID != key->deviceID || hdr.driverVersion != key->driverVersion || memcmp(hdr.uuid, key->uuid, VK_UUID_SIZE)) {
+    dlu_log_me(DLU_WARNING, "Pipeline cache %s: written by another device or driver, ignoring it", path);
+    goto exit_close;
+  }
+
+  if (!hdr.size || (uint64_t) st.st_size != sizeof(hdr) + hdr.size) {
+    dlu_log_me(DLU_WARNING, "Pipeline cache %s: size mismatch, ignoring it", path);
+    goto exit_close;
+  }
+
+  data = malloc(hdr.size);
+  if (!data) { PERR(DLU_ALLOC_FAILED, 0, NULL); goto exit_close; }
+
+  if (!read_all(fd, data, hdr.size) || hash_bytes(DLU_HASH_SEED, data, hdr.size) != hdr.hash) {
+    dlu_log_me(DLU_WARNING, "Pipeline cache %s: corrupted, ignoring it", path);
+    free(data); data = NULL;
+    goto exit_close;
+  }
+
+  *size = hdr.size;
+
+exit_close:
+  close(fd);
+  return data;
+}
+
+static VkResult merge_cache(vkcomp *app, size_t size, const void *data) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  VkDevice device = app->ld_data[app->gp_cache.ldi].device;
+  VkPipelineCache src = VK_NULL_HANDLE;
+
+  VkPipelineCacheCreateInfo create_info = {};
+  create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+  create_info.pNext = NULL;
+  create_info.flags = 0;
+  create_info.initialDataSize = size;
+  create_info.pInitialData = data;
+
+  res = vkCreatePipelineCache(device, &create_info, NULL, &src);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreatePipelineCache"); return res; }
+
+  res = vkMergePipelineCaches(device, app->gp_cache.pipe_cache, 1, &src);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkMergePipelineCaches");
+
+  vkDestroyPipelineCache(device, src, NULL);
+
+  return res;
+}
+
+VkResult dlu_load_pipeline_cache(vkcomp *app, uint32_t cur_ld, const char *path, bool *loaded) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct cache_header key;
+  size_t size = 0;
+
+  if (!app->ld_data[cur_ld].device) { PERR(DLU_VKCOMP_DEVICE, 0, NULL); return res; }
+  if (app->gp_cache.pipe_cache && app->gp_cache.ldi != cur_ld) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  set_key(app, cur_ld, &key);
+  void *data = read_cache(path, &key, &size);
+
+  if (!app->gp_cache.pipe_cache)
+    res = dlu_create_pipeline_cache(app, cur_ld, size, data);
+  else
+    res = (data) ? merge_cache(app, size, data) : VK_SUCCESS;
+
+  if (loaded) *loaded = (!res && data);
+  free(data);
+
+  return res;
+}
+
+VkResult dlu_save_pipeline_cache(vkcomp *app, const char *path) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct cache_header hdr;
+  char tmp_path[PATH_MAX];
+  size_t size = 0;
+  void *data = NULL;
+
+  if (!app->gp_cache.pipe_cache) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  VkDevice device = app->ld_data[app->gp_cache.ldi].device;
+  set_key(app, app->gp_cache.ldi, &hdr);
+
+  /* Keep what other processes sharing the file saved since we loaded it */
+  data = read_cache(path, &hdr, &size);
+  if (data) {
+    res = merge_cache(app, size, data);
+    free(data); data = NULL;
+    if (res) return res;
+  }
+
+  res = vkGetPipelineCacheData(device, app->gp_cache.pipe_cache, &size, NULL);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkGetPipelineCacheData"); return res; }
+
+  data = malloc(size);
+  if (!data) { PERR(DLU_ALLOC_FAILED, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  res = vkGetPipelineCacheData(device, app->gp_cache.pipe_cache, &size, data);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkGetPipelineCacheData"); goto exit_free; }
+
+  hdr.size = size;
+  hdr.hash = hash_bytes(DLU_HASH_SEED, data, size);
+  res = VK_RESULT_MAX_ENUM;
+
+  if (snprintf(tmp_path, sizeof(tmp_path), "%s.%d.tmp", path, getpid()) >= (int) sizeof(tmp_path)) {
+    PERR(DLU_OP_NOT_PERMITED, 0, NULL);
+    goto exit_free;
+  }
+
+  int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] open: %s: %s", tmp_path, strerror(errno));
+    goto exit_free;
+  }
+
+  /* Data has to hit the disk before the rename, or a crash could leave an empty file at path */
+  bool written = write_all(fd, &hdr, sizeof(hdr)) && write_all(fd, data, size) && fsync(fd) != NEG_ONE;
+  if (!written) dlu_log_me(DLU_DANGER, "[x] write: %s: %s", tmp_path, strerror(errno));
+
+  if (close(fd) == NEG_ONE && written) {
+    dlu_log_me(DLU_DANGER, "[x] close: %s", strerror(errno));
+    written = false;
+  }
+
+  if (written && rename(tmp_path, path) == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] rename: %s: %s", path, strerror(errno));
+    written = false;
+  }
+
+  if (!written) { unlink(tmp_path); goto exit_free; }
+
+  res = VK_SUCCESS;
+
+exit_free:
+  free(data);
+  return res;
+}
@@ -25,6 +25,9 @@
 #define LUCUR_VKCOMP_API
 #include <lucom.h>
 
+#include <stdatomic.h>
+#include <pthread.h>
+
 /**
 * alloca()'s usage here is meant for stack space efficiency
 * Fixed size arrays tend to over allocate, while alloca will
@@ -76,7 +79,12 @@ VkResult dlu_create_instance(
 
   /* Create the instance */
   res = vkCreateInstance(&create_info, NULL, &app->instance);
-  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreateInstance")
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateInstance"); return res; }
+
+  /* Needed to query VK_EXT_memory_budget heap budgets on a Vulkan 1.0 instance */
+  for (uint32_t i = 0; i < enabledExtensionCount; i++)
+    if (!strcmp(ppEnabledExtensionNames[i], VK_KHR_GET_PHYSICAL_DEVICE_PROPERTIES_2_EXTENSION_NAME))
+      DLU_DR_INSTANCE_PROC_ADDR(app->instance, app->get_mem_props2, GetPhysicalDeviceMemoryProperties2KHR)
 
   return res;
 }
@@ -136,6 +144,7 @@ VkResult dlu_create_physical_device(
     vkGetPhysicalDeviceFeatures(devices[i], device_feats); /* Query device features */
     if (device_props->deviceType == vkpdtype) {
       memmove(&app->pd_data[cur_pd].phys_dev, &devices[i], sizeof(devices[i]));
+      vkGetPhysicalDeviceMemoryProperties(devices[i], &app->pd_data[cur_pd].mem_props);
       dlu_log_me(DLU_SUCCESS, "Suitable GPU Found: %s", device_props->deviceName);
       break;
     }
@@ -186,7 +195,13 @@ VkBool32 dlu_create_queue_families(vkcomp *app, uint32_t cur_pd, VkQueueFlagBits
         dlu_log_me(DLU_SUCCESS, "Physical Device Queue Family Index %d has support for commute operations", i);
       }
 
-      if (vkqfbits & VK_QUEUE_TRANSFER_BIT && app->pd_data[cur_pd].tfam_idx == UINT32_MAX) {
+      /**
+      * Graphics and compute families implicitly support transfers. Prefer a transfer
+      * only family though, usually backed by a DMA engine that copies without stalling graphics work
+      */
+      const VkQueueFlags gc_bits = VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT;
+      if (vkqfbits & VK_QUEUE_TRANSFER_BIT && (app->pd_data[cur_pd].tfam_idx == UINT32_MAX ||
+          (!(queue_families[i].queueFlags & gc_bits) && queue_families[app->pd_data[cur_pd].tfam_idx].queueFlags & gc_bits))) {
         /* Retrieve Transfer Family Queue index */
         app->pd_data[cur_pd].tfam_idx = i; ret = VK_FALSE;
         dlu_log_me(DLU_SUCCESS, "Physical Device Queue Family Index %d has support for transfer operations", i);
@@ -226,6 +241,15 @@ VkResult dlu_create_logical_device(
   create_info.ppEnabledExtensionNames = ppEnabledExtensionNames;
   create_info.pEnabledFeatures = pEnabledFeatures;
 
+  /* The extension alone doesn't turn timeline semaphores on, the feature has to be too */
+  VkPhysicalDeviceTimelineSemaphoreFeaturesKHR timeline_feats = {};
+  timeline_feats.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES_KHR;
+  timeline_feats.timelineSemaphore = VK_TRUE;
+
+  for (uint32_t i = 0; i < enabledExtensionCount; i++)
+    if (!strcmp(ppEnabledExtensionNames[i], VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME))
+      create_info.pNext = &timeline_feats;
+
   /* Create logic device */
   res = vkCreateDevice(app->pd_data[cur_pd].phys_dev, &create_info, NULL, &app->ld_data[cur_ld].device);
   if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateDevice"); return res; }
@@ -233,6 +257,17 @@ VkResult dlu_create_logical_device(
   /* Associate a logical device with a given physical */
   app->ld_data[cur_ld].pdi = cur_pd;
 
+  for (uint32_t i = 0; i < enabledExtensionCount; i++) {
+    if (!strcmp(ppEnabledExtensionNames[i], VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+      app->pd_data[cur_pd].mem_budget = true;
+    if (!strcmp(ppEnabledExtensionNames[i], VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME))
+      DLU_DR_DEVICE_PROC_ADDR(app->ld_data[cur_ld].device, app->ld_data[cur_ld].draw_indexed_indirect_count, CmdDrawIndexedIndirectCountKHR)
+    if (!strcmp(ppEnabledExtensionNames[i], VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME)) {
+      DLU_DR_DEVICE_PROC_ADDR(app->ld_data[cur_ld].device, app->ld_data[cur_ld].wait_sems, WaitSemaphoresKHR)
+      DLU_DR_DEVICE_PROC_ADDR(app->ld_data[cur_ld].device, app->ld_data[cur_ld].get_sem_value, GetSemaphoreCounterValueKHR)
+    }
+  }
+
   return res;
 }
 
@@ -327,12 +362,17 @@ VkResult dlu_create_swap_chain(
   return res;
 }
 
-VkResult dlu_create_depth_buff(
+/**
+* Transient attachments (depth, multisampled color) never leave tile memory on tiled GPUs.
+* Prefer lazily allocated memory for them, dlu_vk_mem_alloc(3) drops the bit if no memory type has it
+*/
+static VkResult create_attachment(
   vkcomp *app,
   uint32_t cur_scd,
   VkImageCreateInfo *img_info,
   VkImageViewCreateInfo *ivi,
-  VkMemoryPropertyFlags requirements_mask
+  VkMemoryPropertyFlags requirements_mask,
+  struct _attachment_buffer *attach
 ) {
 
   VkResult res = VK_RESULT_MAX_ENUM;
@@ -340,8 +380,10 @@ VkResult dlu_create_depth_buff(
   if (!app->sc_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_SC_DATA"); return res; }
   if (app->sc_data[cur_scd].ldi == UINT32_MAX) { PERR(DLU_VKCOMP_DEVICE_NOT_ASSOC, 0, "dlu_create_swap_chain()"); return res; }
 
+  VkDevice device = app->ld_data[app->sc_data[cur_scd].ldi].device;
+
   /* Create image object */
-  res = vkCreateImage(app->ld_data[app->sc_data[cur_scd].ldi].device, img_info, NULL, &app->sc_data[cur_scd].depth.image);
+  res = vkCreateImage(device, img_info, NULL, &attach->image);
   if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateImage"); return res; }
 
   /**
@@ -352,42 +394,68 @@ VkResult dlu_create_depth_buff(
   * memory for an image.
   */
   VkMemoryRequirements mem_reqs;
-  vkGetImageMemoryRequirements(app->ld_data[app->sc_data[cur_scd].ldi].device, app->sc_data[cur_scd].depth.image, &mem_reqs);
-
-  VkMemoryAllocateInfo mem_alloc = {};
-  mem_alloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  mem_alloc.pNext = NULL;
-  mem_alloc.allocationSize = mem_reqs.size;
-  mem_alloc.memoryTypeIndex = 0;
-
-  VkBool32 pass; /* find a suitable memory type for depth bufffer */
-  pass = memory_type_from_properties(app, app->ld_data[app->sc_data[cur_scd].ldi].pdi, mem_reqs.memoryTypeBits, requirements_mask, &mem_alloc.memoryTypeIndex);
-  if (!pass) {
-    dlu_log_me(DLU_DANGER, "[x] memory_type_from_properties failed");
-    return pass;
-  }
+  vkGetImageMemoryRequirements(device, attach->image, &mem_reqs);
 
-  /* Allocate memory */
-  res = vkAllocateMemory(app->ld_data[app->sc_data[cur_scd].ldi].device, &mem_alloc, NULL, &app->sc_data[cur_scd].depth.mem);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateMemory"); return res; }
+  if (img_info->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+    requirements_mask |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
 
-  /**
-  * Associate the memory allocated with the VkImage resource.
-  * It is easier to attach the entire VkDeviceMemory to the VkImage resource
-  * So offset will always be zero whenever a call to vkBind*Memory is called
-  */
-  res = vkBindImageMemory(app->ld_data[app->sc_data[cur_scd].ldi].device, app->sc_data[cur_scd].depth.image, app->sc_data[cur_scd].depth.mem, 0);
+  /* Sub-allocate from a block of a suitable memory type for the attachment */
+  res = dlu_vk_mem_alloc(app, app->sc_data[cur_scd].ldi, &mem_reqs, requirements_mask, img_info->tiling == VK_IMAGE_TILING_OPTIMAL,
+                         &attach->mem, &attach->offset, &attach->size, NULL);
+  if (res) return res;
+
+  /* Associate the memory allocated with the VkImage resource */
+  res = vkBindImageMemory(device, attach->image, attach->mem, attach->offset);
   if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBindImageMemory"); return res; }
 
+  /* Create an image view object for the attachment */
+  ivi->image = attach->image;
+  res = vkCreateImageView(device, ivi, NULL, &attach->view);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreateImageView")
+
+  return res;
+}
+
+VkResult dlu_create_depth_buff(
+  vkcomp *app,
+  uint32_t cur_scd,
+  VkImageCreateInfo *img_info,
+  VkImageViewCreateInfo *ivi,
+  VkMemoryPropertyFlags requirements_mask
+) {
+
   if (ivi->format == VK_FORMAT_D16_UNORM_S8_UINT || ivi->format == VK_FORMAT_D24_UNORM_S8_UINT || ivi->format == VK_FORMAT_D32_SFLOAT_S8_UINT)
     ivi->subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
 
-  /* Create an image view object for depth buffer */
-  ivi->image = app->sc_data[cur_scd].depth.image;
-  res = vkCreateImageView(app->ld_data[app->sc_data[cur_scd].ldi].device, ivi, NULL, &app->sc_data[cur_scd].depth.view);
-  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreateImageView")
- 
-  return res;
+  return create_attachment(app, cur_scd, img_info, ivi, requirements_mask, &app->sc_data[cur_scd].depth);
+}
+
+VkResult dlu_create_msaa_buff(
+  vkcomp *app,
+  uint32_t cur_scd,
+  VkImageCreateInfo *img_info,
+  VkImageViewCreateInfo *ivi,
+  VkMemoryPropertyFlags requirements_mask
+) {
+
+  if (img_info->samples == VK_SAMPLE_COUNT_1_BIT) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  return create_attachment(app, cur_scd, img_info, ivi, requirements_mask, &app->sc_data[cur_scd].msaa);
+}
+
+VkSampleCountFlagBits dlu_get_max_sample_count(vkcomp *app, uint32_t cur_pd) {
+  VkPhysicalDeviceProperties props;
+  vkGetPhysicalDeviceProperties(app->pd_data[cur_pd].phys_dev, &props);
+
+  /* Has to work for both the color and depth attachment */
+  VkSampleCountFlags counts = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+  VkSampleCountFlagBits bits[] = { VK_SAMPLE_COUNT_64_BIT, VK_SAMPLE_COUNT_32_BIT, VK_SAMPLE_COUNT_16_BIT,
+                                   VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT };
+
+  for (uint32_t i = 0; i < ARR_LEN(bits); i++)
+    if (counts & bits[i]) return bits[i];
+
+  return VK_SAMPLE_COUNT_1_BIT;
 }
 
 VkResult dlu_create_vk_buffer(
@@ -426,30 +494,46 @@ VkResult dlu_create_vk_buffer(
   VkMemoryRequirements mem_reqs;
   vkGetBufferMemoryRequirements(app->ld_data[cur_ld].device, app->buff_data[cur_bd].buff, &mem_reqs);
 
-  VkMemoryAllocateInfo alloc_info = {};
-  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  alloc_info.pNext = NULL;
-  alloc_info.allocationSize = mem_reqs.size;
-  alloc_info.memoryTypeIndex = 0;
-
-  /* find a suitable memory type for VkBuffer */
-  res = memory_type_from_properties(app, app->ld_data[cur_ld].pdi, mem_reqs.memoryTypeBits, requirements_mask, &alloc_info.memoryTypeIndex);
-  if (!res) { PERR(DLU_MEM_TYPE_ERR, 0, NULL) return res; }
-
-  res = vkAllocateMemory(app->ld_data[cur_ld].device, &alloc_info, NULL, &app->buff_data[cur_bd].mem);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateMemory"); return res; }
-
   /**
-  * Associate the memory allocated with the VkBuffer resource.
-  * It is easier to attach the entire VkDeviceMemory to the VkBuffer resource
-  * So offset will always be zero whenever a call to vkBind*Memory is called
+  * Sub-allocate from a block of a suitable memory type for VkBuffer.
+  * Thousands of buffers only cost a handful of vkAllocateMemory calls.
   */
-  res = vkBindBufferMemory(app->ld_data[cur_ld].device, app->buff_data[cur_bd].buff, app->buff_data[cur_bd].mem, 0);
+  res = dlu_vk_mem_alloc(app, cur_ld, &mem_reqs, requirements_mask, false, &app->buff_data[cur_bd].mem,
+                         &app->buff_data[cur_bd].offset, &app->buff_data[cur_bd].size, &app->buff_data[cur_bd].mapped);
+  if (res) return res;
+
+  /* Associate the memory allocated with the VkBuffer resource */
+  res = vkBindBufferMemory(app->ld_data[cur_ld].device, app->buff_data[cur_bd].buff, app->buff_data[cur_bd].mem, app->buff_data[cur_bd].offset);
   if (res) PERR(DLU_VK_FUNC_ERR, res, "vkBindBufferMemory")
 
   return res;
 }
 
+VkResult dlu_create_instance_stream(
+  vkcomp *app,
+  uint32_t cur_ld,
+  uint32_t cur_bd,
+  VkDeviceSize instanceSize,
+  uint32_t maxInstances,
+  uint32_t frameCount
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  /* Every slice starts 256 byte aligned, frames never share a cache line */
+  VkDeviceSize frame_size = ((instanceSize * maxInstances) + 255) & ~((VkDeviceSize) 255);
+
+  res = dlu_create_vk_buffer(app, cur_ld, cur_bd, frame_size * frameCount, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                             VK_SHARING_MODE_EXCLUSIVE, 0, NULL, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+  if (res) return res;
+
+  if (!app->buff_data[cur_bd].mapped) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  app->buff_data[cur_bd].frame_size = frame_size;
+
+  return res;
+}
+
 VkResult dlu_create_framebuffers(
   vkcomp *app,
   uint32_t cur_scd,
@@ -535,6 +619,34 @@ VkResult dlu_create_cmd_buffs(
   return res;
 }
 
+VkResult dlu_create_frame_cmd_pool(
+  vkcomp *app,
+  uint32_t cur_ld,
+  uint32_t cur_pool,
+  uint32_t queueFamilyIndex
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->cmd_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_CMD_DATA"); return res; }
+  if (!app->cmd_data[cur_pool].cmd_buffs) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_CMD_DATA_MEMS"); return res; }
+
+  res = dlu_create_cmd_pool(app, cur_ld, cur_pool, queueFamilyIndex, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+  if (res) return res;
+
+  VkCommandBufferAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.pNext = NULL;
+  alloc_info.commandPool = app->cmd_data[cur_pool].cmd_pool;
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  alloc_info.commandBufferCount = 1;
+
+  res = vkAllocateCommandBuffers(app->ld_data[cur_ld].device, &alloc_info, app->cmd_data[cur_pool].cmd_buffs);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkAllocateCommandBuffers")
+
+  return res;
+}
+
 /**
 * (This comment is for me)
 * Use a image semaphore to signal that an image
@@ -573,6 +685,65 @@ VkResult dlu_create_syncs(vkcomp *app, uint32_t cur_scd) {
   return res;
 }
 
+VkResult dlu_create_timelines(vkcomp *app, uint32_t cur_ld) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->ld_data[cur_ld].device) { PERR(DLU_VKCOMP_DEVICE, 0, NULL); return res; }
+  if (!app->ld_data[cur_ld].wait_sems) { PERR(DLU_DR_DEVICE_PROC_ADDR_ERR, 0, "WaitSemaphoresKHR"); return res; }
+
+  VkQueue queues[DLU_VK_QUEUE_CNT] = {
+    [DLU_VK_GRAPHICS_QUEUE] = app->ld_data[cur_ld].graphics,
+    [DLU_VK_TRANSFER_QUEUE] = app->ld_data[cur_ld].transfer,
+    [DLU_VK_COMPUTE_QUEUE] = app->ld_data[cur_ld].compute
+  };
+
+  VkSemaphoreTypeCreateInfoKHR type_info = {};
+  type_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO_KHR;
+  type_info.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE_KHR;
+  type_info.initialValue = 0;
+
+  VkSemaphoreCreateInfo sem_info = {};
+  sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  sem_info.pNext = &type_info;
+  sem_info.flags = 0;
+
+  for (uint32_t i = 0; i < DLU_VK_QUEUE_CNT; i++) {
+    if (!queues[i] || app->ld_data[cur_ld].timelines[i].sem) continue;
+
+    res = vkCreateSemaphore(app->ld_data[cur_ld].device, &sem_info, NULL, &app->ld_data[cur_ld].timelines[i].sem);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateSemaphore"); return res; }
+    app->ld_data[cur_ld].timelines[i].value = 0;
+  }
+
+  return (app->ld_data[cur_ld].timelines[DLU_VK_GRAPHICS_QUEUE].sem) ? VK_SUCCESS : res;
+}
+
+VkResult dlu_create_sem_pool(vkcomp *app, uint32_t cur_scd) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->sc_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_SC_DATA"); return res; }
+
+  VkSemaphoreCreateInfo sem_info = {};
+  sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+  sem_info.pNext = NULL;
+  sem_info.flags = 0;
+
+  for (uint32_t i = 0; i < DLU_VK_SEM_POOL_CNT; i++) {
+    struct _sem_pool *entry = &app->sc_data[cur_scd].sem_pool[i];
+
+    res = vkCreateSemaphore(app->ld_data[app->sc_data[cur_scd].ldi].device, &sem_info, NULL, &entry->sem);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateSemaphore"); return res; }
+
+    entry->value = 0;
+    entry->img = UINT32_MAX;
+    entry->in_use = false;
+  }
+
+  app->sc_data[cur_scd].acquire = app->sc_data[cur_scd].present = UINT32_MAX;
+
+  return res;
+}
+
 VkShaderModule dlu_create_shader_module(vkcomp *app, uint32_t cur_ld, char *code, size_t code_size) {
 
   VkResult err = VK_RESULT_MAX_ENUM;
@@ -590,7 +761,10 @@ VkShaderModule dlu_create_shader_module(vkcomp *app, uint32_t cur_ld, char *code
   err = vkCreateShaderModule(app->ld_data[cur_ld].device, &create_info, NULL, &shader_module);
   if (err) PERR(DLU_VK_FUNC_ERR, err, "vkCreateShaderModule");
 
-  if (err == VK_SUCCESS) dlu_log_me(DLU_SUCCESS, "Shader module successfully created");
+  if (err == VK_SUCCESS) {
+    set_obj_hash(app, (uint64_t) shader_module, hash_bytes(DLU_HASH_SEED, code, code_size));
+    dlu_log_me(DLU_SUCCESS, "Shader module successfully created");
+  }
 
   return shader_module;
 }
@@ -625,7 +799,9 @@ VkResult dlu_create_render_pass(
   render_pass_info.pDependencies = pDependencies;
 
   res = vkCreateRenderPass(app->ld_data[app->gp_data[cur_gpd].ldi].device, &render_pass_info, NULL, &app->gp_data[cur_gpd].render_pass);
-  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreateRenderPass");
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateRenderPass"); return res; }
+
+  set_obj_hash(app, (uint64_t) app->gp_data[cur_gpd].render_pass, hash_render_pass_info(&render_pass_info));
 
   return res;
 }
@@ -675,8 +851,204 @@ VkResult dlu_create_graphics_pipelines(
   pipeline_info.basePipelineHandle = basePipelineHandle;
   pipeline_info.basePipelineIndex = basePipelineIndex;
 
-  res = vkCreateGraphicsPipelines(app->ld_data[app->gp_data[cur_gpd].ldi].device, app->gp_cache.pipe_cache, 1, &pipeline_info, NULL, app->gp_data[cur_gpd].graphics_pipelines);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateGraphicsPipelines"); }
+  /**
+  * Whatever the slot held is released only after the new pipeline was taken,
+  * so recreating the same state never destroys and compiles it again.
+  */
+  uint32_t cur_ld = app->gp_data[cur_gpd].ldi;
+  VkPipeline old = app->gp_data[cur_gpd].graphics_pipelines[0];
+
+  /* Identical state was compiled before, share that pipeline */
+  dlu_pipe_key key;
+  get_pipe_key(app, cur_ld, &pipeline_info, &key);
+  app->gp_data[cur_gpd].graphics_pipelines[0] = get_shared_pipeline(app, cur_ld, &key);
+
+  if (!app->gp_data[cur_gpd].graphics_pipelines[0]) {
+    res = vkCreateGraphicsPipelines(app->ld_data[cur_ld].device, app->gp_cache.pipe_cache, 1, &pipeline_info, NULL, app->gp_data[cur_gpd].graphics_pipelines);
+    if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreateGraphicsPipelines")
+
+    /* No-op if creation failed, the slot was left VK_NULL_HANDLE */
+    add_shared_pipeline(app, cur_ld, &key, app->gp_data[cur_gpd].graphics_pipelines[0]);
+  } else {
+    res = VK_SUCCESS;
+  }
+
+  free_pipe_key(&key);
+  release_pipeline(app, cur_ld, old);
+
+  return res;
+}
+
+struct pipeline_batch {
+  VkDevice device;
+  VkPipelineCache cache;
+  VkPipelineLayout layout;
+  VkRenderPass render_pass;
+  const VkGraphicsPipelineCreateInfo *infos;
+  VkPipeline *pipelines;
+  const uint32_t *order; /* Indices of the infos to compile, duplicates are left out */
+  uint32_t count;
+  atomic_uint next;
+  atomic_int res;
+};
+
+static VkGraphicsPipelineCreateInfo get_batch_info(struct pipeline_batch *batch, uint32_t i) {
+  VkGraphicsPipelineCreateInfo pipeline_info = batch->infos[i];
+  if (!pipeline_info.layout) pipeline_info.layout = batch->layout;
+  if (!pipeline_info.renderPass) pipeline_info.renderPass = batch->render_pass;
+  return pipeline_info;
+}
+
+/* Workers pull one create info at a time so a slow variant doesn't hold up a whole chunk */
+static void *create_pipeline_worker(void *arg) {
+  struct pipeline_batch *batch = (struct pipeline_batch *) arg;
+  uint32_t k = 0;
+
+  while ((k = atomic_fetch_add_explicit(&batch->next, 1, memory_order_relaxed)) < batch->count) {
+    if (atomic_load_explicit(&batch->res, memory_order_relaxed)) break;
+
+    uint32_t i = batch->order[k];
+    VkGraphicsPipelineCreateInfo pipeline_info = get_batch_info(batch, i);
+
+    VkResult res = vkCreateGraphicsPipelines(batch->device, batch->cache, 1, &pipeline_info, NULL, &batch->pipelines[i]);
+    if (res) {
+      PERR(DLU_VK_FUNC_ERR, res, "vkCreateGraphicsPipelines");
+      int expected = VK_SUCCESS;
+      atomic_compare_exchange_strong(&batch->res, &expected, res);
+    }
+  }
+
+  return NULL;
+}
+
+/* Drop a reference to each of count pipelines and clear their slots, new unshared ones are destroyed */
+static void release_pipelines(vkcomp *app, uint32_t cur_ld, VkPipeline *pipelines, uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    release_pipeline(app, cur_ld, pipelines[i]);
+    pipelines[i] = VK_NULL_HANDLE;
+  }
+}
+
+VkResult dlu_create_graphics_pipeline_batch(
+  vkcomp *app,
+  uint32_t cur_gpd,
+  uint32_t cur_pl,
+  uint32_t createInfoCount,
+  const VkGraphicsPipelineCreateInfo *pCreateInfos,
+  uint32_t threadCount
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->gp_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_GP_DATA"); return res; }
+  if (!app->gp_data[cur_gpd].graphics_pipelines) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_GP_DATA_MEMS"); return res; }
+  if (cur_pl + createInfoCount > app->gp_data[cur_gpd].gpc) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+  if (app->gp_data[cur_gpd].ldi == UINT32_MAX) { PERR(DLU_VKCOMP_DEVICE_NOT_ASSOC, 0, "dlu_create_pipeline_layout(3)"); return res; }
+
+  uint32_t cur_ld = app->gp_data[cur_gpd].ldi;
+  struct pipeline_batch batch = {
+    .device = app->ld_data[cur_ld].device, .cache = app->gp_cache.pipe_cache,
+    .layout = app->gp_data[cur_gpd].pipeline_layout, .render_pass = app->gp_data[cur_gpd].render_pass,
+    .infos = pCreateInfos, .pipelines = &app->gp_data[cur_gpd].graphics_pipelines[cur_pl], .count = 0
+  };
+  atomic_init(&batch.next, 0);
+  atomic_init(&batch.res, VK_SUCCESS);
+
+  /* Released once the new pipelines are in place, see dlu_create_graphics_pipelines(3) */
+  VkPipeline *olds = alloca(createInfoCount * sizeof(VkPipeline));
+  memcpy(olds, batch.pipelines, createInfoCount * sizeof(VkPipeline));
+
+  dlu_pipe_key *keys = alloca(createInfoCount * sizeof(dlu_pipe_key));
+  uint32_t *order = alloca(createInfoCount * sizeof(uint32_t));
+  batch.order = order;
+
+  /* Only the first of identical states in the batch gets compiled, states that already exist none */
+  for (uint32_t i = 0; i < createInfoCount; i++) {
+    VkGraphicsPipelineCreateInfo pipeline_info = get_batch_info(&batch, i);
+    get_pipe_key(app, cur_ld, &pipeline_info, &keys[i]);
+    batch.pipelines[i] = get_shared_pipeline(app, cur_ld, &keys[i]);
+    if (batch.pipelines[i]) continue;
+
+    uint32_t k = 0;
+    while (k < batch.count && !same_pipe_key(&keys[i], &keys[order[k]])) k++;
+    if (k == batch.count) order[batch.count++] = i;
+  }
+
+  if (!threadCount) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    threadCount = (cpus > 0) ? (uint32_t) cpus : 1;
+  }
+  threadCount = (threadCount > batch.count) ? batch.count : threadCount;
+
+  pthread_t *threads = (threadCount > 1) ? alloca((threadCount - 1) * sizeof(pthread_t)) : NULL;
+
+  /* The calling thread is a worker too, one less thread to spawn */
+  uint32_t spawned = 0;
+  for (; spawned + 1 < threadCount; spawned++)
+    if (pthread_create(&threads[spawned], NULL, create_pipeline_worker, &batch)) break;
+
+  create_pipeline_worker(&batch);
+
+  for (uint32_t i = 0; i < spawned; i++)
+    pthread_join(threads[i], NULL);
+
+  res = atomic_load(&batch.res);
+  if (res) goto end_func;
+
+  for (uint32_t k = 0; k < batch.count; k++)
+    add_shared_pipeline(app, cur_ld, &keys[order[k]], batch.pipelines[order[k]]);
+
+  /* Duplicates within the batch, compiled after all if the map had no room for the original */
+  for (uint32_t i = 0; i < createInfoCount; i++) {
+    if (batch.pipelines[i]) continue;
+    batch.pipelines[i] = get_shared_pipeline(app, cur_ld, &keys[i]);
+    if (batch.pipelines[i]) continue;
+
+    VkGraphicsPipelineCreateInfo pipeline_info = get_batch_info(&batch, i);
+    res = vkCreateGraphicsPipelines(batch.device, batch.cache, 1, &pipeline_info, NULL, &batch.pipelines[i]);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateGraphicsPipelines"); goto end_func; }
+  }
+
+end_func:
+  if (res) release_pipelines(app, cur_ld, batch.pipelines, createInfoCount);
+  release_pipelines(app, cur_ld, olds, createInfoCount);
+  for (uint32_t i = 0; i < createInfoCount; i++)
+    free_pipe_key(&keys[i]);
+
+  return res;
+}
+
+VkResult dlu_create_compute_pipeline(
+  vkcomp *app,
+  uint32_t cur_gpd,
+  uint32_t cur_pl,
+  const VkPipelineShaderStageCreateInfo *pStage
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->gp_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_GP_DATA"); return res; }
+  if (!app->gp_data[cur_gpd].pipeline_layout) { PERR(DLU_VKCOMP_PIPELINE_LAYOUT, 0, NULL); return res; }
+  if (!app->gp_data[cur_gpd].graphics_pipelines) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_GP_DATA_MEMS"); return res; }
+  if (cur_pl >= app->gp_data[cur_gpd].gpc) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  VkComputePipelineCreateInfo pipeline_info = {};
+  pipeline_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+  pipeline_info.pNext = NULL;
+  pipeline_info.flags = 0;
+  pipeline_info.stage = *pStage;
+  pipeline_info.layout = app->gp_data[cur_gpd].pipeline_layout;
+  pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
+  pipeline_info.basePipelineIndex = -1;
+
+  /* Same as dlu_create_graphics_pipelines(3), whatever the slot held is released */
+  uint32_t cur_ld = app->gp_data[cur_gpd].ldi;
+  VkPipeline old = app->gp_data[cur_gpd].graphics_pipelines[cur_pl];
+
+  res = vkCreateComputePipelines(app->ld_data[cur_ld].device, app->gp_cache.pipe_cache, 1, &pipeline_info, NULL, &app->gp_data[cur_gpd].graphics_pipelines[cur_pl]);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreateComputePipelines")
+
+  release_pipeline(app, cur_ld, old);
 
   return res;
 }
@@ -716,7 +1088,12 @@ VkResult dlu_create_pipeline_layout(
 
   if (!app->gp_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_GP_DATA"); return res; }
 
-  VkDescriptorSetLayout *pSetLayouts = (layout_infos) ? alloca(layout_count * sizeof(VkDescriptorSetLayout)) :  NULL;
+  VkDescriptorSetLayout *pSetLayouts = NULL;
+  if (layout_infos) {
+    pSetLayouts = alloca(layout_count * sizeof(VkDescriptorSetLayout));
+    memset(pSetLayouts, 0, layout_count * sizeof(VkDescriptorSetLayout));
+  }
+
   for (uint32_t i = 0; i < layout_count; i++) {
     res = vkCreateDescriptorSetLayout(app->ld_data[cur_ld].device, &layout_infos[i], NULL, &pSetLayouts[i]);
     if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateDescriptorSetLayout"); goto end_func; }
@@ -733,6 +1110,8 @@ VkResult dlu_create_pipeline_layout(
 
   res = vkCreatePipelineLayout(app->ld_data[cur_ld].device, &create_info, NULL, &app->gp_data[cur_gpd].pipeline_layout);
   if (res) PERR(DLU_VK_FUNC_ERR, res, "vkCreatePipelineLayout")
+  else set_obj_hash(app, (uint64_t) app->gp_data[cur_gpd].pipeline_layout,
+                    hash_pipeline_layout_info(layout_count, layout_infos, pushConstantRangeCount, pPushConstantRanges, flags));
 
   /* Associate a logical device with a graphics pipeline */
   app->gp_data[cur_gpd].ldi = cur_ld;
@@ -847,25 +1226,14 @@ VkResult dlu_create_texture_image(
   VkMemoryRequirements mem_reqs;
   vkGetImageMemoryRequirements(app->ld_data[cur_ld].device, app->text_data[cur_tex].image, &mem_reqs);
 
-  VkMemoryAllocateInfo alloc_info = {};
-  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-  alloc_info.pNext = NULL;
-  alloc_info.allocationSize = mem_reqs.size;
-  alloc_info.memoryTypeIndex = 0;
-
-  /* find a suitable memory type for image */
-  res = memory_type_from_properties(app, app->ld_data[cur_ld].pdi, mem_reqs.memoryTypeBits, requirements_mask, &alloc_info.memoryTypeIndex);
-  if (!res) { PERR(DLU_MEM_TYPE_ERR, 0, NULL); return res; }
+  /* Sub-allocate from a block of a suitable memory type for image */
+  res = dlu_vk_mem_alloc(app, cur_ld, &mem_reqs, requirements_mask, img_info->tiling == VK_IMAGE_TILING_OPTIMAL,
+                         &app->text_data[cur_tex].mem, &app->text_data[cur_tex].offset, &app->text_data[cur_tex].size,
+                         &app->text_data[cur_tex].mapped);
+  if (res) return res;
 
-  res = vkAllocateMemory(app->ld_data[cur_ld].device, &alloc_info, NULL, &app->text_data[cur_tex].mem);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateMemory"); return res; }
-
-  /**
-  * Associate the memory allocated with the VkBuffer resource.
-  * It is easier to attach the entire VkDeviceMemory to the VkBuffer resource
-  * So offset will always be zero whenever a call to vkBind*Memory is called
-  */
-  res = vkBindImageMemory(app->ld_data[cur_ld].device, app->text_data[cur_tex].image, app->text_data[cur_tex].mem, 0);
+  /* Associate the memory allocated with the VkImage resource */
+  res = vkBindImageMemory(app->ld_data[cur_ld].device, app->text_data[cur_tex].image, app->text_data[cur_tex].mem, app->text_data[cur_tex].offset);
   if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBindImageMemory"); return res; }
 
   /**
@@ -882,6 +1250,63 @@ VkResult dlu_create_texture_image(
   return res;
 }
 
+VkResult dlu_create_aliased_images(
+  vkcomp *app,
+  uint32_t cur_ld,
+  uint32_t cur_tex,
+  uint32_t imageCount,
+  VkImageCreateInfo *img_infos,
+  VkImageViewCreateInfo *ivis,
+  VkMemoryPropertyFlags requirements_mask
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->text_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_TEXT_DATA"); return res; }
+
+  /* One allocation that satisfies every image */
+  VkMemoryRequirements mem_reqs = { .size = 0, .alignment = 1, .memoryTypeBits = UINT32_MAX }, reqs;
+  bool transient = true;
+
+  for (uint32_t i = 0; i < imageCount; i++) {
+    res = vkCreateImage(app->ld_data[cur_ld].device, &img_infos[i], NULL, &app->text_data[cur_tex+i].image);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateImage"); return res; }
+
+    app->text_data[cur_tex+i].ldi = cur_ld;
+
+    vkGetImageMemoryRequirements(app->ld_data[cur_ld].device, app->text_data[cur_tex+i].image, &reqs);
+    mem_reqs.size = (reqs.size > mem_reqs.size) ? reqs.size : mem_reqs.size;
+    mem_reqs.alignment = (reqs.alignment > mem_reqs.alignment) ? reqs.alignment : mem_reqs.alignment;
+    mem_reqs.memoryTypeBits &= reqs.memoryTypeBits;
+    transient &= (img_infos[i].usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+  }
+
+  if (!mem_reqs.memoryTypeBits) { PERR(DLU_MEM_TYPE_ERR, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  if (transient) requirements_mask |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+  struct _text_data *owner = &app->text_data[cur_tex];
+  res = dlu_vk_mem_alloc(app, cur_ld, &mem_reqs, requirements_mask, img_infos[0].tiling == VK_IMAGE_TILING_OPTIMAL,
+                         &owner->mem, &owner->offset, &owner->size, &owner->mapped);
+  if (res) return res;
+
+  for (uint32_t i = 0; i < imageCount; i++) {
+    struct _text_data *tex = &app->text_data[cur_tex+i];
+
+    /* Aliases have no size, only the first image gives the memory back */
+    if (i) { tex->mem = owner->mem; tex->offset = owner->offset; tex->size = 0; tex->mapped = owner->mapped; }
+
+    res = vkBindImageMemory(app->ld_data[cur_ld].device, tex->image, tex->mem, tex->offset);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBindImageMemory"); return res; }
+
+    ivis[i].image = tex->image;
+    res = vkCreateImageView(app->ld_data[cur_ld].device, &ivis[i], NULL, &tex->view);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateImageView"); return res; }
+  }
+
+  return res;
+}
+
 VkResult dlu_create_texture_sampler(vkcomp *app, uint32_t cur_tex, VkSamplerCreateInfo *sample_info) {
   VkResult res = VK_RESULT_MAX_ENUM;
 
@@ -225,3 +225,202 @@ VkResult dlu_queue_present_queue(
 
   return res;
 }
+
+static VkQueue get_queue(vkcomp *app, uint32_t cur_ld, dlu_queue_type queue) {
+  switch (queue) {
+    case DLU_VK_GRAPHICS_QUEUE: return app->ld_data[cur_ld].graphics;
+    case DLU_VK_TRANSFER_QUEUE: return app->ld_data[cur_ld].transfer;
+    case DLU_VK_COMPUTE_QUEUE: return app->ld_data[cur_ld].compute;
+    default: return VK_NULL_HANDLE;
+  }
+}
+
+/**
+* Take a free pooled semaphore. Acquire semaphores are only retired lazily, once the
+* pool runs dry, by checking how far the graphics timeline got.
+*/
+static uint32_t get_pool_sem(vkcomp *app, uint32_t cur_scd) {
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+  uint64_t done = 0;
+
+  for (uint32_t i = 0; i < DLU_VK_SEM_POOL_CNT; i++)
+    if (!sc->sem_pool[i].in_use) return i;
+
+  if (dlu_vk_get_timeline(app, sc->ldi, DLU_VK_GRAPHICS_QUEUE, &done)) return UINT32_MAX;
+
+  for (uint32_t i = 0; i < DLU_VK_SEM_POOL_CNT; i++)
+    if (sc->sem_pool[i].img == UINT32_MAX && sc->sem_pool[i].value <= done)
+      return i;
+
+  dlu_log_me(DLU_DANGER, "[x] Every pooled semaphore is in use, DLU_VK_SEM_POOL_CNT is too small for this many frames in flight");
+  return UINT32_MAX;
+}
+
+VkResult dlu_acquire_sc_image(vkcomp *app, uint32_t cur_scd, uint64_t timeout, uint32_t *cur_img) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+
+  if (!sc->sem_pool[0].sem) { PERR(DLU_VKCOMP_SC_SYNCS, 0, NULL); return res; }
+
+  /* An acquire semaphore that's never waited on can't be signaled again */
+  if (sc->acquire != UINT32_MAX) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  uint32_t s = get_pool_sem(app, cur_scd);
+  if (s == UINT32_MAX) return VK_NOT_READY;
+
+  res = vkAcquireNextImageKHR(app->ld_data[sc->ldi].device, sc->swap_chain, timeout, sc->sem_pool[s].sem, VK_NULL_HANDLE, cur_img);
+  if (res && res != VK_SUBOPTIMAL_KHR) { PERR(DLU_VK_FUNC_ERR, res, "vkAcquireNextImageKHR"); return res; }
+
+  /* The image came back, so the semaphore its last present waited on is free again */
+  for (uint32_t i = 0; i < DLU_VK_SEM_POOL_CNT; i++)
+    if (sc->sem_pool[i].in_use && sc->sem_pool[i].img == *cur_img)
+      sc->sem_pool[i].in_use = false;
+
+  sc->sem_pool[s].in_use = true;
+  sc->sem_pool[s].value = UINT64_MAX;
+  sc->sem_pool[s].img = UINT32_MAX;
+  sc->acquire = s;
+
+  return res;
+}
+
+VkResult dlu_queue_graphics_timeline(
+  vkcomp *app,
+  uint32_t cur_scd,
+  uint32_t cur_img,
+  uint32_t commandBufferCount,
+  const VkCommandBuffer *pCommandBuffers,
+  VkPipelineStageFlags waitDstStageMask,
+  uint64_t *value
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+  struct _timeline *timeline = &app->ld_data[sc->ldi].timelines[DLU_VK_GRAPHICS_QUEUE];
+
+  if (!timeline->sem) { PERR(DLU_VKCOMP_SC_SYNCS, 0, NULL); return res; }
+  if (sc->acquire == UINT32_MAX) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  uint32_t p = get_pool_sem(app, cur_scd);
+  if (p == UINT32_MAX) return VK_NOT_READY;
+
+  /* Binary semaphores ignore their value */
+  uint64_t wait_value = 0;
+  uint64_t signal_values[2] = { timeline->value + 1, 0 };
+  VkSemaphore signal_sems[2] = { timeline->sem, sc->sem_pool[p].sem };
+
+  VkTimelineSemaphoreSubmitInfoKHR timeline_info = {};
+  timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+  timeline_info.pNext = NULL;
+  timeline_info.waitSemaphoreValueCount = 1;
+  timeline_info.pWaitSemaphoreValues = &wait_value;
+  timeline_info.signalSemaphoreValueCount = ARR_LEN(signal_values);
+  timeline_info.pSignalSemaphoreValues = signal_values;
+
+  VkSubmitInfo submit_info = {};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.pNext = &timeline_info;
+  submit_info.waitSemaphoreCount = 1;
+  submit_info.pWaitSemaphores = &sc->sem_pool[sc->acquire].sem;
+  submit_info.pWaitDstStageMask = &waitDstStageMask;
+  submit_info.commandBufferCount = commandBufferCount;
+  submit_info.pCommandBuffers = pCommandBuffers;
+  submit_info.signalSemaphoreCount = ARR_LEN(signal_sems);
+  submit_info.pSignalSemaphores = signal_sems;
+
+  res = vkQueueSubmit(app->ld_data[sc->ldi].graphics, 1, &submit_info, VK_NULL_HANDLE);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkQueueSubmit"); return res; }
+
+  timeline->value++;
+
+  /* The acquire semaphore is free once this submission completes */
+  sc->sem_pool[sc->acquire].value = timeline->value;
+  sc->acquire = UINT32_MAX;
+
+  sc->sem_pool[p].in_use = true;
+  sc->sem_pool[p].img = cur_img;
+  sc->present = p;
+
+  if (value) *value = timeline->value;
+
+  return res;
+}
+
+VkResult dlu_queue_timeline_submit(
+  vkcomp *app,
+  uint32_t cur_ld,
+  dlu_queue_type queue,
+  uint32_t commandBufferCount,
+  const VkCommandBuffer *pCommandBuffers,
+  uint32_t waitCount,
+  const dlu_queue_type *pWaitQueues,
+  const uint64_t *pWaitValues,
+  const VkPipelineStageFlags *pWaitDstStageMask,
+  uint64_t *value
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _timeline *timeline = &app->ld_data[cur_ld].timelines[queue];
+
+  if (!timeline->sem) { PERR(DLU_VKCOMP_SC_SYNCS, 0, NULL); return res; }
+  if (waitCount > DLU_VK_QUEUE_CNT) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  VkSemaphore wait_sems[DLU_VK_QUEUE_CNT];
+  for (uint32_t i = 0; i < waitCount; i++) {
+    wait_sems[i] = app->ld_data[cur_ld].timelines[pWaitQueues[i]].sem;
+    if (!wait_sems[i]) { PERR(DLU_VKCOMP_SC_SYNCS, 0, NULL); return res; }
+  }
+
+  uint64_t signal_value = timeline->value + 1;
+
+  VkTimelineSemaphoreSubmitInfoKHR timeline_info = {};
+  timeline_info.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO_KHR;
+  timeline_info.pNext = NULL;
+  timeline_info.waitSemaphoreValueCount = waitCount;
+  timeline_info.pWaitSemaphoreValues = pWaitValues;
+  timeline_info.signalSemaphoreValueCount = 1;
+  timeline_info.pSignalSemaphoreValues = &signal_value;
+
+  VkSubmitInfo submit_info = {};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.pNext = &timeline_info;
+  submit_info.waitSemaphoreCount = waitCount;
+  submit_info.pWaitSemaphores = wait_sems;
+  submit_info.pWaitDstStageMask = pWaitDstStageMask;
+  submit_info.commandBufferCount = commandBufferCount;
+  submit_info.pCommandBuffers = pCommandBuffers;
+  submit_info.signalSemaphoreCount = 1;
+  submit_info.pSignalSemaphores = &timeline->sem;
+
+  res = vkQueueSubmit(get_queue(app, cur_ld, queue), 1, &submit_info, VK_NULL_HANDLE);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkQueueSubmit"); return res; }
+
+  timeline->value = signal_value;
+  if (value) *value = signal_value;
+
+  return res;
+}
+
+VkResult dlu_queue_present_timeline(vkcomp *app, uint32_t cur_scd, uint32_t cur_img) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+
+  if (sc->present == UINT32_MAX) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return res; }
+
+  VkPresentInfoKHR present;
+  present.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+  present.pNext = NULL;
+  present.waitSemaphoreCount = 1;
+  present.pWaitSemaphores = &sc->sem_pool[sc->present].sem;
+  present.swapchainCount = 1;
+  present.pSwapchains = &sc->swap_chain;
+  present.pImageIndices = &cur_img;
+  present.pResults = NULL;
+
+  sc->present = UINT32_MAX;
+
+  res = vkQueuePresentKHR(app->ld_data[sc->ldi].graphics, &present);
+  if (res && res != VK_SUBOPTIMAL_KHR) PERR(DLU_VK_FUNC_ERR, res, "vkQueuePresentKHR")
+
+  return res;
+}
@@ -25,57 +25,152 @@
 #define LUCUR_VKCOMP_API
 #include <lucom.h>
 
+/* Finds a one time command buffer the GPU is done with, waits on in flight ones if none are */
+static int get_one_shot(vkcomp *app, uint32_t cur_ld) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _ld_data *ld = &app->ld_data[cur_ld];
+  VkFence pending[DLU_VK_ONE_SHOT_CNT];
+  uint32_t pc = 0;
+
+  for (uint32_t i = 0; i < DLU_VK_ONE_SHOT_CNT; i++) {
+    if (ld->one_shots[i].recording) continue;
+    if (!ld->one_shots[i].cmd_buff) return i;
+
+    res = vkGetFenceStatus(ld->device, ld->one_shots[i].fence);
+    if (res == VK_SUCCESS) return i;
+    if (res != VK_NOT_READY) { PERR(DLU_VK_FUNC_ERR, res, "vkGetFenceStatus"); return -1; }
+    pending[pc++] = ld->one_shots[i].fence;
+  }
+
+  if (!pc) { dlu_log_me(DLU_DANGER, "[x] All %d one time command buffers are being recorded", DLU_VK_ONE_SHOT_CNT); return -1; }
+
+  res = vkWaitForFences(ld->device, pc, pending, VK_FALSE, GENERAL_TIMEOUT);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkWaitForFences"); return -1; }
+
+  for (uint32_t i = 0; i < DLU_VK_ONE_SHOT_CNT; i++)
+    if (!ld->one_shots[i].recording && vkGetFenceStatus(ld->device, ld->one_shots[i].fence) == VK_SUCCESS)
+      return i;
+
+  return -1;
+}
+
+static int find_one_shot(vkcomp *app, uint32_t cur_ld, VkCommandBuffer cmd_buff) {
+  for (uint32_t i = 0; i < DLU_VK_ONE_SHOT_CNT; i++)
+    if (app->ld_data[cur_ld].one_shots[i].recording && app->ld_data[cur_ld].one_shots[i].cmd_buff == cmd_buff)
+      return i;
+  return -1;
+}
+
 VkCommandBuffer dlu_exec_begin_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool) {
-  VkCommandBuffer cmd_buff = VK_NULL_HANDLE;
   VkResult res = VK_RESULT_MAX_ENUM;
 
-  if (!app->cmd_data[cur_pool].cmd_pool) { PERR(DLU_VKCOMP_CMD_POOL, 0, NULL); return cmd_buff; }
+  if (!app->cmd_data[cur_pool].cmd_pool) { PERR(DLU_VKCOMP_CMD_POOL, 0, NULL); return VK_NULL_HANDLE; }
 
-  VkCommandBufferAllocateInfo alloc_info = {};
-  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-  alloc_info.pNext = NULL;
-  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-  alloc_info.commandPool = app->cmd_data[cur_pool].cmd_pool;
-  alloc_info.commandBufferCount = 1;
+  uint32_t cur_ld = app->cmd_data[cur_pool].ldi;
+  struct _ld_data *ld = &app->ld_data[cur_ld];
 
-  res = vkAllocateCommandBuffers(app->ld_data[app->cmd_data[cur_pool].ldi].device, &alloc_info, &cmd_buff);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateCommandBuffers"); return cmd_buff; }
+  if (!ld->one_shot_pool) {
+    VkCommandPoolCreateInfo pool_info = {};
+    pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    pool_info.pNext = NULL;
+    pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    pool_info.queueFamilyIndex = app->pd_data[ld->pdi].gfam_idx;
+
+    res = vkCreateCommandPool(ld->device, &pool_info, NULL, &ld->one_shot_pool);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateCommandPool"); return VK_NULL_HANDLE; }
+  }
+
+  int slot = get_one_shot(app, cur_ld);
+  if (slot == -1) return VK_NULL_HANDLE;
+
+  struct _one_shot *os = &ld->one_shots[slot];
+
+  /* First use of the slot, otherwise the buffer and fence are recycled as is */
+  if (!os->cmd_buff) {
+    VkCommandBufferAllocateInfo alloc_info = {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.pNext = NULL;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandPool = ld->one_shot_pool;
+    alloc_info.commandBufferCount = 1;
+
+    res = vkAllocateCommandBuffers(ld->device, &alloc_info, &os->cmd_buff);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateCommandBuffers"); os->cmd_buff = VK_NULL_HANDLE; return VK_NULL_HANDLE; }
+
+    VkFenceCreateInfo fence_info = {};
+    fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+    fence_info.pNext = NULL;
+    fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+    res = vkCreateFence(ld->device, &fence_info, NULL, &os->fence);
+    if (res) {
+      PERR(DLU_VK_FUNC_ERR, res, "vkCreateFence");
+      vkFreeCommandBuffers(ld->device, ld->one_shot_pool, 1, &os->cmd_buff);
+      os->cmd_buff = VK_NULL_HANDLE;
+      return VK_NULL_HANDLE;
+    }
+  }
 
   VkCommandBufferBeginInfo begin_info = {};
   begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
   begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-  res = vkBeginCommandBuffer(cmd_buff, &begin_info);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBeginCommandBuffer"); goto finish_estcb; }
+  /* Implicitly resets the buffer, the pool was created with VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT */
+  res = vkBeginCommandBuffer(os->cmd_buff, &begin_info);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBeginCommandBuffer"); return VK_NULL_HANDLE; }
 
-  return cmd_buff;
+  os->recording = true;
 
-finish_estcb:
-  vkFreeCommandBuffers(app->ld_data[app->cmd_data[cur_pool].ldi].device, app->cmd_data[cur_pool].cmd_pool, 1, &cmd_buff);
-  return VK_NULL_HANDLE;
+  return os->cmd_buff;
 }
 
-VkResult dlu_exec_end_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool, VkCommandBuffer *cmd_buff) {
+VkResult dlu_exec_submit_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool, VkCommandBuffer *cmd_buff) {
   VkResult res = VK_RESULT_MAX_ENUM;
 
   if (!app->cmd_data[cur_pool].cmd_pool) { PERR(DLU_VKCOMP_CMD_POOL, 0, NULL); return res; }
-  
-  res = vkEndCommandBuffer(*cmd_buff);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkEndCommandBuffer"); goto finish_estcb; }
+
+  uint32_t cur_ld = app->cmd_data[cur_pool].ldi;
+  struct _ld_data *ld = &app->ld_data[cur_ld];
+
+  int slot = find_one_shot(app, cur_ld, *cmd_buff);
+  if (slot == -1) { PERR(DLU_VKCOMP_CMD_BUFFS, 0, NULL); return res; }
+
+  struct _one_shot *os = &ld->one_shots[slot];
+
+  /* On failure the slot goes straight back to the free list, its fence is still signaled */
+  os->recording = false;
+
+  res = vkEndCommandBuffer(os->cmd_buff);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkEndCommandBuffer"); return res; }
+
+  res = vkResetFences(ld->device, 1, &os->fence);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkResetFences"); return res; }
 
   VkSubmitInfo submit_info = {};
   submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
   submit_info.commandBufferCount = 1;
-  submit_info.pCommandBuffers = cmd_buff;
+  submit_info.pCommandBuffers = &os->cmd_buff;
+
+  res = vkQueueSubmit(ld->graphics, 1, &submit_info, os->fence);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkQueueSubmit"); return res; }
+
+  return res;
+}
 
-  res = vkQueueSubmit(app->ld_data[app->cmd_data[cur_pool].ldi].graphics, 1, &submit_info, VK_NULL_HANDLE);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkQueueSubmit"); goto finish_estcb; }
+VkResult dlu_exec_end_single_time_cmd_buff(vkcomp *app, uint32_t cur_pool, VkCommandBuffer *cmd_buff) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->cmd_data[cur_pool].cmd_pool) { PERR(DLU_VKCOMP_CMD_POOL, 0, NULL); return res; }
 
-  res = vkQueueWaitIdle(app->ld_data[app->cmd_data[cur_pool].ldi].graphics);
-  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkQueueWaitIdle"); goto finish_estcb; }
+  uint32_t cur_ld = app->cmd_data[cur_pool].ldi;
+  int slot = find_one_shot(app, cur_ld, *cmd_buff);
 
-finish_estcb:
-  vkFreeCommandBuffers(app->ld_data[app->cmd_data[cur_pool].ldi].device, app->cmd_data[cur_pool].cmd_pool, 1, cmd_buff);
+  res = dlu_exec_submit_single_time_cmd_buff(app, cur_pool, cmd_buff);
+  if (res) return res;
+
+  /* Only waits on this buffer, other work on the graphics queue keeps going */
+  res = vkWaitForFences(app->ld_data[cur_ld].device, 1, &app->ld_data[cur_ld].one_shots[slot].fence, VK_TRUE, GENERAL_TIMEOUT);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkWaitForFences")
 
   return res;
 }
@@ -98,6 +193,18 @@ void dlu_exec_copy_buffer(
   vkCmdCopyBuffer(cmd_buff, app->buff_data[src_bd].buff, app->buff_data[dst_bd].buff, 1, &copy_region);
 }
 
+void dlu_exec_fill_buffer(
+  vkcomp *app,
+  uint32_t cur_bd,
+  VkDeviceSize dstOffset,
+  VkDeviceSize size,
+  uint32_t data,
+  VkCommandBuffer cmd_buff
+) {
+
+  vkCmdFillBuffer(cmd_buff, app->buff_data[cur_bd].buff, dstOffset, size, data);
+}
+
 void dlu_exec_copy_buff_to_image(
   vkcomp *app,
   uint32_t cur_bd,
@@ -207,6 +314,134 @@ VkResult dlu_exec_stop_cmd_buffs(vkcomp *app, uint32_t cur_pool, uint32_t cur_sc
   return res;
 }
 
+VkResult dlu_exec_begin_secondary_cmd_buffs(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_scd,
+  uint32_t cur_gpd,
+  uint32_t subpass,
+  VkCommandBufferUsageFlags flags
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->cmd_data[cur_pool].cmd_buffs) { PERR(DLU_VKCOMP_CMD_BUFFS, 0, NULL); return res; }
+  if (!app->sc_data[cur_scd].sc_buffs) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_SC_DATA_MEMS"); return res; }
+  if (!app->gp_data[cur_gpd].render_pass) { PERR(DLU_VKCOMP_RENDER_PASS, 0, NULL); return res; }
+
+  VkCommandBufferInheritanceInfo inheritance_info = dlu_set_cmd_buff_inheritance_info(
+    app->gp_data[cur_gpd].render_pass, subpass, VK_NULL_HANDLE, VK_FALSE, 0, 0
+  );
+
+  VkCommandBufferBeginInfo begin_info = {};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.pNext = NULL;
+  begin_info.flags = flags | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+  begin_info.pInheritanceInfo = &inheritance_info;
+
+  for (uint32_t i = 0; i < app->sc_data[cur_scd].sic; i++) {
+    /* Knowing the framebuffer up front lets the driver skip work when executing the secondary */
+    inheritance_info.framebuffer = app->sc_data[cur_scd].sc_buffs[i].fb;
+    res = vkBeginCommandBuffer(app->cmd_data[cur_pool].cmd_buffs[i], &begin_info);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBeginCommandBuffer"); return res; }
+  }
+
+  return res;
+}
+
+void dlu_exec_secondary_cmd_buffs(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_scd,
+  uint32_t poolCount,
+  const uint32_t *pPools
+) {
+
+  if (!app->cmd_data[cur_pool].cmd_buffs) { PERR(DLU_VKCOMP_CMD_BUFFS, 0, NULL); return; }
+
+  VkCommandBuffer *secondaries = (VkCommandBuffer *) dlu_frame_alloc(poolCount * sizeof(VkCommandBuffer));
+  if (!secondaries) secondaries = (VkCommandBuffer *) alloca(poolCount * sizeof(VkCommandBuffer));
+
+  for (uint32_t i = 0; i < app->sc_data[cur_scd].sic; i++) {
+    for (uint32_t p = 0; p < poolCount; p++) {
+      if (!app->cmd_data[pPools[p]].cmd_buffs) { PERR(DLU_VKCOMP_CMD_BUFFS, 0, NULL); return; }
+      secondaries[p] = app->cmd_data[pPools[p]].cmd_buffs[i];
+    }
+
+    vkCmdExecuteCommands(app->cmd_data[cur_pool].cmd_buffs[i], poolCount, secondaries);
+  }
+}
+
+VkCommandBuffer dlu_exec_begin_frame(vkcomp *app, uint32_t cur_pool) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->cmd_data[cur_pool].cmd_buffs) { PERR(DLU_VKCOMP_CMD_BUFFS, 0, NULL); return VK_NULL_HANDLE; }
+
+  VkDevice device = app->ld_data[app->cmd_data[cur_pool].ldi].device;
+
+  /* Recycles the memory of every command buffer in the pool, cheaper than free + allocate */
+  res = vkResetCommandPool(device, app->cmd_data[cur_pool].cmd_pool, 0);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkResetCommandPool"); return VK_NULL_HANDLE; }
+
+  VkCommandBufferBeginInfo begin_info = {};
+  begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+  begin_info.pNext = NULL;
+  begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+  begin_info.pInheritanceInfo = NULL;
+
+  res = vkBeginCommandBuffer(app->cmd_data[cur_pool].cmd_buffs[0], &begin_info);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBeginCommandBuffer"); return VK_NULL_HANDLE; }
+
+  return app->cmd_data[cur_pool].cmd_buffs[0];
+}
+
+void dlu_exec_begin_frame_render_pass(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_scd,
+  uint32_t cur_gpd,
+  uint32_t cur_img,
+  uint32_t x,
+  uint32_t y,
+  uint32_t width,
+  uint32_t height,
+  uint32_t clearValueCount,
+  const VkClearValue *pClearValues,
+  VkSubpassContents contents
+) {
+
+  if (!app->sc_data[cur_scd].sc_buffs) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_SC_DATA_MEMS"); return; }
+
+  VkRenderPassBeginInfo render_pass_info = {};
+  render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+  render_pass_info.pNext = NULL;
+  render_pass_info.renderPass = app->gp_data[cur_gpd].render_pass;
+  render_pass_info.framebuffer = app->sc_data[cur_scd].sc_buffs[cur_img].fb;
+  render_pass_info.renderArea.offset.x = x;
+  render_pass_info.renderArea.offset.y = y;
+  render_pass_info.renderArea.extent.width = width;
+  render_pass_info.renderArea.extent.height = height;
+  render_pass_info.clearValueCount = clearValueCount;
+  render_pass_info.pClearValues = pClearValues;
+
+  vkCmdBeginRenderPass(app->cmd_data[cur_pool].cmd_buffs[0], &render_pass_info, contents);
+}
+
+void dlu_exec_stop_frame_render_pass(vkcomp *app, uint32_t cur_pool) {
+  vkCmdEndRenderPass(app->cmd_data[cur_pool].cmd_buffs[0]);
+}
+
+VkResult dlu_exec_stop_frame(vkcomp *app, uint32_t cur_pool) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->cmd_data[cur_pool].cmd_buffs) { PERR(DLU_VKCOMP_CMD_BUFFS, 0, NULL); return res; }
+
+  res = vkEndCommandBuffer(app->cmd_data[cur_pool].cmd_buffs[0]);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkEndCommandBuffer")
+
+  return res;
+}
+
 void dlu_exec_cmd_draw(
   vkcomp *app,
   uint32_t cur_pool,
@@ -234,6 +469,50 @@ void dlu_exec_cmd_draw_indexed(
   vkCmdDrawIndexed(app->cmd_data[cur_pool].cmd_buffs[cur_buff], indexCount, instanceCount, firstIndex, vertexOffset, firstInstance);
 }
 
+void dlu_exec_cmd_draw_indexed_indirect(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t cur_bd,
+  VkDeviceSize offset,
+  uint32_t drawCount,
+  uint32_t stride
+) {
+
+  vkCmdDrawIndexedIndirect(app->cmd_data[cur_pool].cmd_buffs[cur_buff], app->buff_data[cur_bd].buff, offset, drawCount, stride);
+}
+
+void dlu_exec_cmd_draw_indexed_indirect_count(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t cur_bd,
+  VkDeviceSize offset,
+  uint32_t count_bd,
+  VkDeviceSize countBufferOffset,
+  uint32_t maxDrawCount,
+  uint32_t stride
+) {
+
+  PFN_vkCmdDrawIndexedIndirectCountKHR draw_indexed_indirect_count = app->ld_data[app->cmd_data[cur_pool].ldi].draw_indexed_indirect_count;
+  if (!draw_indexed_indirect_count) { PERR(DLU_DR_DEVICE_PROC_ADDR_ERR, 0, "CmdDrawIndexedIndirectCountKHR"); return; }
+
+  draw_indexed_indirect_count(app->cmd_data[cur_pool].cmd_buffs[cur_buff], app->buff_data[cur_bd].buff, offset,
+                              app->buff_data[count_bd].buff, countBufferOffset, maxDrawCount, stride);
+}
+
+void dlu_exec_cmd_dispatch(
+  vkcomp *app,
+  uint32_t cur_pool,
+  uint32_t cur_buff,
+  uint32_t groupCountX,
+  uint32_t groupCountY,
+  uint32_t groupCountZ
+) {
+
+  vkCmdDispatch(app->cmd_data[cur_pool].cmd_buffs[cur_buff], groupCountX, groupCountY, groupCountZ);
+}
+
 void dlu_exec_cmd_set_viewport(
   vkcomp *app,
   VkViewport *viewport,
@@ -0,0 +1,131 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#include <lucom.h>
+
+VkResult dlu_vk_create_frames(vkcomp *app, uint32_t cur_scd, uint32_t cur_pool, uint32_t frameCount) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->sc_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_SC_DATA"); return res; }
+  if (app->sc_data[cur_scd].ldi == UINT32_MAX) { PERR(DLU_VKCOMP_DEVICE_NOT_ASSOC, 0, "dlu_create_swap_chain()"); return res; }
+
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+  uint32_t cur_ld = sc->ldi;
+
+  if (!app->ld_data[cur_ld].timelines[DLU_VK_GRAPHICS_QUEUE].sem) {
+    res = dlu_create_timelines(app, cur_ld);
+    if (res) return res;
+  }
+
+  if (sc->swap_chain && !sc->sem_pool[0].sem) {
+    res = dlu_create_sem_pool(app, cur_scd);
+    if (res) return res;
+  }
+
+  for (uint32_t i = 0; i < DLU_VK_MAX_FRAMES; i++) {
+    res = dlu_create_frame_cmd_pool(app, cur_ld, cur_pool + i, app->pd_data[app->ld_data[cur_ld].pdi].gfam_idx);
+    if (res) return res;
+  }
+
+  sc->frames.pool = cur_pool;
+  sc->frames.frame = 0;
+  memset(sc->frames.history, 0, sizeof(sc->frames.history));
+  memset(sc->frames.retire, 0, sizeof(sc->frames.retire));
+
+  return dlu_vk_set_frames_in_flight(app, cur_scd, frameCount);
+}
+
+VkResult dlu_vk_set_frames_in_flight(vkcomp *app, uint32_t cur_scd, uint32_t frameCount) {
+  if (!frameCount || frameCount > DLU_VK_MAX_FRAMES) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  app->sc_data[cur_scd].frames.count = frameCount;
+  return VK_SUCCESS;
+}
+
+VkCommandBuffer dlu_vk_begin_frame(vkcomp *app, uint32_t cur_scd, uint64_t timeout, uint32_t *cur_pool, uint32_t *cur_img) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+  struct _frame_data *frames = &sc->frames;
+
+  if (!frames->count) { PERR(DLU_VKCOMP_CMD_POOL, 0, NULL); return VK_NULL_HANDLE; }
+
+  uint32_t slot = frames->frame % frames->count;
+  uint32_t pool = frames->pool + slot;
+
+  /**
+  * Hold the CPU count frames ahead at most, and never reuse a pool the GPU still reads from.
+  * The two only differ for a frame or two after dlu_vk_set_frames_in_flight(3) changed count.
+  */
+  uint64_t wait = frames->retire[slot];
+  if (frames->frame >= frames->count) {
+    uint64_t ahead = frames->history[(frames->frame - frames->count) % DLU_VK_MAX_FRAMES];
+    wait = (ahead > wait) ? ahead : wait;
+  }
+
+  res = dlu_vk_wait_timeline(app, sc->ldi, DLU_VK_GRAPHICS_QUEUE, wait, timeout);
+  if (res) return VK_NULL_HANDLE;
+
+  frames->img = 0;
+  if (sc->swap_chain) {
+    res = dlu_acquire_sc_image(app, cur_scd, timeout, &frames->img);
+    if (res && res != VK_SUBOPTIMAL_KHR) return VK_NULL_HANDLE;
+  }
+
+  /* The GPU is done with the slot, its pool can be reset */
+  VkCommandBuffer cmd_buff = dlu_exec_begin_frame(app, pool);
+  if (!cmd_buff) return VK_NULL_HANDLE;
+
+  frames->cur = slot;
+  if (cur_pool) *cur_pool = pool;
+  if (cur_img) *cur_img = frames->img;
+
+  return cmd_buff;
+}
+
+VkResult dlu_vk_end_frame(vkcomp *app, uint32_t cur_scd, VkPipelineStageFlags waitDstStageMask, uint64_t *value) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _sc_data *sc = &app->sc_data[cur_scd];
+  struct _frame_data *frames = &sc->frames;
+  VkCommandBuffer cmd_buff = app->cmd_data[frames->pool + frames->cur].cmd_buffs[0];
+  uint64_t signaled = 0;
+
+  res = dlu_exec_stop_frame(app, frames->pool + frames->cur);
+  if (res) return res;
+
+  if (sc->swap_chain)
+    res = dlu_queue_graphics_timeline(app, cur_scd, frames->img, 1, &cmd_buff, waitDstStageMask, &signaled);
+  else
+    res = dlu_queue_timeline_submit(app, sc->ldi, DLU_VK_GRAPHICS_QUEUE, 1, &cmd_buff, 0, NULL, NULL, NULL, &signaled);
+  if (res) return res;
+
+  frames->retire[frames->cur] = signaled;
+  frames->history[frames->frame % DLU_VK_MAX_FRAMES] = signaled;
+  frames->frame++;
+
+  if (value) *value = signaled;
+
+  return (sc->swap_chain) ? dlu_queue_present_timeline(app, cur_scd, frames->img) : res;
+}
@@ -0,0 +1,551 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#include <lucom.h>
+
+#define GRAPH_WRITE_ACCESS (VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | \
+                            VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT | \
+                            VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT)
+
+/**
+* Synchronization state of a resource (or of a slot every alias of it shares) while walking
+* the live passes. Reads since the last write are tracked so write after read hazards only
+* wait on them, visible_* remember which stages already had the last write made visible,
+* further reads from those don't need another barrier.
+*/
+struct graph_state {
+  uint32_t res;
+  VkImageLayout layout;
+  VkPipelineStageFlags write_stage;
+  VkAccessFlags write_access;
+  VkPipelineStageFlags read_stage;
+  VkPipelineStageFlags visible_stage;
+  VkAccessFlags visible_access;
+};
+
+dlu_render_graph *dlu_create_render_graph(vkcomp *app, uint32_t cur_ld) {
+  if (!app->ld_data[cur_ld].device) { PERR(DLU_VKCOMP_DEVICE, 0, NULL); return NULL; }
+
+  dlu_render_graph *graph = dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, sizeof(dlu_render_graph), CACHE_LINE_SIZE);
+  if (!graph) { PERR(DLU_ALLOC_FAILED, 0, NULL); return NULL; }
+
+  graph->ldi = cur_ld;
+  return graph;
+}
+
+static uint32_t add_res(dlu_render_graph *graph) {
+  if (graph->compiled) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "already compiled"); return UINT32_MAX; }
+  if (graph->rc == DLU_GRAPH_MAX_RESOURCES) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "DLU_GRAPH_MAX_RESOURCES reached"); return UINT32_MAX; }
+
+  graph->res[graph->rc].first = graph->res[graph->rc].slot = UINT32_MAX;
+  return graph->rc++;
+}
+
+uint32_t dlu_graph_import_image(
+  dlu_render_graph *graph,
+  VkImage image,
+  VkImageSubresourceRange range,
+  VkImageLayout initialLayout,
+  VkImageLayout finalLayout
+) {
+
+  uint32_t r = add_res(graph);
+  if (r == UINT32_MAX) return r;
+
+  graph->res[r].image = true;
+  graph->res[r].vk_image = image;
+  graph->res[r].range = range;
+  graph->res[r].initial_layout = initialLayout;
+  graph->res[r].final_layout = finalLayout;
+
+  return r;
+}
+
+uint32_t dlu_graph_import_buff(dlu_render_graph *graph, uint32_t cur_bd) {
+  uint32_t r = add_res(graph);
+  if (r == UINT32_MAX) return r;
+
+  graph->res[r].idx = cur_bd;
+  return r;
+}
+
+uint32_t dlu_graph_create_image(
+  dlu_render_graph *graph,
+  uint32_t cur_tex,
+  const VkImageCreateInfo *img_info,
+  const VkImageViewCreateInfo *ivi
+) {
+
+  uint32_t r = add_res(graph);
+  if (r == UINT32_MAX) return r;
+
+  graph->res[r].image = graph->res[r].transient = true;
+  graph->res[r].idx = cur_tex;
+  graph->res[r].img_info = *img_info;
+  graph->res[r].view_info = *ivi;
+  graph->res[r].range = ivi->subresourceRange;
+
+  return r;
+}
+
+uint32_t dlu_graph_create_buff(dlu_render_graph *graph, uint32_t cur_bd, VkDeviceSize size, VkBufferUsageFlags usage) {
+  uint32_t r = add_res(graph);
+  if (r == UINT32_MAX) return r;
+
+  graph->res[r].transient = true;
+  graph->res[r].idx = cur_bd;
+  graph->res[r].buff_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  graph->res[r].buff_info.size = size;
+  graph->res[r].buff_info.usage = usage;
+  graph->res[r].buff_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  return r;
+}
+
+uint32_t dlu_graph_add_pass(dlu_render_graph *graph, const char *name, dlu_graph_record_func record, void *data) {
+  if (graph->compiled) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "already compiled"); return UINT32_MAX; }
+  if (graph->pc == DLU_GRAPH_MAX_PASSES) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "DLU_GRAPH_MAX_PASSES reached"); return UINT32_MAX; }
+
+  graph->passes[graph->pc].name = name;
+  graph->passes[graph->pc].record = record;
+  graph->passes[graph->pc].data = data;
+
+  return graph->pc++;
+}
+
+bool dlu_graph_use(
+  dlu_render_graph *graph,
+  uint32_t pass,
+  uint32_t res,
+  VkPipelineStageFlags stage,
+  VkAccessFlags access,
+  VkImageLayout layout
+) {
+
+  if (graph->compiled) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "already compiled"); return false; }
+  if (pass >= graph->pc || res >= graph->rc) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+
+  struct _graph_pass *p = &graph->passes[pass];
+  if (!graph->res[res].image) layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+  /* A pass waits on all of its barriers up front, one entry per resource is all it needs */
+  for (uint32_t i = 0; i < p->uc; i++) {
+    if (p->uses[i].res != res) continue;
+    if (p->uses[i].layout != layout) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "one layout per resource per pass"); return false; }
+    p->uses[i].stage |= stage;
+    p->uses[i].access |= access;
+    return true;
+  }
+
+  if (p->uc == DLU_GRAPH_MAX_USES) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "DLU_GRAPH_MAX_USES reached"); return false; }
+
+  p->uses[p->uc++] = (struct _graph_use) { .res = res, .stage = stage, .access = access, .layout = layout };
+  return true;
+}
+
+/**
+* Walk backwards from the imported resources (the graph's outputs). A pass lives if it
+* writes something a live pass (or the outside world) reads, its reads then become needed.
+*/
+static void cull_passes(dlu_render_graph *graph) {
+  bool needed[DLU_GRAPH_MAX_RESOURCES];
+
+  for (uint32_t r = 0; r < graph->rc; r++)
+    needed[r] = !graph->res[r].transient;
+
+  for (uint32_t p = graph->pc; p--;) {
+    struct _graph_pass *pass = &graph->passes[p];
+    pass->culled = true;
+
+    for (uint32_t u = 0; u < pass->uc; u++)
+      if ((pass->uses[u].access & GRAPH_WRITE_ACCESS) && needed[pass->uses[u].res])
+        pass->culled = false;
+
+    if (pass->culled) continue;
+
+    for (uint32_t u = 0; u < pass->uc; u++)
+      if (pass->uses[u].access & ~GRAPH_WRITE_ACCESS)
+        needed[pass->uses[u].res] = true;
+  }
+
+  for (uint32_t p = 0; p < graph->pc; p++) {
+    if (graph->passes[p].culled) continue;
+    for (uint32_t u = 0; u < graph->passes[p].uc; u++) {
+      struct _graph_res *res = &graph->res[graph->passes[p].uses[u].res];
+      if (res->first == UINT32_MAX) res->first = p;
+      res->last = p;
+    }
+  }
+}
+
+static uint32_t slot_kind(struct _graph_res *res) {
+  if (!res->image) return 0;
+  return (res->img_info.tiling == VK_IMAGE_TILING_OPTIMAL) ? 1 : 2;
+}
+
+/**
+* Greedily pack transient resources ordered by first use into slots, a resource
+* joins the first slot of its kind whose last user finished before it starts.
+*/
+static void assign_slots(dlu_render_graph *graph) {
+  uint32_t order[DLU_GRAPH_MAX_RESOURCES], oc = 0;
+
+  for (uint32_t r = 0; r < graph->rc; r++) {
+    if (!graph->res[r].transient || graph->res[r].first == UINT32_MAX) continue;
+    uint32_t i = oc++;
+    for (; i && graph->res[order[i-1]].first > graph->res[r].first; i--)
+      order[i] = order[i-1];
+    order[i] = r;
+  }
+
+  for (uint32_t i = 0; i < oc; i++) {
+    struct _graph_res *res = &graph->res[order[i]];
+    bool lazy = res->image && (res->img_info.usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT);
+    uint32_t s = 0;
+
+    for (; s < graph->sc; s++) {
+      struct _graph_slot *slot = &graph->slots[s];
+      if (slot->last < res->first && slot_kind(&graph->res[slot->owner]) == slot_kind(res) &&
+          (slot->reqs.memoryTypeBits & res->reqs.memoryTypeBits))
+        break;
+    }
+
+    struct _graph_slot *slot = &graph->slots[s];
+    if (s == graph->sc) {
+      graph->sc++;
+      slot->owner = order[i];
+      slot->reqs = res->reqs;
+      slot->lazy = lazy;
+    } else {
+      slot->reqs.size = (res->reqs.size > slot->reqs.size) ? res->reqs.size : slot->reqs.size;
+      slot->reqs.alignment = (res->reqs.alignment > slot->reqs.alignment) ? res->reqs.alignment : slot->reqs.alignment;
+      slot->reqs.memoryTypeBits &= res->reqs.memoryTypeBits;
+      slot->lazy &= lazy;
+    }
+
+    slot->last = res->last;
+    res->slot = s;
+  }
+}
+
+static VkResult create_transient(vkcomp *app, dlu_render_graph *graph) {
+  VkResult res = VK_SUCCESS;
+  VkDevice device = app->ld_data[graph->ldi].device;
+
+  for (uint32_t r = 0; r < graph->rc; r++) {
+    struct _graph_res *gr = &graph->res[r];
+    if (!gr->transient || gr->first == UINT32_MAX) continue;
+
+    if (gr->image) {
+      res = vkCreateImage(device, &gr->img_info, NULL, &app->text_data[gr->idx].image);
+      if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateImage"); return res; }
+      app->text_data[gr->idx].ldi = graph->ldi;
+      vkGetImageMemoryRequirements(device, app->text_data[gr->idx].image, &gr->reqs);
+    } else {
+      res = vkCreateBuffer(device, &gr->buff_info, NULL, &app->buff_data[gr->idx].buff);
+      if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateBuffer"); return res; }
+      app->buff_data[gr->idx].ldi = graph->ldi;
+      vkGetBufferMemoryRequirements(device, app->buff_data[gr->idx].buff, &gr->reqs);
+    }
+  }
+
+  assign_slots(graph);
+
+  for (uint32_t s = 0; s < graph->sc; s++) {
+    struct _graph_slot *slot = &graph->slots[s];
+    struct _graph_res *owner = &graph->res[slot->owner];
+    VkDeviceMemory mem = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0, size = 0;
+    void *mapped = NULL;
+
+    if (!slot->reqs.memoryTypeBits) { PERR(DLU_MEM_TYPE_ERR, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+    VkMemoryPropertyFlags mask = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    if (slot->lazy) mask |= VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+
+    res = dlu_vk_mem_alloc(app, graph->ldi, &slot->reqs, mask, slot_kind(owner) == 1, &mem, &offset, &size, &mapped);
+    if (res) return res;
+
+    for (uint32_t r = 0; r < graph->rc; r++) {
+      struct _graph_res *gr = &graph->res[r];
+      if (!gr->transient || gr->slot != s) continue;
+
+      /* Aliases have no size, only the owner gives the memory back */
+      VkDeviceSize alloc_size = (r == slot->owner) ? size : 0;
+
+      if (gr->image) {
+        struct _text_data *tex = &app->text_data[gr->idx];
+        tex->mem = mem; tex->offset = offset; tex->size = alloc_size; tex->mapped = mapped;
+
+        res = vkBindImageMemory(device, tex->image, mem, offset);
+        if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBindImageMemory"); return res; }
+
+        gr->view_info.image = tex->image;
+        res = vkCreateImageView(device, &gr->view_info, NULL, &tex->view);
+        if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateImageView"); return res; }
+      } else {
+        struct _buff_data *bd = &app->buff_data[gr->idx];
+        bd->mem = mem; bd->offset = offset; bd->size = alloc_size; bd->mapped = mapped;
+
+        res = vkBindBufferMemory(device, bd->buff, mem, offset);
+        if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBindBufferMemory"); return res; }
+      }
+    }
+  }
+
+  return res;
+}
+
+static VkImage res_image(vkcomp *app, struct _graph_res *res) {
+  return (res->transient) ? app->text_data[res->idx].image : res->vk_image;
+}
+
+/**
+* Add the barrier (if any) a use needs to batch. Layout transitions get their own image
+* barrier, every other hazard folds into the batch's global memory barrier.
+*/
+static void track_use(vkcomp *app, dlu_render_graph *graph, struct graph_state *st, struct _graph_use *use, struct _graph_batch *batch) {
+  struct _graph_res *res = &graph->res[use->res];
+  bool write = use->access & GRAPH_WRITE_ACCESS;
+  VkPipelineStageFlags src_stage = 0;
+  VkAccessFlags src_access = 0;
+
+  /* A new occupant of an aliased slot discards whatever the last one left */
+  bool discard = st->res != use->res;
+  if (discard) { st->res = use->res; st->layout = VK_IMAGE_LAYOUT_UNDEFINED; }
+
+  bool transition = res->image && use->layout != st->layout;
+
+  if (write || transition || discard) {
+    src_stage = st->write_stage | st->read_stage;
+    src_access = st->write_access;
+    st->write_stage = use->stage;
+    st->write_access = use->access & GRAPH_WRITE_ACCESS;
+    st->read_stage = (write) ? 0 : use->stage;
+    st->visible_stage = (write) ? 0 : use->stage;
+    st->visible_access = (write) ? 0 : use->access;
+  } else {
+    if (st->write_stage && ((use->stage & ~st->visible_stage) || (st->write_access && (use->access & ~st->visible_access)))) {
+      src_stage = st->write_stage;
+      src_access = st->write_access;
+      st->visible_stage |= use->stage;
+      st->visible_access |= use->access;
+    }
+    st->read_stage |= use->stage;
+  }
+
+  if (!src_stage && !transition) return;
+
+  batch->src_stage |= (src_stage) ? src_stage : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+  batch->dst_stage |= use->stage;
+
+  if (transition) {
+    graph->img_barriers[batch->ibi + batch->ibc++] = dlu_set_image_mem_barrier(src_access, use->access, st->layout, use->layout,
+                                                                              VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                                                              res_image(app, res), res->range);
+    st->layout = use->layout;
+    return;
+  }
+
+  batch->mbc = 1;
+  batch->mem_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+  batch->mem_barrier.srcAccessMask |= src_access;
+  batch->mem_barrier.dstAccessMask |= use->access;
+}
+
+/* Reset the state every slot (and imported resource) starts a frame with */
+static void begin_frame(dlu_render_graph *graph, struct graph_state *states) {
+  for (uint32_t r = 0; r < graph->rc; r++) {
+    struct _graph_res *res = &graph->res[r];
+    if (res->first == UINT32_MAX) continue;
+
+    struct graph_state *st = &states[(res->transient) ? res->slot : DLU_GRAPH_MAX_RESOURCES + r];
+    if (res->transient) {
+      st->res = UINT32_MAX;
+    } else {
+      st->res = r;
+      st->layout = res->initial_layout;
+    }
+  }
+}
+
+/**
+* Simulate one frame to learn the state every resource ends in, then derive the barriers
+* of the next frame from it. That way first uses wait on the previous frame's last use.
+*/
+static void derive_barriers(vkcomp *app, dlu_render_graph *graph) {
+  struct graph_state states[DLU_GRAPH_MAX_RESOURCES * 2];
+  memset(states, 0, sizeof(states));
+
+  for (uint32_t frame = 0; frame < 2; frame++) {
+    begin_frame(graph, states);
+    graph->ibc = 0;
+
+    for (uint32_t p = 0; p < graph->pc; p++) {
+      struct _graph_pass *pass = &graph->passes[p];
+      if (pass->culled) continue;
+
+      memset(&pass->batch, 0, sizeof(pass->batch));
+      pass->batch.ibi = graph->ibc;
+
+      for (uint32_t u = 0; u < pass->uc; u++) {
+        struct _graph_res *res = &graph->res[pass->uses[u].res];
+        track_use(app, graph, &states[(res->transient) ? res->slot : DLU_GRAPH_MAX_RESOURCES + pass->uses[u].res], &pass->uses[u], &pass->batch);
+      }
+
+      graph->ibc += pass->batch.ibc;
+    }
+  }
+
+  memset(&graph->final, 0, sizeof(graph->final));
+  graph->final.ibi = graph->ibc;
+
+  for (uint32_t r = 0; r < graph->rc; r++) {
+    struct _graph_res *res = &graph->res[r];
+    struct graph_state *st = &states[DLU_GRAPH_MAX_RESOURCES + r];
+    if (res->transient || !res->image || res->final_layout == VK_IMAGE_LAYOUT_UNDEFINED || res->final_layout == st->layout)
+      continue;
+
+    graph->final.src_stage |= (st->write_stage | st->read_stage) ? (st->write_stage | st->read_stage) : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    graph->final.dst_stage |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    graph->img_barriers[graph->ibc + graph->final.ibc++] = dlu_set_image_mem_barrier(st->write_access, 0, st->layout, res->final_layout,
+                                                                                     VK_QUEUE_FAMILY_IGNORED, VK_QUEUE_FAMILY_IGNORED,
+                                                                                     res->vk_image, res->range);
+  }
+
+  graph->ibc += graph->final.ibc;
+}
+
+VkResult dlu_graph_compile(vkcomp *app, dlu_render_graph *graph) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (graph->compiled) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "already compiled"); return res; }
+
+  for (uint32_t r = 0; r < graph->rc; r++) {
+    if (!graph->res[r].transient) continue;
+    if (graph->res[r].image && !app->text_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_TEXT_DATA"); return res; }
+    if (!graph->res[r].image && !app->buff_data) { PERR(DLU_BUFF_NOT_ALLOC, 0, "DLU_BUFF_DATA"); return res; }
+  }
+
+  cull_passes(graph);
+
+  res = create_transient(app, graph);
+  if (res) return res;
+
+  derive_barriers(app, graph);
+  graph->compiled = true;
+
+  return res;
+}
+
+static void record_batch(dlu_render_graph *graph, struct _graph_batch *batch, VkCommandBuffer cmd_buff) {
+  if (!batch->mbc && !batch->ibc) return;
+
+  dlu_exec_pipeline_barrier(batch->src_stage, batch->dst_stage, 0, batch->mbc, &batch->mem_barrier,
+                            0, NULL, batch->ibc, &graph->img_barriers[batch->ibi], cmd_buff);
+}
+
+void dlu_graph_execute(vkcomp *app, dlu_render_graph *graph, VkCommandBuffer cmd_buff) {
+  if (!graph->compiled) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "must make a call to dlu_graph_compile()"); return; }
+
+  for (uint32_t p = 0; p < graph->pc; p++) {
+    struct _graph_pass *pass = &graph->passes[p];
+    if (pass->culled) continue;
+
+    record_batch(graph, &pass->batch, cmd_buff);
+    if (pass->record) pass->record(app, cmd_buff, pass->data);
+  }
+
+  record_batch(graph, &graph->final, cmd_buff);
+}
+
+VkImage dlu_graph_image(vkcomp *app, dlu_render_graph *graph, uint32_t res) {
+  if (res >= graph->rc || !graph->res[res].image) return VK_NULL_HANDLE;
+  return res_image(app, &graph->res[res]);
+}
+
+VkImageView dlu_graph_image_view(vkcomp *app, dlu_render_graph *graph, uint32_t res) {
+  if (res >= graph->rc || !graph->res[res].image || !graph->res[res].transient) return VK_NULL_HANDLE;
+  return app->text_data[graph->res[res].idx].view;
+}
+
+VkBuffer dlu_graph_buff(vkcomp *app, dlu_render_graph *graph, uint32_t res) {
+  if (res >= graph->rc || graph->res[res].image) return VK_NULL_HANDLE;
+  return app->buff_data[graph->res[res].idx].buff;
+}
+
+static void dump_batch(dlu_render_graph *graph, struct _graph_batch *batch, int fd) {
+  dprintf(fd, "{ \"src_stage\": %u, \"dst_stage\": %u, \"memory_barriers\": %u, \"src_access\": %u, \"dst_access\": %u, \"image_barriers\": [",
+          batch->src_stage, batch->dst_stage, batch->mbc, batch->mem_barrier.srcAccessMask, batch->mem_barrier.dstAccessMask);
+
+  for (uint32_t i = 0; i < batch->ibc; i++) {
+    VkImageMemoryBarrier *ib = &graph->img_barriers[batch->ibi + i];
+    dprintf(fd, "%s{ \"old_layout\": %u, \"new_layout\": %u, \"src_access\": %u, \"dst_access\": %u }",
+            (i) ? ", " : "", ib->oldLayout, ib->newLayout, ib->srcAccessMask, ib->dstAccessMask);
+  }
+
+  dprintf(fd, "] }");
+}
+
+bool dlu_graph_dump(dlu_render_graph *graph, int fd) {
+  if (fd < 0) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+  if (!graph->compiled) { PERR(DLU_VKCOMP_RENDER_GRAPH, 0, "must make a call to dlu_graph_compile()"); return false; }
+
+  dprintf(fd, "{\n  \"passes\": [\n");
+  for (uint32_t p = 0; p < graph->pc; p++) {
+    struct _graph_pass *pass = &graph->passes[p];
+    dprintf(fd, "    { \"name\": \"%s\", \"culled\": %s", (pass->name) ? pass->name : "", (pass->culled) ? "true" : "false");
+    if (!pass->culled) { dprintf(fd, ", \"barriers\": "); dump_batch(graph, &pass->batch, fd); }
+    dprintf(fd, " }%s\n", (p + 1 < graph->pc) ? "," : "");
+  }
+
+  dprintf(fd, "  ],\n  \"final_barriers\": ");
+  dump_batch(graph, &graph->final, fd);
+
+  VkDeviceSize unaliased = 0, aliased = 0;
+
+  dprintf(fd, ",\n  \"resources\": [\n");
+  for (uint32_t r = 0; r < graph->rc; r++) {
+    struct _graph_res *res = &graph->res[r];
+    bool live = res->first != UINT32_MAX;
+
+    dprintf(fd, "    { \"type\": \"%s\", \"index\": %d, \"transient\": %s, \"first\": %d, \"last\": %d, \"slot\": %d, \"size\": %lu }%s\n",
+            (res->image) ? "image" : "buffer", (res->image && !res->transient) ? NEG_ONE : (int) res->idx, (res->transient) ? "true" : "false",
+            (live) ? (int) res->first : NEG_ONE, (live) ? (int) res->last : NEG_ONE,
+            (res->transient && live) ? (int) res->slot : NEG_ONE, (unsigned long) res->reqs.size,
+            (r + 1 < graph->rc) ? "," : "");
+
+    if (res->transient && live) unaliased += res->reqs.size;
+  }
+
+  for (uint32_t s = 0; s < graph->sc; s++)
+    aliased += graph->slots[s].reqs.size;
+
+  dprintf(fd, "  ],\n  \"memory\": { \"slots\": %u, \"unaliased\": %lu, \"aliased\": %lu }\n}\n",
+          graph->sc, (unsigned long) unaliased, (unsigned long) aliased);
+
+  return true;
+}
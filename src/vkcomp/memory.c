@@ -0,0 +1,428 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#include <lucom.h>
+
+/**
+* Device memory is handed out from large VkDeviceMemory blocks with a buddy allocator.
+* Each block keeps a binary tree where every node stores the largest free order
+* (plus one, zero meaning nothing free) found in its subtree. Sub-allocations are
+* power of two sized and naturally aligned to their size, so resource alignment is
+* covered by rounding up. Linear resources (buffers, linear images) and optimal images
+* never share a block, which keeps bufferImageGranularity from ever coming into play.
+* Host visible blocks are mapped once when created and stay mapped until freed.
+*/
+#define MEM_MIN_ORDER 10 /* 1KB, smallest sub-allocation */
+
+struct _dlu_vk_mem_block {
+  VkDeviceMemory mem;
+  VkDeviceSize size;
+  VkDeviceSize used;
+  uint32_t alloc_cnt;
+  uint32_t type_idx;
+  uint32_t heap_idx;
+  bool optimal;   /* Holds VK_IMAGE_TILING_OPTIMAL images */
+  bool dedicated; /* Holds a single resource too large for a block */
+  bool coherent;  /* No flush/invalidate required */
+  void *mapped;   /* Persistent mapping of the whole block, NULL if not host visible */
+  VkDeviceSize atom; /* nonCoherentAtomSize, flushed ranges are rounded to it */
+  uint8_t max_order;
+  uint8_t *tree;
+  struct _dlu_vk_mem_block *next;
+};
+
+static uint8_t get_order(VkDeviceSize bytes) {
+  uint8_t order = MEM_MIN_ORDER;
+  while (((VkDeviceSize) 1 << order) < bytes) order++;
+  return order;
+}
+
+/* Largest power of two block no bigger than an eighth of the heap */
+static VkDeviceSize get_block_size(VkDeviceSize heap_size) {
+  VkDeviceSize size = DLU_VK_MEM_BLOCK_SIZE;
+  while (size > ((VkDeviceSize) 1 << MEM_MIN_ORDER) && size > (heap_size >> 3)) size >>= 1;
+  return size;
+}
+
+static void update_parents(struct _dlu_vk_mem_block *block, uint32_t node, uint8_t order) {
+  while (node) {
+    uint32_t parent = (node - 1) >> 1, left = (parent << 1) + 1, right = left + 1;
+    order++;
+
+    /* Both halves completely free, merge them back into their parent */
+    if (block->tree[left] == order && block->tree[right] == order)
+      block->tree[parent] = order + 1;
+    else
+      block->tree[parent] = (block->tree[left] > block->tree[right]) ? block->tree[left] : block->tree[right];
+
+    node = parent;
+  }
+}
+
+static bool buddy_alloc(struct _dlu_vk_mem_block *block, uint8_t order, VkDeviceSize *offset) {
+  uint32_t node = 0;
+  uint8_t cur = block->max_order;
+
+  if (block->tree[0] < order + 1) return false;
+
+  /* Walk down to a free node of the requested order, preferring the left half */
+  for (; cur > order; cur--) {
+    uint32_t left = (node << 1) + 1;
+    node = (block->tree[left] >= order + 1) ? left : left + 1;
+  }
+
+  block->tree[node] = 0;
+  update_parents(block, node, order);
+
+  *offset = (VkDeviceSize) (node - ((1U << (block->max_order - order)) - 1)) << order;
+  return true;
+}
+
+static void buddy_free(struct _dlu_vk_mem_block *block, uint8_t order, VkDeviceSize offset) {
+  uint32_t node = ((1U << (block->max_order - order)) - 1) + (uint32_t) (offset >> order);
+  block->tree[node] = order + 1;
+  update_parents(block, node, order);
+}
+
+static struct _dlu_vk_mem_block *create_block(
+  vkcomp *app,
+  uint32_t cur_ld,
+  VkDeviceSize size,
+  uint32_t type_idx,
+  VkMemoryType *mem_type,
+  bool optimal,
+  bool dedicated
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _dlu_vk_mem_block *block = calloc(1, sizeof(struct _dlu_vk_mem_block));
+  if (!block) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); return NULL; }
+
+  block->size = size;
+  block->type_idx = type_idx;
+  block->heap_idx = mem_type->heapIndex;
+  block->optimal = optimal;
+  block->dedicated = dedicated;
+
+  if (!dedicated) {
+    block->max_order = get_order(size);
+
+    /* One byte per node, 2^(levels) - 1 nodes */
+    uint32_t nodes = (2U << (block->max_order - MEM_MIN_ORDER)) - 1;
+    block->tree = calloc(nodes, sizeof(uint8_t));
+    if (!block->tree) { dlu_log_me(DLU_DANGER, "[x] calloc: %s", strerror(errno)); free(block); return NULL; }
+
+    for (uint32_t i = 0, level_end = 0, order = block->max_order + 1; i < nodes; i++) {
+      block->tree[i] = order;
+      if (i == level_end) { order--; level_end = (level_end << 1) + 2; }
+    }
+  }
+
+  VkMemoryAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+  alloc_info.pNext = NULL;
+  alloc_info.allocationSize = size;
+  alloc_info.memoryTypeIndex = type_idx;
+
+  res = vkAllocateMemory(app->ld_data[cur_ld].device, &alloc_info, NULL, &block->mem);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateMemory"); free(block->tree); free(block); return NULL; }
+
+  /* One vkMapMemory per block, resources just offset into it */
+  if (mem_type->propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+    res = vkMapMemory(app->ld_data[cur_ld].device, block->mem, 0, VK_WHOLE_SIZE, 0, &block->mapped);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkMapMemory"); block->mapped = NULL; }
+
+    block->coherent = mem_type->propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    if (!block->coherent) {
+      VkPhysicalDeviceProperties props;
+      vkGetPhysicalDeviceProperties(app->pd_data[app->ld_data[cur_ld].pdi].phys_dev, &props);
+      block->atom = props.limits.nonCoherentAtomSize;
+    }
+  }
+
+  block->next = app->ld_data[cur_ld].mem_blocks;
+  app->ld_data[cur_ld].mem_blocks = block;
+
+  return block;
+}
+
+static bool over_budget(vkcomp *app, uint32_t cur_ld, uint32_t heap, VkDeviceSize bytes) {
+  /* Without VK_EXT_memory_budget the budget is only an estimate, don't act on it */
+  if (!app->pd_data[app->ld_data[cur_ld].pdi].mem_budget || !app->get_mem_props2) return false;
+
+  dlu_vk_heap_budget budgets[VK_MAX_MEMORY_HEAPS];
+  dlu_vk_get_mem_budget(app, cur_ld, budgets);
+  return budgets[heap].usage + bytes > budgets[heap].budget;
+}
+
+VkResult dlu_vk_mem_alloc(
+  vkcomp *app,
+  uint32_t cur_ld,
+  VkMemoryRequirements *mem_reqs,
+  VkMemoryPropertyFlags requirements_mask,
+  bool optimal,
+  VkDeviceMemory *mem,
+  VkDeviceSize *offset,
+  VkDeviceSize *size,
+  void **mapped
+) {
+
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _dlu_vk_mem_block *block = NULL;
+  uint32_t type_idx = 0;
+
+  /* Lazily allocated memory is only a preference, not every device has it */
+  if (!memory_type_from_properties(app, app->ld_data[cur_ld].pdi, mem_reqs->memoryTypeBits, requirements_mask, &type_idx) &&
+      (!(requirements_mask & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) ||
+       !memory_type_from_properties(app, app->ld_data[cur_ld].pdi, mem_reqs->memoryTypeBits,
+                                    requirements_mask & ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT, &type_idx))) {
+    PERR(DLU_MEM_TYPE_ERR, 0, NULL);
+    return res;
+  }
+
+  VkPhysicalDeviceMemoryProperties *memory_properties = get_memory_properties(app, app->ld_data[cur_ld].pdi);
+  VkMemoryType *mem_type = &memory_properties->memoryTypes[type_idx];
+  VkDeviceSize block_size = get_block_size(memory_properties->memoryHeaps[mem_type->heapIndex].size);
+
+  VkDeviceSize bytes = (mem_reqs->size > mem_reqs->alignment) ? mem_reqs->size : mem_reqs->alignment;
+  uint8_t order = get_order(bytes);
+
+  /* Anything over half a block gets its own VkDeviceMemory */
+  if (((VkDeviceSize) 1 << order) > (block_size >> 1)) {
+    block = create_block(app, cur_ld, mem_reqs->size, type_idx, mem_type, optimal, true);
+    if (!block) return res;
+
+    block->used = block->size;
+    block->alloc_cnt = 1;
+    *mem = block->mem; *offset = 0; *size = block->size;
+    if (mapped) *mapped = block->mapped;
+    return VK_SUCCESS;
+  }
+
+  for (block = app->ld_data[cur_ld].mem_blocks; block; block = block->next) {
+    if (block->dedicated || block->type_idx != type_idx || block->optimal != optimal) continue;
+    if (buddy_alloc(block, order, offset)) break;
+  }
+
+  /**
+  * A whole new block would push the heap over its budget, only allocate what's needed.
+  * Leaves the rest of the budget to the caller's eviction decisions.
+  */
+  if (!block && over_budget(app, cur_ld, mem_type->heapIndex, block_size)) {
+    block = create_block(app, cur_ld, mem_reqs->size, type_idx, mem_type, optimal, true);
+    if (!block) return res;
+
+    block->used = block->size;
+    block->alloc_cnt = 1;
+    *mem = block->mem; *offset = 0; *size = block->size;
+    if (mapped) *mapped = block->mapped;
+    return VK_SUCCESS;
+  }
+
+  if (!block) {
+    block = create_block(app, cur_ld, block_size, type_idx, mem_type, optimal, false);
+    if (!block) return res;
+    if (!buddy_alloc(block, order, offset)) return res;
+  }
+
+  block->used += (VkDeviceSize) 1 << order;
+  block->alloc_cnt++;
+  *mem = block->mem; *size = (VkDeviceSize) 1 << order;
+  if (mapped) *mapped = (block->mapped) ? block->mapped + *offset : NULL;
+
+  return VK_SUCCESS;
+}
+
+static struct _dlu_vk_mem_block *find_block(vkcomp *app, uint32_t cur_ld, VkDeviceMemory mem) {
+  struct _dlu_vk_mem_block *block = app->ld_data[cur_ld].mem_blocks;
+  while (block && block->mem != mem) block = block->next;
+  return block;
+}
+
+VkResult dlu_vk_mem_flush(vkcomp *app, uint32_t cur_ld, VkDeviceMemory mem, VkDeviceSize offset, VkDeviceSize size, bool invalidate) {
+  VkResult res = VK_SUCCESS;
+
+  struct _dlu_vk_mem_block *block = find_block(app, cur_ld, mem);
+  if (!block || !block->mapped) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return VK_RESULT_MAX_ENUM; }
+  if (block->coherent) return res;
+
+  /* Ranges must start and end on a nonCoherentAtomSize multiple, or the end of the block */
+  VkDeviceSize atom = (block->atom) ? block->atom : 1;
+  VkDeviceSize end = ((offset + size + atom - 1) / atom) * atom;
+
+  VkMappedMemoryRange range = {};
+  range.sType = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+  range.pNext = NULL;
+  range.memory = mem;
+  range.offset = (offset / atom) * atom;
+  range.size = (end >= block->size) ? VK_WHOLE_SIZE : end - range.offset;
+
+  if (invalidate) {
+    res = vkInvalidateMappedMemoryRanges(app->ld_data[cur_ld].device, 1, &range);
+    if (res) PERR(DLU_VK_FUNC_ERR, res, "vkInvalidateMappedMemoryRanges")
+  } else {
+    res = vkFlushMappedMemoryRanges(app->ld_data[cur_ld].device, 1, &range);
+    if (res) PERR(DLU_VK_FUNC_ERR, res, "vkFlushMappedMemoryRanges")
+  }
+
+  return res;
+}
+
+void dlu_vk_mem_free(vkcomp *app, uint32_t cur_ld, VkDeviceMemory mem, VkDeviceSize offset, VkDeviceSize size) {
+  struct _dlu_vk_mem_block *block = NULL, **prev = &app->ld_data[cur_ld].mem_blocks;
+
+  for (block = *prev; block; prev = &block->next, block = block->next)
+    if (block->mem == mem) break;
+
+  if (!block) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return; }
+
+  /* Dedicated blocks and emptied blocks go back to the driver */
+  if (!block->dedicated) {
+    buddy_free(block, get_order(size), offset);
+    block->used -= size;
+  }
+
+  if (--block->alloc_cnt) return;
+
+  *prev = block->next;
+  vkFreeMemory(app->ld_data[cur_ld].device, block->mem, NULL);
+  free(block->tree);
+  free(block);
+}
+
+void dlu_vk_mem_destroy(vkcomp *app, uint32_t cur_ld) {
+  struct _dlu_vk_mem_block *block = app->ld_data[cur_ld].mem_blocks, *next = NULL;
+
+  for (; block; block = next) {
+    next = block->next;
+    vkFreeMemory(app->ld_data[cur_ld].device, block->mem, NULL);
+    free(block->tree);
+    free(block);
+  }
+
+  app->ld_data[cur_ld].mem_blocks = NULL;
+}
+
+void dlu_vk_free_mem(dlu_mem_map_type type, vkcomp *app, uint32_t cur_idx) {
+  switch (type) {
+    case DLU_VK_BUFFER:
+      if (!app->buff_data[cur_idx].mem) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return; }
+      /* Buffers aliased by a render graph don't own their memory */
+      if (app->buff_data[cur_idx].size)
+        dlu_vk_mem_free(app, app->buff_data[cur_idx].ldi, app->buff_data[cur_idx].mem,
+                        app->buff_data[cur_idx].offset, app->buff_data[cur_idx].size);
+      app->buff_data[cur_idx].mem = VK_NULL_HANDLE;
+      app->buff_data[cur_idx].mapped = NULL;
+      break;
+    case DLU_TEXT_VK_IMAGE:
+      if (!app->text_data[cur_idx].mem) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return; }
+      /* Aliases created by dlu_create_aliased_images(3) or a render graph don't own their memory */
+      if (app->text_data[cur_idx].size)
+        dlu_vk_mem_free(app, app->text_data[cur_idx].ldi, app->text_data[cur_idx].mem,
+                        app->text_data[cur_idx].offset, app->text_data[cur_idx].size);
+      app->text_data[cur_idx].mem = VK_NULL_HANDLE;
+      app->text_data[cur_idx].mapped = NULL;
+      break;
+    default: break;
+  }
+}
+
+VkResult dlu_vk_write_buff(vkcomp *app, uint32_t cur_bd, VkDeviceSize offset, const void *data, VkDeviceSize size) {
+  if (!app->buff_data[cur_bd].mapped) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  memcpy(app->buff_data[cur_bd].mapped + offset, data, size);
+
+  return dlu_vk_flush_buff(app, cur_bd, offset, size);
+}
+
+VkResult dlu_vk_flush_buff(vkcomp *app, uint32_t cur_bd, VkDeviceSize offset, VkDeviceSize size) {
+  return dlu_vk_mem_flush(app, app->buff_data[cur_bd].ldi, app->buff_data[cur_bd].mem,
+                          app->buff_data[cur_bd].offset + offset, size, false);
+}
+
+VkResult dlu_vk_invalidate_buff(vkcomp *app, uint32_t cur_bd, VkDeviceSize offset, VkDeviceSize size) {
+  return dlu_vk_mem_flush(app, app->buff_data[cur_bd].ldi, app->buff_data[cur_bd].mem,
+                          app->buff_data[cur_bd].offset + offset, size, true);
+}
+
+void *dlu_vk_instance_stream_frame(vkcomp *app, uint32_t cur_bd, uint32_t cur_frame, VkDeviceSize *offset) {
+  if (!app->buff_data[cur_bd].mapped || !app->buff_data[cur_bd].frame_size) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return NULL; }
+
+  *offset = cur_frame * app->buff_data[cur_bd].frame_size;
+
+  return app->buff_data[cur_bd].mapped + *offset;
+}
+
+bool dlu_vk_get_mem_stats(vkcomp *app, uint32_t cur_ld, uint32_t heap, dlu_vk_mem_stats *stats) {
+  if (!app->ld_data || !stats || heap >= VK_MAX_MEMORY_HEAPS) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return false; }
+
+  memset(stats, 0, sizeof(dlu_vk_mem_stats));
+  for (struct _dlu_vk_mem_block *block = app->ld_data[cur_ld].mem_blocks; block; block = block->next) {
+    if (block->heap_idx != heap) continue;
+    stats->block_cnt++;
+    stats->alloc_cnt += block->alloc_cnt;
+    stats->allocated += block->size;
+    stats->used += block->used;
+  }
+
+  return true;
+}
+
+uint32_t dlu_vk_get_mem_budget(vkcomp *app, uint32_t cur_ld, dlu_vk_heap_budget *budgets) {
+  if (!app->ld_data || !budgets) { PERR(DLU_OP_NOT_PERMITED, 0, NULL); return 0; }
+
+  uint32_t pdi = app->ld_data[cur_ld].pdi;
+  VkPhysicalDeviceMemoryProperties *memory_properties = get_memory_properties(app, pdi);
+
+  if (app->pd_data[pdi].mem_budget && app->get_mem_props2) {
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget_props = {};
+    budget_props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT;
+
+    VkPhysicalDeviceMemoryProperties2 props = {};
+    props.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2;
+    props.pNext = &budget_props;
+
+    /* Usage and budget change with every allocation in the system, always ask the driver */
+    app->get_mem_props2(app->pd_data[pdi].phys_dev, &props);
+
+    for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++) {
+      budgets[i].usage = budget_props.heapUsage[i];
+      budgets[i].budget = budget_props.heapBudget[i];
+    }
+
+    return memory_properties->memoryHeapCount;
+  }
+
+  /* Estimate, usage is what this logical device allocated and 80% of a heap is considered safe */
+  dlu_vk_mem_stats stats;
+  for (uint32_t i = 0; i < memory_properties->memoryHeapCount; i++) {
+    dlu_vk_get_mem_stats(app, cur_ld, i, &stats);
+    budgets[i].usage = stats.allocated;
+    budgets[i].budget = memory_properties->memoryHeaps[i].size / 10 * 8;
+  }
+
+  return memory_properties->memoryHeapCount;
+}
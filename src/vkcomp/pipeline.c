@@ -0,0 +1,440 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#include <lucom.h>
+
+/* Field by field, struct padding would make equal states hash differently */
+#define HASH(hash, val) hash = hash_bytes(hash, &(val), sizeof(val))
+
+void set_obj_hash(vkcomp *app, uint64_t handle, uint64_t hash) {
+  struct _obj_hash *free_slot = NULL;
+
+  if (!handle || !hash) return;
+
+  for (uint32_t i = 0; i < DLU_VK_OBJ_HASH_CNT; i++) {
+    if (app->obj_hashes[i].handle == handle) { app->obj_hashes[i].hash = hash; return; }
+    if (!free_slot && !app->obj_hashes[i].handle) free_slot = &app->obj_hashes[i];
+  }
+
+  /* A full table only means pipelines using the object won't be shared */
+  if (!free_slot) {
+    dlu_log_me(DLU_WARNING, "Object hash table is full, pipelines using this object won't be shared. Raise DLU_VK_OBJ_HASH_CNT");
+    return;
+  }
+  free_slot->handle = handle;
+  free_slot->hash = hash;
+}
+
+void forget_obj_hash(vkcomp *app, uint64_t handle) {
+  if (!handle) return;
+  for (uint32_t i = 0; i < DLU_VK_OBJ_HASH_CNT; i++)
+    if (app->obj_hashes[i].handle == handle)
+      app->obj_hashes[i].handle = app->obj_hashes[i].hash = 0;
+}
+
+static uint64_t get_obj_hash(vkcomp *app, uint64_t handle) {
+  if (!handle) return 0;
+  for (uint32_t i = 0; i < DLU_VK_OBJ_HASH_CNT; i++)
+    if (app->obj_hashes[i].handle == handle)
+      return app->obj_hashes[i].hash;
+  return 0;
+}
+
+static uint64_t hash_attachment_refs(uint64_t hash, uint32_t count, const VkAttachmentReference *refs) {
+  HASH(hash, count);
+  for (uint32_t i = 0; i < count && refs; i++)
+    HASH(hash, refs[i].attachment);
+  return hash;
+}
+
+/**
+* Only what render pass compatibility depends on. Load/store ops and image layouts are
+* left out, a pipeline works with any render pass compatible with the one it was made for.
+*/
+uint64_t hash_render_pass_info(const VkRenderPassCreateInfo *info) {
+  uint64_t hash = DLU_HASH_SEED;
+
+  if (info->pNext) return 0;
+
+  HASH(hash, info->flags);
+  HASH(hash, info->attachmentCount);
+  for (uint32_t i = 0; i < info->attachmentCount; i++) {
+    HASH(hash, info->pAttachments[i].flags);
+    HASH(hash, info->pAttachments[i].format);
+    HASH(hash, info->pAttachments[i].samples);
+  }
+
+  HASH(hash, info->subpassCount);
+  for (uint32_t i = 0; i < info->subpassCount; i++) {
+    const VkSubpassDescription *subpass = &info->pSubpasses[i];
+    uint32_t resolve = !!subpass->pResolveAttachments, depth = !!subpass->pDepthStencilAttachment;
+
+    HASH(hash, subpass->flags);
+    HASH(hash, subpass->pipelineBindPoint);
+    hash = hash_attachment_refs(hash, subpass->inputAttachmentCount, subpass->pInputAttachments);
+    hash = hash_attachment_refs(hash, subpass->colorAttachmentCount, subpass->pColorAttachments);
+    hash = hash_attachment_refs(hash, (resolve) ? subpass->colorAttachmentCount : 0, subpass->pResolveAttachments);
+    hash = hash_attachment_refs(hash, depth, subpass->pDepthStencilAttachment);
+    HASH(hash, subpass->preserveAttachmentCount);
+    hash = hash_bytes(hash, subpass->pPreserveAttachments, subpass->preserveAttachmentCount * sizeof(uint32_t));
+  }
+
+  /* VkSubpassDependency is all 32 bit members, no padding */
+  HASH(hash, info->dependencyCount);
+  hash = hash_bytes(hash, info->pDependencies, info->dependencyCount * sizeof(VkSubpassDependency));
+
+  return hash;
+}
+
+uint64_t hash_pipeline_layout_info(
+  uint32_t layout_count,
+  const VkDescriptorSetLayoutCreateInfo *layout_infos,
+  uint32_t pushConstantRangeCount,
+  const VkPushConstantRange *pPushConstantRanges,
+  VkPipelineLayoutCreateFlags flags
+) {
+
+  uint64_t hash = DLU_HASH_SEED;
+
+  HASH(hash, flags);
+  HASH(hash, layout_count);
+  for (uint32_t i = 0; i < layout_count && layout_infos; i++) {
+    if (layout_infos[i].pNext) return 0;
+
+    HASH(hash, layout_infos[i].flags);
+    HASH(hash, layout_infos[i].bindingCount);
+    for (uint32_t j = 0; j < layout_infos[i].bindingCount; j++) {
+      const VkDescriptorSetLayoutBinding *binding = &layout_infos[i].pBindings[j];
+      HASH(hash, binding->binding);
+      HASH(hash, binding->descriptorType);
+      HASH(hash, binding->descriptorCount);
+      HASH(hash, binding->stageFlags);
+      if (binding->pImmutableSamplers)
+        hash = hash_bytes(hash, binding->pImmutableSamplers, binding->descriptorCount * sizeof(VkSampler));
+    }
+  }
+
+  HASH(hash, pushConstantRangeCount);
+  hash = hash_bytes(hash, pPushConstantRanges, pushConstantRangeCount * sizeof(VkPushConstantRange));
+
+  return hash;
+}
+
+static bool is_dynamic(const VkPipelineDynamicStateCreateInfo *dynamic_state, VkDynamicState state) {
+  for (uint32_t i = 0; dynamic_state && i < dynamic_state->dynamicStateCount; i++)
+    if (dynamic_state->pDynamicStates[i] == state) return true;
+  return false;
+}
+
+/* Feeds val into the key's hash and, if it keeps them, its canonical bytes */
+#define KEY(key, val) key_bytes(key, &(val), sizeof(val))
+
+static void key_bytes(dlu_pipe_key *key, const void *data, size_t size) {
+  key->hash = hash_bytes(key->hash, data, size);
+  if (!key->keep || key->oom || !size) return;
+
+  if (key->size + size > key->cap) {
+    size_t cap = (key->cap) ? key->cap << 1 : 512;
+    while (cap < key->size + size) cap <<= 1;
+
+    unsigned char *bytes = realloc(key->bytes, cap);
+    if (!bytes) { key->oom = true; return; }
+    key->bytes = bytes;
+    key->cap = cap;
+  }
+
+  memcpy(key->bytes + key->size, data, size);
+  key->size += size;
+}
+
+static bool key_stages(vkcomp *app, dlu_pipe_key *key, uint32_t count, const VkPipelineShaderStageCreateInfo *stages) {
+  KEY(key, count);
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t module = get_obj_hash(app, (uint64_t) stages[i].module);
+    if (stages[i].pNext || !module) return false;
+
+    KEY(key, stages[i].flags);
+    KEY(key, stages[i].stage);
+    KEY(key, module);
+    key_bytes(key, stages[i].pName, strlen(stages[i].pName) + 1);
+
+    const VkSpecializationInfo *spec = stages[i].pSpecializationInfo;
+    uint32_t has_spec = !!spec;
+    KEY(key, has_spec);
+    if (!spec) continue;
+
+    KEY(key, spec->mapEntryCount);
+    for (uint32_t j = 0; j < spec->mapEntryCount; j++) {
+      KEY(key, spec->pMapEntries[j].constantID);
+      KEY(key, spec->pMapEntries[j].offset);
+      KEY(key, spec->pMapEntries[j].size);
+    }
+    KEY(key, spec->dataSize);
+    key_bytes(key, spec->pData, spec->dataSize);
+  }
+
+  return true;
+}
+
+static bool key_vertex_input(dlu_pipe_key *key, const VkPipelineVertexInputStateCreateInfo *info) {
+  uint32_t present = !!info;
+  KEY(key, present);
+  if (!info) return true;
+  if (info->pNext) return false;
+
+  KEY(key, info->flags);
+  KEY(key, info->vertexBindingDescriptionCount);
+  for (uint32_t i = 0; i < info->vertexBindingDescriptionCount; i++) {
+    KEY(key, info->pVertexBindingDescriptions[i].binding);
+    KEY(key, info->pVertexBindingDescriptions[i].stride);
+    KEY(key, info->pVertexBindingDescriptions[i].inputRate);
+  }
+
+  KEY(key, info->vertexAttributeDescriptionCount);
+  for (uint32_t i = 0; i < info->vertexAttributeDescriptionCount; i++) {
+    KEY(key, info->pVertexAttributeDescriptions[i].location);
+    KEY(key, info->pVertexAttributeDescriptions[i].binding);
+    KEY(key, info->pVertexAttributeDescriptions[i].format);
+    KEY(key, info->pVertexAttributeDescriptions[i].offset);
+  }
+
+  return true;
+}
+
+static bool key_fixed_function(dlu_pipe_key *key, const VkGraphicsPipelineCreateInfo *info) {
+  const VkPipelineDynamicStateCreateInfo *dynamic_state = info->pDynamicState;
+  uint32_t present = 0;
+
+  const VkPipelineInputAssemblyStateCreateInfo *ia = info->pInputAssemblyState;
+  present = !!ia; KEY(key, present);
+  if (ia) {
+    if (ia->pNext) return false;
+    KEY(key, ia->flags);
+    KEY(key, ia->topology);
+    KEY(key, ia->primitiveRestartEnable);
+  }
+
+  const VkPipelineTessellationStateCreateInfo *ts = info->pTessellationState;
+  present = !!ts; KEY(key, present);
+  if (ts) {
+    if (ts->pNext) return false;
+    KEY(key, ts->flags);
+    KEY(key, ts->patchControlPoints);
+  }
+
+  const VkPipelineViewportStateCreateInfo *vp = info->pViewportState;
+  present = !!vp; KEY(key, present);
+  if (vp) {
+    if (vp->pNext) return false;
+    KEY(key, vp->flags);
+    KEY(key, vp->viewportCount);
+    KEY(key, vp->scissorCount);
+    if (vp->pViewports && !is_dynamic(dynamic_state, VK_DYNAMIC_STATE_VIEWPORT))
+      key_bytes(key, vp->pViewports, vp->viewportCount * sizeof(VkViewport));
+    if (vp->pScissors && !is_dynamic(dynamic_state, VK_DYNAMIC_STATE_SCISSOR))
+      key_bytes(key, vp->pScissors, vp->scissorCount * sizeof(VkRect2D));
+  }
+
+  const VkPipelineRasterizationStateCreateInfo *rs = info->pRasterizationState;
+  present = !!rs; KEY(key, present);
+  if (rs) {
+    if (rs->pNext) return false;
+    KEY(key, rs->flags);
+    KEY(key, rs->depthClampEnable);
+    KEY(key, rs->rasterizerDiscardEnable);
+    KEY(key, rs->polygonMode);
+    KEY(key, rs->cullMode);
+    KEY(key, rs->frontFace);
+    KEY(key, rs->depthBiasEnable);
+    KEY(key, rs->depthBiasConstantFactor);
+    KEY(key, rs->depthBiasClamp);
+    KEY(key, rs->depthBiasSlopeFactor);
+    KEY(key, rs->lineWidth);
+  }
+
+  const VkPipelineMultisampleStateCreateInfo *ms = info->pMultisampleState;
+  present = !!ms; KEY(key, present);
+  if (ms) {
+    if (ms->pNext) return false;
+    KEY(key, ms->flags);
+    KEY(key, ms->rasterizationSamples);
+    KEY(key, ms->sampleShadingEnable);
+    KEY(key, ms->minSampleShading);
+    present = !!ms->pSampleMask; KEY(key, present);
+    if (ms->pSampleMask)
+      key_bytes(key, ms->pSampleMask, ((ms->rasterizationSamples + 31) / 32) * sizeof(VkSampleMask));
+    KEY(key, ms->alphaToCoverageEnable);
+    KEY(key, ms->alphaToOneEnable);
+  }
+
+  /* VkStencilOpState is all 32 bit members, no padding */
+  const VkPipelineDepthStencilStateCreateInfo *ds = info->pDepthStencilState;
+  present = !!ds; KEY(key, present);
+  if (ds) {
+    if (ds->pNext) return false;
+    KEY(key, ds->flags);
+    KEY(key, ds->depthTestEnable);
+    KEY(key, ds->depthWriteEnable);
+    KEY(key, ds->depthCompareOp);
+    KEY(key, ds->depthBoundsTestEnable);
+    KEY(key, ds->stencilTestEnable);
+    KEY(key, ds->front);
+    KEY(key, ds->back);
+    KEY(key, ds->minDepthBounds);
+    KEY(key, ds->maxDepthBounds);
+  }
+
+  /* VkPipelineColorBlendAttachmentState is all 32 bit members as well */
+  const VkPipelineColorBlendStateCreateInfo *cb = info->pColorBlendState;
+  present = !!cb; KEY(key, present);
+  if (cb) {
+    if (cb->pNext) return false;
+    KEY(key, cb->flags);
+    KEY(key, cb->logicOpEnable);
+    KEY(key, cb->logicOp);
+    KEY(key, cb->attachmentCount);
+    key_bytes(key, cb->pAttachments, cb->attachmentCount * sizeof(VkPipelineColorBlendAttachmentState));
+    if (!is_dynamic(dynamic_state, VK_DYNAMIC_STATE_BLEND_CONSTANTS))
+      KEY(key, cb->blendConstants);
+  }
+
+  present = !!dynamic_state; KEY(key, present);
+  if (dynamic_state) {
+    if (dynamic_state->pNext) return false;
+    KEY(key, dynamic_state->flags);
+    KEY(key, dynamic_state->dynamicStateCount);
+    key_bytes(key, dynamic_state->pDynamicStates, dynamic_state->dynamicStateCount * sizeof(VkDynamicState));
+  }
+
+  return true;
+}
+
+static uint64_t key_graphics_pipeline(vkcomp *app, uint32_t cur_ld, const VkGraphicsPipelineCreateInfo *info, dlu_pipe_key *key) {
+  key->hash = DLU_HASH_SEED;
+  key->size = 0;
+
+  if (info->pNext) return key->hash = 0;
+
+  uint64_t layout = get_obj_hash(app, (uint64_t) info->layout);
+  uint64_t render_pass = get_obj_hash(app, (uint64_t) info->renderPass);
+  if (!layout || !render_pass) return key->hash = 0;
+
+  KEY(key, cur_ld);
+  KEY(key, info->flags);
+  KEY(key, layout);
+  KEY(key, render_pass);
+  KEY(key, info->subpass);
+
+  if (!key_stages(app, key, info->stageCount, info->pStages)) return key->hash = 0;
+  if (!key_vertex_input(key, info->pVertexInputState)) return key->hash = 0;
+  if (!key_fixed_function(key, info)) return key->hash = 0;
+
+  /* Without the canonical bytes a hash hit can't be confirmed */
+  if (key->oom) return key->hash = 0;
+
+  /* 0 is reserved for "can't be shared" */
+  return key->hash = (key->hash) ? key->hash : 1;
+}
+
+uint64_t dlu_hash_graphics_pipeline(vkcomp *app, uint32_t cur_ld, const VkGraphicsPipelineCreateInfo *info) {
+  dlu_pipe_key key = { .keep = false };
+  return key_graphics_pipeline(app, cur_ld, info, &key);
+}
+
+uint64_t get_pipe_key(vkcomp *app, uint32_t cur_ld, const VkGraphicsPipelineCreateInfo *info, dlu_pipe_key *key) {
+  *key = (dlu_pipe_key) { .keep = true };
+  if (!key_graphics_pipeline(app, cur_ld, info, key)) free_pipe_key(key);
+  return key->hash;
+}
+
+void free_pipe_key(dlu_pipe_key *key) {
+  free(key->bytes);
+  key->bytes = NULL;
+  key->size = key->cap = 0;
+}
+
+bool same_pipe_key(const dlu_pipe_key *a, const dlu_pipe_key *b) {
+  return a->hash && a->hash == b->hash && a->size == b->size && !memcmp(a->bytes, b->bytes, a->size);
+}
+
+VkPipeline get_shared_pipeline(vkcomp *app, uint32_t cur_ld, const dlu_pipe_key *key) {
+  if (!key->hash) return VK_NULL_HANDLE;
+
+  /* Equal hashes of different state must never share, the canonical bytes decide */
+  for (uint32_t i = 0; i < DLU_VK_PIPE_MAP_CNT; i++) {
+    struct _pipe_entry *entry = &app->pipe_map[i];
+    if (!entry->refs || entry->hash != key->hash || entry->ldi != cur_ld) continue;
+    if (entry->key_size != key->size || memcmp(entry->key, key->bytes, key->size)) continue;
+    entry->refs++;
+    return entry->pipeline;
+  }
+
+  return VK_NULL_HANDLE;
+}
+
+void add_shared_pipeline(vkcomp *app, uint32_t cur_ld, dlu_pipe_key *key, VkPipeline pipeline) {
+  if (!key->hash || !pipeline) return;
+
+  for (uint32_t i = 0; i < DLU_VK_PIPE_MAP_CNT; i++) {
+    struct _pipe_entry *entry = &app->pipe_map[i];
+    if (entry->refs) continue;
+    entry->hash = key->hash;
+    entry->key = key->bytes;
+    entry->key_size = key->size;
+    entry->pipeline = pipeline;
+    entry->refs = 1;
+    entry->ldi = cur_ld;
+    key->bytes = NULL;
+    key->size = key->cap = 0;
+    return;
+  }
+
+  dlu_log_me(DLU_WARNING, "Shared pipeline map is full, pipeline won't be shared. Raise DLU_VK_PIPE_MAP_CNT");
+}
+
+void release_pipeline(vkcomp *app, uint32_t cur_ld, VkPipeline pipeline) {
+  if (!pipeline) return;
+
+  for (uint32_t i = 0; i < DLU_VK_PIPE_MAP_CNT; i++) {
+    struct _pipe_entry *entry = &app->pipe_map[i];
+    if (!entry->refs || entry->pipeline != pipeline) continue;
+    if (--entry->refs) return;
+    free(entry->key);
+    entry->key = NULL;
+    entry->key_size = 0;
+    entry->pipeline = VK_NULL_HANDLE;
+    break;
+  }
+
+  vkDestroyPipeline(app->ld_data[cur_ld].device, pipeline, NULL);
+}
+
+uint32_t dlu_graphics_pipeline_refs(vkcomp *app, VkPipeline pipeline) {
+  for (uint32_t i = 0; pipeline && i < DLU_VK_PIPE_MAP_CNT; i++)
+    if (app->pipe_map[i].refs && app->pipe_map[i].pipeline == pipeline)
+      return app->pipe_map[i].refs;
+  return 0;
+}
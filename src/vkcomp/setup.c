@@ -48,6 +48,8 @@ void dlu_freeup_vk(vkcomp *app) {
     }
   }
 
+  dlu_vk_destroy_uploader(app);
+
   if (app->gp_cache.pipe_cache)
     vkDestroyPipelineCache(app->ld_data[app->gp_cache.ldi].device, app->gp_cache.pipe_cache, NULL);
  
@@ -59,8 +61,6 @@ void dlu_freeup_vk(vkcomp *app) {
         vkDestroyImageView(app->ld_data[app->text_data[i].ldi].device, app->text_data[i].view, NULL);
       if (app->text_data[i].image)
         vkDestroyImage(app->ld_data[app->text_data[i].ldi].device, app->text_data[i].image, NULL);
-      if (app->text_data[i].mem)
-        vkFreeMemory(app->ld_data[app->text_data[i].ldi].device, app->text_data[i].mem, NULL);
     }
   }
 
@@ -70,8 +70,9 @@ void dlu_freeup_vk(vkcomp *app) {
         vkDestroyPipelineLayout(app->ld_data[app->gp_data[i].ldi].device, app->gp_data[i].pipeline_layout, NULL);
       if (app->gp_data[i].render_pass)
         vkDestroyRenderPass(app->ld_data[app->gp_data[i].ldi].device, app->gp_data[i].render_pass, NULL);
+      /* Slots may share a pipeline, it's destroyed with its last reference */
       for (uint32_t j = 0; j < app->gp_data[i].gpc; j++)
-        vkDestroyPipeline(app->ld_data[app->gp_data[i].ldi].device, app->gp_data[i].graphics_pipelines[j], NULL);
+        release_pipeline(app, app->gp_data[i].ldi, app->gp_data[i].graphics_pipelines[j]);
     }
   }
 
@@ -92,8 +93,6 @@ void dlu_freeup_vk(vkcomp *app) {
     for (uint32_t i = 0; i < app->bdc; i++) {
       if (app->buff_data[i].buff)
         vkDestroyBuffer(app->ld_data[app->buff_data[i].ldi].device, app->buff_data[i].buff, NULL);
-      if (app->buff_data[i].mem)
-        vkFreeMemory(app->ld_data[app->buff_data[i].ldi].device, app->buff_data[i].mem, NULL);
     }
   }
 
@@ -103,8 +102,10 @@ void dlu_freeup_vk(vkcomp *app) {
         vkDestroyImageView(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].depth.view, NULL);
       if (app->sc_data[i].depth.image)
         vkDestroyImage(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].depth.image, NULL);
-      if (app->sc_data[i].depth.mem)
-        vkFreeMemory(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].depth.mem, NULL);
+      if (app->sc_data[i].msaa.view)
+        vkDestroyImageView(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].msaa.view, NULL);
+      if (app->sc_data[i].msaa.image)
+        vkDestroyImage(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].msaa.image, NULL);
       if (app->sc_data[i].sc_buffs && app->sc_data[i].syncs) {
         for (uint32_t j = 0; j < app->sc_data[i].sic; j++) {
           if (app->sc_data[i].syncs[j].sem.image)
@@ -119,15 +120,29 @@ void dlu_freeup_vk(vkcomp *app) {
             vkDestroyImageView(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].sc_buffs[j].view, NULL);
         }
       }
+      for (uint32_t j = 0; j < DLU_VK_SEM_POOL_CNT; j++)
+        if (app->sc_data[i].sem_pool[j].sem)
+          vkDestroySemaphore(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].sem_pool[j].sem, NULL);
       if (app->sc_data[i].swap_chain)
         vkDestroySwapchainKHR(app->ld_data[app->sc_data[i].ldi].device, app->sc_data[i].swap_chain, NULL);
     }
   }
 
   if (app->ld_data) {
-    for (uint32_t i = 0; i < app->ldc; i++)
-      if (app->ld_data[i].device)
-        vkDestroyDevice(app->ld_data[i].device, NULL);
+    for (uint32_t i = 0; i < app->ldc; i++) {
+      if (!app->ld_data[i].device) continue;
+      for (uint32_t j = 0; j < DLU_VK_ONE_SHOT_CNT; j++)
+        if (app->ld_data[i].one_shots[j].fence)
+          vkDestroyFence(app->ld_data[i].device, app->ld_data[i].one_shots[j].fence, NULL);
+      if (app->ld_data[i].one_shot_pool)
+        vkDestroyCommandPool(app->ld_data[i].device, app->ld_data[i].one_shot_pool, NULL);
+      for (uint32_t j = 0; j < DLU_VK_QUEUE_CNT; j++)
+        if (app->ld_data[i].timelines[j].sem)
+          vkDestroySemaphore(app->ld_data[i].device, app->ld_data[i].timelines[j].sem, NULL);
+      /* Frees the memory blocks backing every buffer, texture and attachment */
+      dlu_vk_mem_destroy(app, i);
+      vkDestroyDevice(app->ld_data[i].device, NULL);
+    }
   }
 
   if (app->surface)
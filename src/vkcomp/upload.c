@@ -0,0 +1,449 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#include <lucom.h>
+
+VkResult dlu_vk_create_uploader(vkcomp *app, uint32_t cur_ld, VkDeviceSize staging_size) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->ld_data[cur_ld].device) { PERR(DLU_VKCOMP_DEVICE, 0, NULL); return res; }
+  if (app->upload.cmd_pool) { PERR(DLU_ALREADY_ALLOC, 0, NULL); return res; }
+
+  struct _upload_data *up = &app->upload;
+  VkDevice device = app->ld_data[cur_ld].device;
+
+  up->ldi = cur_ld;
+  if (app->ld_data[cur_ld].transfer) {
+    up->queue = app->ld_data[cur_ld].transfer;
+    up->qfam_idx = app->pd_data[app->ld_data[cur_ld].pdi].tfam_idx;
+  } else {
+    dlu_log_me(DLU_WARNING, "[x] No transfer queue, uploads will be submitted to the graphics queue");
+    up->queue = app->ld_data[cur_ld].graphics;
+    up->qfam_idx = app->pd_data[app->ld_data[cur_ld].pdi].gfam_idx;
+  }
+
+  /* Each command buffer is re-recorded once its fence signals */
+  VkCommandPoolCreateInfo pool_info = {};
+  pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+  pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+  pool_info.queueFamilyIndex = up->qfam_idx;
+
+  res = vkCreateCommandPool(device, &pool_info, NULL, &up->cmd_pool);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateCommandPool"); return res; }
+
+  VkCommandBuffer cmd_buffs[DLU_VK_UPLOAD_SLOTS];
+  VkCommandBufferAllocateInfo alloc_info = {};
+  alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+  alloc_info.commandPool = up->cmd_pool;
+  alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+  alloc_info.commandBufferCount = DLU_VK_UPLOAD_SLOTS;
+
+  res = vkAllocateCommandBuffers(device, &alloc_info, cmd_buffs);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkAllocateCommandBuffers"); return res; }
+
+  /* Fences start signaled so every slot is free */
+  VkFenceCreateInfo fence_info = {};
+  fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+  fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+  VkSemaphoreCreateInfo sem_info = {};
+  sem_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    up->slots[i].cmd_buff = cmd_buffs[i];
+
+    res = vkCreateFence(device, &fence_info, NULL, &up->slots[i].fence);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateFence"); return res; }
+
+    res = vkCreateSemaphore(device, &sem_info, NULL, &up->slots[i].sem);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateSemaphore"); return res; }
+  }
+
+  if (!staging_size) return res;
+
+  VkBufferCreateInfo buff_info = {};
+  buff_info.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+  buff_info.size = staging_size;
+  buff_info.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+  buff_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+  res = vkCreateBuffer(device, &buff_info, NULL, &up->ring.buff);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkCreateBuffer"); return res; }
+
+  VkMemoryRequirements mem_reqs;
+  vkGetBufferMemoryRequirements(device, up->ring.buff, &mem_reqs);
+
+  /* Stays mapped, staging data is written straight into the ring */
+  res = dlu_vk_mem_alloc(app, cur_ld, &mem_reqs, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         false, &up->ring.mem, &up->ring.offset, &up->ring.mem_size, &up->ring.mapped);
+  if (res) return res;
+
+  res = vkBindBufferMemory(device, up->ring.buff, up->ring.mem, up->ring.offset);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBindBufferMemory"); return res; }
+
+  up->ring.size = staging_size;
+
+  return res;
+}
+
+static bool slot_in_flight(vkcomp *app, struct _upload_slot *slot) {
+  return slot->recording || vkGetFenceStatus(app->ld_data[app->upload.ldi].device, slot->fence) != VK_SUCCESS;
+}
+
+/**
+* Hand out size bytes of the staging ring to a recording slot. Everything from the
+* start of the oldest slot still in flight up to ring_head is in use. head == tail
+* only ever means empty, allocations that would close the gap are refused.
+*/
+static bool ring_alloc(vkcomp *app, uint32_t slot, VkDeviceSize size, VkDeviceSize *offset) {
+  struct _upload_data *up = &app->upload;
+  VkDeviceSize tail = up->ring.head, off = 0;
+  uint64_t oldest = UINT64_MAX;
+
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    if (up->slots[i].seq >= oldest || !slot_in_flight(app, &up->slots[i])) continue;
+    oldest = up->slots[i].seq;
+    tail = up->slots[i].ring_begin;
+  }
+
+  off = (up->ring.head + DLU_VK_UPLOAD_ALIGN - 1) & ~((VkDeviceSize) DLU_VK_UPLOAD_ALIGN - 1);
+  if (up->ring.head >= tail) {
+    if (off + size > up->ring.size) {
+      if (size >= tail) return false;
+      off = 0; /* wrap around */
+    }
+  } else if (off + size >= tail) {
+    return false;
+  }
+
+  up->ring.head = off + size;
+  up->slots[slot].ring_end = up->ring.head;
+  *offset = off;
+
+  return true;
+}
+
+VkCommandBuffer dlu_vk_upload_begin(vkcomp *app, uint32_t *slot) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _upload_data *up = &app->upload;
+
+  if (!up->cmd_pool) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return VK_NULL_HANDLE; }
+
+  /* Nothing copies from the staging ring anymore, start over at the front */
+  bool idle = true;
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS && idle; i++)
+    idle = !slot_in_flight(app, &up->slots[i]);
+  if (idle) up->ring.head = 0;
+
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    if (up->slots[i].sem_pending || slot_in_flight(app, &up->slots[i])) continue;
+
+    VkCommandBufferBeginInfo begin_info = {};
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    /* Beginning implicitly resets the command buffer */
+    res = vkBeginCommandBuffer(up->slots[i].cmd_buff, &begin_info);
+    if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkBeginCommandBuffer"); return VK_NULL_HANDLE; }
+
+    up->slots[i].recording = true;
+    up->slots[i].seq = up->seq++;
+    up->slots[i].ring_begin = up->slots[i].ring_end = up->ring.head;
+    *slot = i;
+    return up->slots[i].cmd_buff;
+  }
+
+  return VK_NULL_HANDLE;
+}
+
+VkResult dlu_vk_upload_submit(vkcomp *app, uint32_t slot, bool signal_sem) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _upload_data *up = &app->upload;
+
+  if (!up->cmd_pool || !up->slots[slot].recording) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return res; }
+
+  up->slots[slot].recording = false;
+
+  res = vkEndCommandBuffer(up->slots[slot].cmd_buff);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkEndCommandBuffer"); return res; }
+
+  res = vkResetFences(app->ld_data[up->ldi].device, 1, &up->slots[slot].fence);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkResetFences"); return res; }
+
+  VkSubmitInfo submit_info = {};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &up->slots[slot].cmd_buff;
+  submit_info.signalSemaphoreCount = (signal_sem) ? 1 : 0;
+  submit_info.pSignalSemaphores = (signal_sem) ? &up->slots[slot].sem : NULL;
+
+  res = vkQueueSubmit(up->queue, 1, &submit_info, up->slots[slot].fence);
+  if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkQueueSubmit"); return res; }
+
+  up->slots[slot].sem_pending = signal_sem;
+
+  return res;
+}
+
+bool dlu_vk_upload_done(vkcomp *app, uint32_t slot) {
+  struct _upload_data *up = &app->upload;
+  if (!up->cmd_pool || up->slots[slot].recording) return false;
+  return vkGetFenceStatus(app->ld_data[up->ldi].device, up->slots[slot].fence) == VK_SUCCESS;
+}
+
+VkResult dlu_vk_upload_wait(vkcomp *app, uint32_t slot, uint64_t timeout) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+  struct _upload_data *up = &app->upload;
+
+  if (!up->cmd_pool) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return res; }
+
+  res = vkWaitForFences(app->ld_data[up->ldi].device, 1, &up->slots[slot].fence, VK_TRUE, timeout);
+  if (res && res != VK_TIMEOUT) PERR(DLU_VK_FUNC_ERR, res, "vkWaitForFences");
+
+  return res;
+}
+
+VkSemaphore dlu_vk_upload_wait_sem(vkcomp *app, uint32_t slot) {
+  struct _upload_data *up = &app->upload;
+  if (!up->cmd_pool || !up->slots[slot].sem_pending) return VK_NULL_HANDLE;
+  up->slots[slot].sem_pending = false;
+  return up->slots[slot].sem;
+}
+
+VkResult dlu_vk_upload_stage(vkcomp *app, uint32_t slot, const void *data, VkDeviceSize size, VkDeviceSize *offset) {
+  struct _upload_data *up = &app->upload;
+
+  if (!up->ring.buff || !up->slots[slot].recording) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return VK_RESULT_MAX_ENUM; }
+
+  /* Not an error, submit what's recorded and try again once a slot completed */
+  if (!ring_alloc(app, slot, size, offset)) return VK_NOT_READY;
+
+  memcpy((char *) up->ring.mapped + *offset, data, size);
+
+  return VK_SUCCESS;
+}
+
+VkResult dlu_vk_upload_buff(vkcomp *app, uint32_t slot, uint32_t cur_bd, VkDeviceSize dstOffset, const void *data, VkDeviceSize size) {
+  VkDeviceSize offset = 0;
+
+  VkResult res = dlu_vk_upload_stage(app, slot, data, size, &offset);
+  if (res) return res;
+
+  VkBufferCopy region = {};
+  region.srcOffset = offset;
+  region.dstOffset = dstOffset;
+  region.size = size;
+
+  vkCmdCopyBuffer(app->upload.slots[slot].cmd_buff, app->upload.ring.buff, app->buff_data[cur_bd].buff, 1, &region);
+
+  return res;
+}
+
+VkResult dlu_vk_upload_image(
+  vkcomp *app,
+  uint32_t slot,
+  uint32_t cur_tex,
+  const void *data,
+  VkDeviceSize size,
+  uint32_t regionCount,
+  const VkBufferImageCopy *pRegions,
+  VkImageSubresourceRange subresourceRange,
+  VkImageLayout finalLayout
+) {
+
+  VkDeviceSize offset = 0;
+  VkCommandBuffer cmd_buff = app->upload.slots[slot].cmd_buff;
+
+  VkResult res = dlu_vk_upload_stage(app, slot, data, size, &offset);
+  if (res) return res;
+
+  /* Region offsets are relative to data, rebase them onto the staging ring */
+  VkBufferImageCopy *regions = (VkBufferImageCopy *) alloca(regionCount * sizeof(VkBufferImageCopy));
+
+  for (uint32_t i = 0; i < regionCount; i++) {
+    regions[i] = pRegions[i];
+    regions[i].bufferOffset += offset;
+  }
+
+  /* Previous contents are discarded */
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+  barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+  barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+  barrier.image = app->text_data[cur_tex].image;
+  barrier.subresourceRange = subresourceRange;
+
+  vkCmdPipelineBarrier(cmd_buff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, NULL, 0, NULL, 1, &barrier);
+
+  vkCmdCopyBufferToImage(cmd_buff, app->upload.ring.buff, app->text_data[cur_tex].image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regionCount, regions);
+
+  dlu_vk_upload_release_image(app, slot, cur_tex, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, finalLayout, subresourceRange);
+
+  return res;
+}
+
+/**
+* Release and acquire must match in everything but the stage/access masks, see
+* "Queue Family Ownership Transfer" in the Vulkan specification
+*/
+static bool upload_qfot(vkcomp *app, uint32_t *src_qfam, uint32_t *dst_qfam) {
+  *src_qfam = app->upload.qfam_idx;
+  *dst_qfam = app->pd_data[app->ld_data[app->upload.ldi].pdi].gfam_idx;
+  if (*src_qfam != *dst_qfam) return true;
+  *src_qfam = *dst_qfam = VK_QUEUE_FAMILY_IGNORED;
+  return false;
+}
+
+void dlu_vk_upload_release_image(
+  vkcomp *app,
+  uint32_t slot,
+  uint32_t cur_tex,
+  VkImageLayout oldLayout,
+  VkImageLayout newLayout,
+  VkImageSubresourceRange subresourceRange
+) {
+
+  if (!app->upload.cmd_pool || !app->upload.slots[slot].recording) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return; }
+
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.image = app->text_data[cur_tex].image;
+  barrier.subresourceRange = subresourceRange;
+
+  /* The destination scope is ignored on a release, the acquire provides it */
+  VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  if (!upload_qfot(app, &barrier.srcQueueFamilyIndex, &barrier.dstQueueFamilyIndex)) {
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    dst_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  }
+
+  vkCmdPipelineBarrier(app->upload.slots[slot].cmd_buff, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+void dlu_vk_upload_acquire_image(
+  vkcomp *app,
+  uint32_t cur_tex,
+  VkImageLayout oldLayout,
+  VkImageLayout newLayout,
+  VkImageSubresourceRange subresourceRange,
+  VkPipelineStageFlags dstStageMask,
+  VkAccessFlags dstAccessMask,
+  VkCommandBuffer cmd_buff
+) {
+
+  if (!app->upload.cmd_pool) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return; }
+
+  VkImageMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+  barrier.dstAccessMask = dstAccessMask;
+  barrier.oldLayout = oldLayout;
+  barrier.newLayout = newLayout;
+  barrier.image = app->text_data[cur_tex].image;
+  barrier.subresourceRange = subresourceRange;
+
+  /* Same family, the release already did the layout transition */
+  if (!upload_qfot(app, &barrier.srcQueueFamilyIndex, &barrier.dstQueueFamilyIndex)) return;
+
+  vkCmdPipelineBarrier(cmd_buff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, NULL, 0, NULL, 1, &barrier);
+}
+
+void dlu_vk_upload_release_buff(vkcomp *app, uint32_t slot, uint32_t cur_bd, VkDeviceSize offset, VkDeviceSize size) {
+
+  if (!app->upload.cmd_pool || !app->upload.slots[slot].recording) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return; }
+
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+  barrier.buffer = app->buff_data[cur_bd].buff;
+  barrier.offset = offset;
+  barrier.size = size;
+
+  VkPipelineStageFlags dst_stage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+  if (!upload_qfot(app, &barrier.srcQueueFamilyIndex, &barrier.dstQueueFamilyIndex)) {
+    barrier.dstAccessMask = VK_ACCESS_MEMORY_READ_BIT;
+    dst_stage = VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+  }
+
+  vkCmdPipelineBarrier(app->upload.slots[slot].cmd_buff, VK_PIPELINE_STAGE_TRANSFER_BIT, dst_stage, 0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+void dlu_vk_upload_acquire_buff(
+  vkcomp *app,
+  uint32_t cur_bd,
+  VkDeviceSize offset,
+  VkDeviceSize size,
+  VkPipelineStageFlags dstStageMask,
+  VkAccessFlags dstAccessMask,
+  VkCommandBuffer cmd_buff
+) {
+
+  if (!app->upload.cmd_pool) { PERR(DLU_VKCOMP_UPLOADER, 0, NULL); return; }
+
+  VkBufferMemoryBarrier barrier = {};
+  barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+  barrier.dstAccessMask = dstAccessMask;
+  barrier.buffer = app->buff_data[cur_bd].buff;
+  barrier.offset = offset;
+  barrier.size = size;
+
+  if (!upload_qfot(app, &barrier.srcQueueFamilyIndex, &barrier.dstQueueFamilyIndex)) return;
+
+  vkCmdPipelineBarrier(cmd_buff, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dstStageMask, 0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
+void dlu_vk_destroy_uploader(vkcomp *app) {
+  struct _upload_data *up = &app->upload;
+  if (!up->cmd_pool) return;
+
+  VkDevice device = app->ld_data[up->ldi].device;
+
+  /* Uploads may still be in flight */
+  if (up->queue) vkQueueWaitIdle(up->queue);
+
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    if (up->slots[i].fence)
+      vkDestroyFence(device, up->slots[i].fence, NULL);
+    if (up->slots[i].sem)
+      vkDestroySemaphore(device, up->slots[i].sem, NULL);
+  }
+
+  if (up->ring.buff)
+    vkDestroyBuffer(device, up->ring.buff, NULL);
+  if (up->ring.mem)
+    dlu_vk_mem_free(app, up->ldi, up->ring.mem, up->ring.offset, up->ring.mem_size);
+
+  /* Frees the command buffers as well */
+  vkDestroyCommandPool(device, up->cmd_pool, NULL);
+
+  /* Nothing stale survives, recreating without a staging ring can't write through the old one */
+  memset(up, 0, sizeof(struct _upload_data));
+}
@@ -25,17 +25,23 @@
 #define LUCUR_VKCOMP_API
 #include <lucom.h>
 
+VkPhysicalDeviceMemoryProperties *get_memory_properties(vkcomp *app, uint32_t pdi) {
+  /* Every device has at least one memory type, zero means not queried yet */
+  if (!app->pd_data[pdi].mem_props.memoryTypeCount)
+    vkGetPhysicalDeviceMemoryProperties(app->pd_data[pdi].phys_dev, &app->pd_data[pdi].mem_props);
+  return &app->pd_data[pdi].mem_props;
+}
+
 /* Can find in vulkan SDK API-Samples/utils/util.cpp */
 bool memory_type_from_properties(vkcomp *app, uint32_t pdi, uint32_t typeBits, VkFlags requirements_mask, uint32_t *typeIndex) {
 
-  VkPhysicalDeviceMemoryProperties memory_properties;
-  vkGetPhysicalDeviceMemoryProperties(app->pd_data[pdi].phys_dev, &memory_properties);
+  VkPhysicalDeviceMemoryProperties *memory_properties = get_memory_properties(app, pdi);
 
   /* Search memtypes to find first index with those properties */
-  for (uint32_t i = 0; i < memory_properties.memoryTypeCount; i++) {
+  for (uint32_t i = 0; i < memory_properties->memoryTypeCount; i++) {
     if ((typeBits & 1) == 1) {
-      /* Type is available, does it match user properties */
-      if (memory_properties.memoryTypes[i].propertyFlags & requirements_mask) {
+      /* Type is available, does it have every property asked for */
+      if ((memory_properties->memoryTypes[i].propertyFlags & requirements_mask) == requirements_mask) {
         *typeIndex = i;
         return true;
       }
@@ -45,3 +51,12 @@ bool memory_type_from_properties(vkcomp *app, uint32_t pdi, uint32_t typeBits, V
   /* No memory types matched, return failure */
   return false;
 }
+
+uint64_t hash_bytes(uint64_t hash, const void *data, size_t size) {
+  const uint8_t *bytes = (const uint8_t *) data;
+  for (size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
@@ -66,20 +66,47 @@ VkResult dlu_vk_sync(dlu_sync_type type, vkcomp *app, uint32_t cur_scd, uint32_t
   return res;
 }
 
+VkResult dlu_vk_wait_timeline(vkcomp *app, uint32_t cur_ld, dlu_queue_type queue, uint64_t value, uint64_t timeout) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->ld_data[cur_ld].timelines[queue].sem) { PERR(DLU_VKCOMP_SC_SYNCS, 0, NULL); return res; }
+
+  VkSemaphoreWaitInfoKHR wait_info = {};
+  wait_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO_KHR;
+  wait_info.pNext = NULL;
+  wait_info.flags = 0;
+  wait_info.semaphoreCount = 1;
+  wait_info.pSemaphores = &app->ld_data[cur_ld].timelines[queue].sem;
+  wait_info.pValues = &value;
+
+  res = app->ld_data[cur_ld].wait_sems(app->ld_data[cur_ld].device, &wait_info, timeout);
+  if (res && res != VK_TIMEOUT) PERR(DLU_VK_FUNC_ERR, res, "vkWaitSemaphoresKHR")
+
+  return res;
+}
+
+VkResult dlu_vk_get_timeline(vkcomp *app, uint32_t cur_ld, dlu_queue_type queue, uint64_t *value) {
+  VkResult res = VK_RESULT_MAX_ENUM;
+
+  if (!app->ld_data[cur_ld].timelines[queue].sem) { PERR(DLU_VKCOMP_SC_SYNCS, 0, NULL); return res; }
+
+  res = app->ld_data[cur_ld].get_sem_value(app->ld_data[cur_ld].device, app->ld_data[cur_ld].timelines[queue].sem, value);
+  if (res) PERR(DLU_VK_FUNC_ERR, res, "vkGetSemaphoreCounterValueKHR")
+
+  return res;
+}
+
 void dlu_vk_destroy(dlu_destroy_type type, vkcomp *app, uint32_t cur_ld, void *data) {
   switch (type) {
       case DLU_DESTROY_VK_SHADER:
         {VkShaderModule shader_module = (VkShaderModule) data;
-         if (shader_module) vkDestroyShaderModule(app->ld_data[cur_ld].device, shader_module, NULL);}
+         if (shader_module) vkDestroyShaderModule(app->ld_data[cur_ld].device, shader_module, NULL);
+         forget_obj_hash(app, (uint64_t) shader_module);}
         break;
       case DLU_DESTROY_VK_BUFFER:
         {VkBuffer buff = (VkBuffer) data;
          if (buff) vkDestroyBuffer(app->ld_data[cur_ld].device, buff, NULL);}
         break;
-      case DLU_DESTROY_VK_MEMORY:
-        {VkDeviceMemory mem = (VkDeviceMemory) data;
-         if (mem) vkFreeMemory(app->ld_data[cur_ld].device, mem, NULL);}
-        break;
       case DLU_DESTROY_VK_CMD_POOL:
         {VkCommandPool pool = (VkCommandPool) data; 
          if (pool) vkDestroyCommandPool(app->ld_data[cur_ld].device, pool, NULL);}
@@ -102,15 +129,17 @@ void dlu_vk_destroy(dlu_destroy_type type, vkcomp *app, uint32_t cur_ld, void *d
         break;
       case DLU_DESTROY_VK_RENDER_PASS:
         {VkRenderPass rp = (VkRenderPass) data;
-         if (rp) vkDestroyRenderPass(app->ld_data[cur_ld].device, rp, NULL);}
+         if (rp) vkDestroyRenderPass(app->ld_data[cur_ld].device, rp, NULL);
+         forget_obj_hash(app, (uint64_t) rp);}
         break;
       case DLU_DESTROY_VK_PIPE_LAYOUT:
         {VkPipelineLayout pipe_layout = (VkPipelineLayout) data;
-         if (pipe_layout) vkDestroyPipelineLayout(app->ld_data[cur_ld].device, pipe_layout, NULL);}
+         if (pipe_layout) vkDestroyPipelineLayout(app->ld_data[cur_ld].device, pipe_layout, NULL);
+         forget_obj_hash(app, (uint64_t) pipe_layout);}
         break;
       case DLU_DESTROY_PIPELINE:
         {VkPipeline pipeline = (VkPipeline) data;
-         if (pipeline) vkDestroyPipeline(app->ld_data[cur_ld].device, pipeline, NULL);}
+         release_pipeline(app, cur_ld, pipeline);}
         break;
       case DLU_DESTROY_VK_SAMPLER:
         {VkSampler sampler = (VkSampler) data;
@@ -154,39 +183,51 @@ VkResult dlu_vk_map_mem(
 ) {
 
   VkResult res = VK_RESULT_MAX_ENUM;
-  VkDevice device = VK_NULL_HANDLE;
   VkDeviceMemory mem = VK_NULL_HANDLE;
+  VkDeviceSize mem_offset = 0;
+  uint32_t cur_ld = 0;
+  void *mapped = NULL;
 
   switch (type) {
     case DLU_VK_BUFFER:
       if (!app->buff_data[cur_idx].mem) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return res; }
-      device = app->ld_data[app->buff_data[cur_idx].ldi].device;
+      cur_ld = app->buff_data[cur_idx].ldi;
       mem = app->buff_data[cur_idx].mem;
+      mem_offset = app->buff_data[cur_idx].offset;
+      mapped = app->buff_data[cur_idx].mapped;
       break;
     case DLU_TEXT_VK_IMAGE:
       if (!app->text_data[cur_idx].mem) { PERR(DLU_VKCOMP_BUFF_MEM, 0, NULL); return res; }
-      device = app->ld_data[app->text_data[cur_idx].ldi].device;
+      cur_ld = app->text_data[cur_idx].ldi;
       mem = app->text_data[cur_idx].mem;
+      mem_offset = app->text_data[cur_idx].offset;
+      mapped = app->text_data[cur_idx].mapped;
       break;
-    default: break;
+    default: return res;
+  }
+
+  /**
+  * Host visible memory stays mapped, see dlu_vk_mem_alloc(3). So updating it
+  * is a plain copy, plus a flush when the memory isn't coherent.
+  */
+  if (mapped) {
+    memmove(mapped + offset, data, size);
+    return dlu_vk_mem_flush(app, cur_ld, mem, mem_offset + offset, size, false);
   }
 
   /**
   * Can Find in vulkan SDK doc/tutorial/html/07-init_uniform_buffer.html
   * With any buffer, you need to populate it with the data that
   * you want the shader to read. In order to get CPU access to
-  * the memory, you need to map it
+  * the memory, you need to map it. Only reached if the persistent
+  * mapping failed, resources are sub-allocated so offset is relative
+  * to the resource not the VkDeviceMemory.
   */
   void *p_data = NULL;
-  res = vkMapMemory(device, mem, offset, size, flags, &p_data);
+  res = vkMapMemory(app->ld_data[cur_ld].device, mem, mem_offset + offset, size, flags, &p_data);
   if (res) { PERR(DLU_VK_FUNC_ERR, res, "vkMapMemory"); return res; }
   memmove(p_data, data, size);
-
-  /**
-  * Memory map and unmap takes time need to come up with something that
-  * doesn't involve constant memory maps
-  */
-  vkUnmapMemory(device, mem);
+  vkUnmapMemory(app->ld_data[cur_ld].device, mem);
 
   return res;
 }
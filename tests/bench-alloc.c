@@ -0,0 +1,129 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <pthread.h>
+
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+/**
+* Contention benchmark for dlu_alloc(3). N threads hammer DLU_SMALL_BLOCK_PRIV
+* either through the shared lock-free path or through their own dlu_otta(3)
+* arena. Every allocation is stamped with its owner and verified afterwards
+* so overlapping sub-blocks fail the run.
+*/
+
+#define MAX_THREADS 16
+#define ALLOCS_PER_THREAD 20000
+#define ALLOC_BYTES 48
+
+struct bench_args {
+  pthread_t thread;
+  uint32_t id;
+  bool use_arena;
+  unsigned char *addrs[ALLOCS_PER_THREAD];
+  bool failed;
+};
+
+static void *bench_thread(void *data) {
+  struct bench_args *args = (struct bench_args *) data;
+
+  if (args->use_arena && !dlu_otta(DLU_SMALL_BLOCK_PRIV, ALLOCS_PER_THREAD * ALLOC_BYTES)) {
+    args->failed = true;
+    return NULL;
+  }
+
+  for (uint32_t i = 0; i < ALLOCS_PER_THREAD; i++) {
+    args->addrs[i] = dlu_alloc(DLU_SMALL_BLOCK_PRIV, ALLOC_BYTES);
+    if (!args->addrs[i]) { args->failed = true; return NULL; }
+    memset(args->addrs[i], args->id, ALLOC_BYTES);
+  }
+
+  return NULL;
+}
+
+static bool run_bench(uint32_t nthreads, bool use_arena) {
+  static struct bench_args args[MAX_THREADS];
+  bool ret = false;
+
+  dlu_otma_mems ma = {
+    .cha_cnt = nthreads * ALLOCS_PER_THREAD * ALLOC_BYTES,
+    .ta_cnt = (use_arena) ? nthreads : 0,
+    .ta_bytes = ALLOCS_PER_THREAD * ALLOC_BYTES
+  };
+
+  /* The shared path stores metadata in front of every allocation, account for it */
+  if (!use_arena) ma.cha_cnt *= 2;
+
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return false;
+
+  uint64_t start = dlu_hrnst();
+  for (uint32_t t = 0; t < nthreads; t++) {
+    args[t].id = t + 1;
+    args[t].use_arena = use_arena;
+    args[t].failed = false;
+    if (pthread_create(&args[t].thread, NULL, bench_thread, &args[t])) goto finish_run_bench;
+  }
+
+  for (uint32_t t = 0; t < nthreads; t++)
+    pthread_join(args[t].thread, NULL);
+  uint64_t end = dlu_hrnst();
+
+  for (uint32_t t = 0; t < nthreads; t++) {
+    if (args[t].failed) {
+      dlu_log_me(DLU_DANGER, "[x] thread %u failed to allocate", args[t].id);
+      goto finish_run_bench;
+    }
+
+    for (uint32_t i = 0; i < ALLOCS_PER_THREAD; i++) {
+      for (uint32_t j = 0; j < ALLOC_BYTES; j++) {
+        if (args[t].addrs[i][j] != args[t].id) {
+          dlu_log_me(DLU_DANGER, "[x] thread %u allocation %u was overwritten", args[t].id, i);
+          goto finish_run_bench;
+        }
+      }
+    }
+  }
+
+  dlu_log_me(DLU_SUCCESS, "%-12s threads: %2u, allocs: %7u, %8.2f ns/alloc",
+             (use_arena) ? "thread arena" : "lock-free", nthreads, nthreads * ALLOCS_PER_THREAD,
+             (double) (end - start) / (nthreads * ALLOCS_PER_THREAD));
+
+  ret = true;
+finish_run_bench:
+  dlu_release_blocks();
+  return ret;
+}
+
+int main(void) {
+  long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t max_threads = (ncpus > 0 && ncpus < MAX_THREADS) ? (uint32_t) ncpus : MAX_THREADS;
+
+  for (uint32_t n = 1; n <= max_threads; n *= 2) {
+    if (!run_bench(n, false)) return EXIT_FAILURE;
+    if (!run_bench(n, true)) return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
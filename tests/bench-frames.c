@@ -0,0 +1,229 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+#include <pthread.h>
+
+/**
+* Measures what dlu_vk_set_frames_in_flight(3) trades. Every frame the CPU spends a fixed
+* amount of time "simulating" then records GPU work, i.e. clearing a large buffer a few times.
+* Input is sampled right after dlu_vk_begin_frame(3) returns, a waiter thread stamps the frame
+* once its graphics timeline value signals. Runs headless, so latency ends at GPU completion
+* rather than on screen. Reports throughput and input to completion latency per frame count.
+*/
+
+#define FRAMES 300
+#define CPU_WORK_NS 2000000
+#define BUFF_SIZE (64 << 20)
+#define FILLS 8
+
+struct waiter {
+  vkcomp *app;
+  uint64_t values[FRAMES];
+  uint64_t input[FRAMES];
+  uint64_t done[FRAMES];
+  uint32_t submitted;
+  uint32_t quit;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+};
+
+/* Waits on frames in submission order, timeline values only ever grow */
+static void *wait_frames(void *arg) {
+  struct waiter *w = (struct waiter *) arg;
+
+  for (uint32_t f = 0; f < FRAMES; f++) {
+    pthread_mutex_lock(&w->lock);
+    while (f >= w->submitted && !w->quit) pthread_cond_wait(&w->cond, &w->lock);
+    bool quit = (f >= w->submitted);
+    uint64_t value = w->values[f];
+    pthread_mutex_unlock(&w->lock);
+    if (quit) break;
+
+    if (dlu_vk_wait_timeline(w->app, 0, DLU_VK_GRAPHICS_QUEUE, value, UINT64_MAX)) break;
+    w->done[f] = dlu_hrnst();
+  }
+
+  return NULL;
+}
+
+static void spin(uint64_t ns) {
+  uint64_t start = dlu_hrnst();
+  while (dlu_hrnst() - start < ns);
+}
+
+static VkResult setup_device(vkcomp *app) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkPhysicalDeviceProperties device_props;
+  VkPhysicalDeviceFeatures device_feats;
+
+  err = dlu_create_instance(app, "Frames Bench", "No Engine", 0, NULL, 0, NULL);
+  if (err) return err;
+
+  VkPhysicalDeviceType types[] = {
+    VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU
+  };
+
+  for (uint32_t i = 0; i < ARR_LEN(types); i++)
+    if (!(err = dlu_create_physical_device(app, 0, types[i], &device_props, &device_feats))) break;
+  if (err) return err;
+
+  if (!dlu_create_queue_families(app, 0, VK_QUEUE_GRAPHICS_BIT)) return VK_RESULT_MAX_ENUM;
+
+  float queue_priorities[1] = {1.0};
+  VkDeviceQueueCreateInfo dqueue_create_info[1];
+  dqueue_create_info[0] = dlu_set_device_queue_info(0, app->pd_data[0].gfam_idx, 1, queue_priorities);
+
+  const char *device_extensions[] = { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+  err = dlu_create_logical_device(app, 0, 0, 0, ARR_LEN(dqueue_create_info), dqueue_create_info, NULL, ARR_LEN(device_extensions), device_extensions);
+  if (err) return err;
+
+  return dlu_create_device_queue(app, 0, 0, VK_QUEUE_GRAPHICS_BIT) ? VK_RESULT_MAX_ENUM : VK_SUCCESS;
+}
+
+static VkResult run(vkcomp *app, uint32_t frame_cnt) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  pthread_t thread;
+  uint32_t cur_pool = 0, cur_img = 0;
+
+  struct waiter *w = calloc(1, sizeof(struct waiter));
+  if (!w) return err;
+
+  w->app = app;
+  pthread_mutex_init(&w->lock, NULL);
+  pthread_cond_init(&w->cond, NULL);
+
+  err = dlu_vk_set_frames_in_flight(app, 0, frame_cnt);
+  if (err) goto exit_run;
+
+  if (pthread_create(&thread, NULL, wait_frames, w)) { err = VK_RESULT_MAX_ENUM; goto exit_run; }
+
+  uint64_t start = dlu_hrnst();
+  for (uint32_t f = 0; f < FRAMES; f++) {
+    VkCommandBuffer cmd_buff = dlu_vk_begin_frame(app, 0, UINT64_MAX, &cur_pool, &cur_img);
+    if (!cmd_buff) { err = VK_RESULT_MAX_ENUM; break; }
+
+    w->input[f] = dlu_hrnst();
+    spin(CPU_WORK_NS);
+
+    /* Every fill overwrites the last, the previous frame's included */
+    VkMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .pNext = NULL,
+      .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT };
+    for (uint32_t i = 0; i < FILLS; i++) {
+      dlu_exec_pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL, cmd_buff);
+      dlu_exec_fill_buffer(app, 0, 0, BUFF_SIZE, f + i, cmd_buff);
+    }
+
+    uint64_t value = 0;
+    err = dlu_vk_end_frame(app, 0, VK_PIPELINE_STAGE_TRANSFER_BIT, &value);
+    if (err) break;
+
+    pthread_mutex_lock(&w->lock);
+    w->values[f] = value;
+    w->submitted = f + 1;
+    pthread_cond_signal(&w->cond);
+    pthread_mutex_unlock(&w->lock);
+  }
+
+  pthread_mutex_lock(&w->lock);
+  w->quit = 1;
+  pthread_cond_signal(&w->cond);
+  pthread_mutex_unlock(&w->lock);
+  pthread_join(thread, NULL);
+  if (err) goto exit_run;
+
+  uint64_t total = 0, worst = 0;
+  for (uint32_t f = 0; f < FRAMES; f++) {
+    uint64_t latency = w->done[f] - w->input[f];
+    total += latency;
+    worst = (latency > worst) ? latency : worst;
+  }
+
+  double secs = (w->done[FRAMES-1] - start) / 1e9;
+  dlu_log_me(DLU_SUCCESS, "  %u frame(s) in flight: %8.1f fps, latency avg %7.3f ms, max %7.3f ms",
+             frame_cnt, FRAMES / secs, total / 1e6 / FRAMES, worst / 1e6);
+
+exit_run:
+  pthread_cond_destroy(&w->cond);
+  pthread_mutex_destroy(&w->lock);
+  free(w);
+  return err;
+}
+
+int main(void) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  int ret = EXIT_FAILURE;
+
+  dlu_otma_mems ma = {
+    .vkcomp_cnt = 1, .pd_cnt = 1, .ld_cnt = 1, .scd_cnt = 1, .cmdd_cnt = DLU_VK_MAX_FRAMES,
+    .cb_cnt = DLU_VK_MAX_FRAMES, .bd_cnt = 1
+  };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return EXIT_FAILURE;
+
+  vkcomp *app = dlu_init_vk();
+  if (!app) goto exit_bench;
+
+  if (!dlu_otba(DLU_PD_DATA, app, INDEX_IGNORE, ma.pd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_LD_DATA, app, INDEX_IGNORE, ma.ld_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_SC_DATA, app, INDEX_IGNORE, ma.scd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_CMD_DATA, app, INDEX_IGNORE, ma.cmdd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_BUFF_DATA, app, INDEX_IGNORE, ma.bd_cnt)) goto exit_bench;
+
+  /* No swap chain, frames are submitted but never presented */
+  if (!dlu_otba(DLU_SC_DATA_MEMS, app, 0, 0)) goto exit_bench;
+  for (uint32_t i = 0; i < DLU_VK_MAX_FRAMES; i++)
+    if (!dlu_otba(DLU_CMD_DATA_MEMS, app, i, 1)) goto exit_bench;
+
+  err = setup_device(app);
+  if (err) goto exit_bench;
+
+  app->sc_data[0].ldi = 0;
+
+  err = dlu_create_vk_buffer(app, 0, 0, BUFF_SIZE, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                             VK_SHARING_MODE_EXCLUSIVE, 0, NULL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (err) goto exit_bench;
+
+  err = dlu_vk_create_frames(app, 0, 0, 1);
+  if (err) goto exit_bench;
+
+  dlu_log_me(DLU_SUCCESS, "%u frames, %.1f ms CPU work and %u x %u MB fills each", FRAMES, CPU_WORK_NS / 1e6, FILLS, BUFF_SIZE >> 20);
+  for (uint32_t frame_cnt = 1; frame_cnt <= DLU_VK_MAX_FRAMES; frame_cnt++) {
+    err = run(app, frame_cnt);
+    if (err) goto exit_bench;
+  }
+
+  err = dlu_vk_sync(DLU_VK_WAIT_GRAPHICS_QUEUE, app, 0, 0);
+  if (err) goto exit_bench;
+
+  ret = EXIT_SUCCESS;
+
+exit_bench:
+  if (app) dlu_freeup_vk(app);
+  dlu_release_blocks();
+  return ret;
+}
@@ -0,0 +1,377 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#define LUCUR_VKCOMP_API
+#define LUCUR_SPIRV_API
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+/**
+* Compares the CPU cost of recording one dlu_exec_cmd_draw_indexed(3) per object
+* against GPU driven drawing. For the latter a compute pass culls every object's
+* bounding sphere against the frustum, appends a VkDrawIndexedIndirectCommand per
+* survivor plus a count, and a single dlu_exec_cmd_draw_indexed_indirect_count(3)
+* consumes them. Runs headless, i.e. on lavapipe. The cull pass is executed and its
+* output checked against the CPU, the draws are only recorded.
+*/
+
+#define OBJECT_CNT 100000
+#define FRAMES 10
+#define LOCAL_SIZE 64
+
+enum { OBJ_BD, DRAW_BD, COUNT_BD, FRUSTUM_BD, BD_CNT };
+
+/* std430 layout of the compute shader's Object */
+struct object {
+  float sphere[4]; /* xyz center, w radius */
+  uint32_t index_count;
+  uint32_t first_index;
+  int32_t vertex_offset;
+  uint32_t pad;
+};
+
+struct frustum {
+  float planes[6][4];
+  uint32_t object_count;
+};
+
+static const char cull_comp_src[] =
+  "#version 450\n"
+  "layout(local_size_x = 64) in;\n"
+  "struct Object { vec4 sphere; uint indexCount; uint firstIndex; int vertexOffset; uint pad; };\n"
+  "struct Draw { uint indexCount; uint instanceCount; uint firstIndex; int vertexOffset; uint firstInstance; };\n"
+  "layout(std430, binding = 0) readonly buffer Objects { Object objects[]; };\n"
+  "layout(std430, binding = 1) writeonly buffer Draws { Draw draws[]; };\n"
+  "layout(std430, binding = 2) buffer Count { uint draw_count; };\n"
+  "layout(std140, binding = 3) uniform Frustum { vec4 planes[6]; uint object_count; } frustum;\n"
+  "void main() {\n"
+  "  uint i = gl_GlobalInvocationID.x;\n"
+  "  if (i >= frustum.object_count) return;\n"
+  "  Object o = objects[i];\n"
+  "  for (int p = 0; p < 6; p++)\n"
+  "    if (dot(frustum.planes[p].xyz, o.sphere.xyz) + frustum.planes[p].w < -o.sphere.w) return;\n"
+  "  draws[atomicAdd(draw_count, 1)] = Draw(o.indexCount, 1, o.firstIndex, o.vertexOffset, i);\n"
+  "}";
+
+static bool visible(struct frustum *f, struct object *o) {
+  for (uint32_t p = 0; p < 6; p++)
+    if (f->planes[p][0] * o->sphere[0] + f->planes[p][1] * o->sphere[1] +
+        f->planes[p][2] * o->sphere[2] + f->planes[p][3] < -o->sphere[3])
+      return false;
+  return true;
+}
+
+static VkResult setup_device(vkcomp *app, bool *has_count) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkPhysicalDeviceProperties device_props;
+  VkPhysicalDeviceFeatures device_feats;
+
+  err = dlu_create_instance(app, "Indirect Bench", "No Engine", 0, NULL, 0, NULL);
+  if (err) return err;
+
+  VkPhysicalDeviceType types[] = {
+    VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU
+  };
+
+  for (uint32_t i = 0; i < ARR_LEN(types); i++)
+    if (!(err = dlu_create_physical_device(app, 0, types[i], &device_props, &device_feats))) break;
+  if (err) return err;
+
+  if (!dlu_create_queue_families(app, 0, VK_QUEUE_GRAPHICS_BIT)) return VK_RESULT_MAX_ENUM;
+
+  float queue_priorities[1] = {1.0};
+  VkDeviceQueueCreateInfo dqueue_create_info[1];
+  dqueue_create_info[0] = dlu_set_device_queue_info(0, app->pd_data[0].gfam_idx, 1, queue_priorities);
+
+  /* Core in Vulkan 1.2, older drivers may lack the extension */
+  const char *device_extensions[] = { VK_KHR_DRAW_INDIRECT_COUNT_EXTENSION_NAME };
+  err = dlu_create_logical_device(app, 0, 0, 0, ARR_LEN(dqueue_create_info), dqueue_create_info, NULL, ARR_LEN(device_extensions), device_extensions);
+  if (err) err = dlu_create_logical_device(app, 0, 0, 0, ARR_LEN(dqueue_create_info), dqueue_create_info, NULL, 0, NULL);
+  if (err) return err;
+
+  *has_count = !!app->ld_data[0].draw_indexed_indirect_count;
+  return dlu_create_device_queue(app, 0, 0, VK_QUEUE_GRAPHICS_BIT) ? VK_RESULT_MAX_ENUM : VK_SUCCESS;
+}
+
+static VkResult setup_pipelines(vkcomp *app) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+
+  VkDescriptorSetLayoutBinding bindings[BD_CNT];
+  for (uint32_t i = 0; i < FRUSTUM_BD; i++)
+    bindings[i] = dlu_set_desc_set_layout_binding(i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL);
+  bindings[FRUSTUM_BD] = dlu_set_desc_set_layout_binding(FRUSTUM_BD, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL);
+  VkDescriptorSetLayoutCreateInfo desc_set_info[1]; desc_set_info[0] = dlu_set_desc_set_layout_info(0, BD_CNT, bindings);
+
+  err = dlu_create_pipeline_layout(app, 0, 0, ARR_LEN(desc_set_info), desc_set_info, 0, NULL, 0);
+  if (err) return err;
+
+  /* The render pass the draws are recorded against, never begun since nothing is presented */
+  VkAttachmentDescription attachment = dlu_set_attachment_desc(VK_FORMAT_B8G8R8A8_UNORM, VK_SAMPLE_COUNT_1_BIT,
+    VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+    VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+  );
+  VkAttachmentReference color_ref = dlu_set_attachment_ref(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  VkSubpassDescription subpass = dlu_set_subpass_desc(0, VK_PIPELINE_BIND_POINT_GRAPHICS, 0, NULL, 1, &color_ref, NULL, NULL, 0, NULL);
+
+  err = dlu_create_render_pass(app, 0, 1, &attachment, 1, &subpass, 0, NULL, 0);
+  if (err) return err;
+
+  dlu_shader_info shi_comp = dlu_compile_to_spirv(VK_SHADER_STAGE_COMPUTE_BIT, cull_comp_src, "cull.spv", "main");
+  if (!shi_comp.bytes) return VK_RESULT_MAX_ENUM;
+
+  VkShaderModule comp_shader_module = dlu_create_shader_module(app, 0, shi_comp.bytes, shi_comp.byte_size);
+  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi_comp.result);
+  if (!comp_shader_module) return VK_RESULT_MAX_ENUM;
+
+  VkPipelineShaderStageCreateInfo comp_stage = dlu_set_shader_stage_info(comp_shader_module, "main", VK_SHADER_STAGE_COMPUTE_BIT, NULL, 0);
+  err = dlu_create_compute_pipeline(app, 0, 0, &comp_stage);
+  dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, comp_shader_module);
+  if (err) return err;
+
+  VkDescriptorPoolSize pool_sizes[2];
+  pool_sizes[0] = dlu_set_desc_pool_size(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, FRUSTUM_BD);
+  pool_sizes[1] = dlu_set_desc_pool_size(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1);
+  err = dlu_create_desc_pool(app, 0, 0, ARR_LEN(pool_sizes), pool_sizes, 0);
+  if (err) return err;
+
+  err = dlu_create_desc_set_layout(app, 0, 0, &desc_set_info[0]);
+  if (err) return err;
+
+  return dlu_create_desc_sets(app, 0);
+}
+
+static VkResult setup_buffers(vkcomp *app, struct frustum *frustum) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkMemoryPropertyFlags host = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+  VkDeviceSize sizes[BD_CNT] = {
+    [OBJ_BD] = OBJECT_CNT * sizeof(struct object), [DRAW_BD] = OBJECT_CNT * sizeof(VkDrawIndexedIndirectCommand),
+    [COUNT_BD] = sizeof(uint32_t), [FRUSTUM_BD] = sizeof(struct frustum)
+  };
+
+  VkBufferUsageFlags usages[BD_CNT] = {
+    [OBJ_BD] = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    [DRAW_BD] = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+    [COUNT_BD] = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+    [FRUSTUM_BD] = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT
+  };
+
+  VkDescriptorBufferInfo buff_infos[BD_CNT];
+  VkWriteDescriptorSet writes[BD_CNT];
+
+  for (uint32_t i = 0; i < BD_CNT; i++) {
+    err = dlu_create_vk_buffer(app, 0, i, sizes[i], 0, usages[i], VK_SHARING_MODE_EXCLUSIVE, 0, NULL, host);
+    if (err) return err;
+
+    buff_infos[i] = dlu_set_desc_buff_info(app->buff_data[i].buff, 0, sizes[i]);
+    writes[i] = dlu_set_write_desc_set(app->desc_data[0].desc_set[0], i, 0, 1,
+      (i == FRUSTUM_BD) ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NULL, &buff_infos[i], NULL);
+  }
+
+  dlu_update_desc_sets(app->ld_data[0].device, BD_CNT, writes, 0, NULL);
+
+  /* Objects scattered over a 200 unit cube around the camera, roughly a quarter land in the frustum */
+  struct object *objects = (struct object *) app->buff_data[OBJ_BD].mapped;
+  srand(1);
+  for (uint32_t i = 0; i < OBJECT_CNT; i++) {
+    for (uint32_t c = 0; c < 3; c++) objects[i].sphere[c] = (rand() / (float) RAND_MAX) * 200.0f - 100.0f;
+    objects[i].sphere[3] = 0.5f + (rand() % 4);
+    objects[i].index_count = 36; objects[i].first_index = 0;
+    objects[i].vertex_offset = 0; objects[i].pad = 0;
+  }
+
+  /* 90 degree frustum looking down -z, near 0.1 far 100 */
+  float planes[6][4] = {
+    { 0.7071f, 0.0f, -0.7071f, 0.0f }, { -0.7071f, 0.0f, -0.7071f, 0.0f },
+    { 0.0f, 0.7071f, -0.7071f, 0.0f }, { 0.0f, -0.7071f, -0.7071f, 0.0f },
+    { 0.0f, 0.0f, -1.0f, -0.1f },      { 0.0f, 0.0f, 1.0f, 100.0f }
+  };
+  memcpy(frustum->planes, planes, sizeof(planes));
+  frustum->object_count = OBJECT_CNT;
+
+  return dlu_vk_write_buff(app, FRUSTUM_BD, 0, frustum, sizeof(struct frustum));
+}
+
+/* Secondary command buffer of pool 1 continues the render pass, the draws get recorded there */
+static VkResult record_cpu_draws(vkcomp *app, uint64_t *ns) {
+  VkResult err = dlu_exec_begin_secondary_cmd_buffs(app, 1, 0, 0, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  if (err) return err;
+
+  struct object *objects = (struct object *) app->buff_data[OBJ_BD].mapped;
+  uint64_t start = dlu_hrnst();
+  for (uint32_t i = 0; i < OBJECT_CNT; i++)
+    dlu_exec_cmd_draw_indexed(app, 1, 0, objects[i].index_count, 1, objects[i].first_index, objects[i].vertex_offset, i);
+  *ns += dlu_hrnst() - start;
+
+  return dlu_exec_stop_cmd_buffs(app, 1, 0);
+}
+
+static VkResult record_gpu_draws(vkcomp *app, bool has_count, uint64_t *ns) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkCommandBuffer cmd_buff = app->cmd_data[0].cmd_buffs[0];
+
+  uint64_t start = dlu_hrnst();
+
+  /* Cull pass on the primary */
+  err = dlu_exec_begin_cmd_buffs(app, 0, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, NULL);
+  if (err) return err;
+
+  dlu_exec_fill_buffer(app, COUNT_BD, 0, sizeof(uint32_t), 0, cmd_buff);
+
+  VkMemoryBarrier barrier = { .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER, .pNext = NULL,
+    .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT, .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT };
+  dlu_exec_pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0, NULL, 0, NULL, cmd_buff);
+
+  dlu_bind_pipeline(app, 0, 0, 0, 0, VK_PIPELINE_BIND_POINT_COMPUTE);
+  dlu_bind_desc_sets(app, 0, 0, 0, 0, VK_PIPELINE_BIND_POINT_COMPUTE, 0, NULL);
+  dlu_exec_cmd_dispatch(app, 0, 0, (OBJECT_CNT + LOCAL_SIZE - 1) / LOCAL_SIZE, 1, 1);
+
+  /* Indirect reads wait on the cull pass, the host reads the result back after the submit */
+  barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+  barrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+  dlu_exec_pipeline_barrier(VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+                            0, 1, &barrier, 0, NULL, 0, NULL, cmd_buff);
+
+  err = dlu_exec_stop_cmd_buffs(app, 0, 0);
+  if (err) return err;
+
+  /* One draw call no matter the object count */
+  err = dlu_exec_begin_secondary_cmd_buffs(app, 1, 0, 0, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  if (err) return err;
+
+  if (has_count)
+    dlu_exec_cmd_draw_indexed_indirect_count(app, 1, 0, DRAW_BD, 0, COUNT_BD, 0, OBJECT_CNT, sizeof(VkDrawIndexedIndirectCommand));
+  else
+    dlu_exec_cmd_draw_indexed_indirect(app, 1, 0, DRAW_BD, 0, OBJECT_CNT, sizeof(VkDrawIndexedIndirectCommand));
+
+  err = dlu_exec_stop_cmd_buffs(app, 1, 0);
+  *ns += dlu_hrnst() - start;
+
+  return err;
+}
+
+static bool check_cull(vkcomp *app, struct frustum *frustum) {
+  struct object *objects = (struct object *) app->buff_data[OBJ_BD].mapped;
+  VkDrawIndexedIndirectCommand *draws = (VkDrawIndexedIndirectCommand *) app->buff_data[DRAW_BD].mapped;
+  uint32_t count = *(uint32_t *) app->buff_data[COUNT_BD].mapped;
+
+  uint32_t expected = 0;
+  for (uint32_t i = 0; i < OBJECT_CNT; i++)
+    expected += visible(frustum, &objects[i]);
+
+  /* Plane tests right on the boundary may round differently on the GPU */
+  if (count > expected + 16 || count + 16 < expected) {
+    dlu_log_me(DLU_DANGER, "[x] GPU kept %u objects, CPU kept %u", count, expected);
+    return false;
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    if (draws[i].firstInstance >= OBJECT_CNT || draws[i].instanceCount != 1 ||
+        draws[i].indexCount != objects[draws[i].firstInstance].index_count) {
+      dlu_log_me(DLU_DANGER, "[x] Bad draw command %u", i);
+      return false;
+    }
+  }
+
+  dlu_log_me(DLU_SUCCESS, "GPU culled %u objects down to %u draws (CPU: %u)", OBJECT_CNT, count, expected);
+  return true;
+}
+
+int main(void) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  int ret = EXIT_FAILURE;
+  bool has_count = false;
+  struct frustum frustum;
+  uint64_t cpu_ns = 0, gpu_ns = 0, cull_ns = 0;
+
+  dlu_otma_mems ma = {
+    .vkcomp_cnt = 1, .pd_cnt = 1, .ld_cnt = 1, .scd_cnt = 1, .si_cnt = 1, .cmdd_cnt = 2, .cb_cnt = 1,
+    .gpd_cnt = 1, .gp_cnt = 1, .bd_cnt = BD_CNT, .dd_cnt = 1, .desc_cnt = 1
+  };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return EXIT_FAILURE;
+
+  vkcomp *app = dlu_init_vk();
+  if (!app) goto exit_bench;
+
+  if (!dlu_otba(DLU_PD_DATA, app, INDEX_IGNORE, ma.pd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_LD_DATA, app, INDEX_IGNORE, ma.ld_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_SC_DATA, app, INDEX_IGNORE, ma.scd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_CMD_DATA, app, INDEX_IGNORE, ma.cmdd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_GP_DATA, app, INDEX_IGNORE, ma.gpd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_BUFF_DATA, app, INDEX_IGNORE, ma.bd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_DESC_DATA, app, INDEX_IGNORE, ma.dd_cnt)) goto exit_bench;
+
+  /* No swap chain, a single "image" without a framebuffer so the per image helpers record one buffer */
+  if (!dlu_otba(DLU_SC_DATA_MEMS, app, 0, 0)) goto exit_bench;
+  if (!dlu_otba(DLU_CMD_DATA_MEMS, app, 1, ma.cb_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_GP_DATA_MEMS, app, 0, ma.gp_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_DESC_DATA_MEMS, app, 0, ma.desc_cnt)) goto exit_bench;
+
+  err = setup_device(app, &has_count);
+  if (err) goto exit_bench;
+
+  app->sc_data[0].ldi = 0;
+  if (!has_count) dlu_log_me(DLU_WARNING, "VK_KHR_draw_indirect_count unsupported, recording a fixed size indirect draw");
+
+  for (uint32_t i = 0; i < 2; i++) {
+    err = dlu_create_cmd_pool(app, 0, i, app->pd_data[0].gfam_idx, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    if (err) goto exit_bench;
+    err = dlu_create_cmd_buffs(app, i, 0, (i) ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    if (err) goto exit_bench;
+  }
+
+  err = setup_pipelines(app);
+  if (err) goto exit_bench;
+
+  err = setup_buffers(app, &frustum);
+  if (err) goto exit_bench;
+
+  for (uint32_t f = 0; f < FRAMES; f++) {
+    err = record_cpu_draws(app, &cpu_ns);
+    if (err) goto exit_bench;
+
+    err = record_gpu_draws(app, has_count, &gpu_ns);
+    if (err) goto exit_bench;
+
+    uint64_t start = dlu_hrnst();
+    err = dlu_queue_graphics_queue(app, 0, 0, 1, app->cmd_data[0].cmd_buffs, 0, NULL, NULL, 0, NULL);
+    if (err) goto exit_bench;
+    err = dlu_vk_sync(DLU_VK_WAIT_GRAPHICS_QUEUE, app, 0, 0);
+    if (err) goto exit_bench;
+    cull_ns += dlu_hrnst() - start;
+
+    if (!check_cull(app, &frustum)) goto exit_bench;
+  }
+
+  dlu_log_me(DLU_SUCCESS, "%u objects, average over %u frames", OBJECT_CNT, FRAMES);
+  dlu_log_me(DLU_SUCCESS, "  CPU draw calls    record: %10.3f ms", cpu_ns / 1e6 / FRAMES);
+  dlu_log_me(DLU_SUCCESS, "  GPU driven draws  record: %10.3f ms, cull pass: %8.3f ms", gpu_ns / 1e6 / FRAMES, cull_ns / 1e6 / FRAMES);
+
+  ret = EXIT_SUCCESS;
+
+exit_bench:
+  if (app) dlu_freeup_vk(app);
+  dlu_release_blocks();
+  return ret;
+}
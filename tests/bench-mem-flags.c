@@ -0,0 +1,87 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <sys/resource.h>
+
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+/**
+* Compares page faults and first frame latency of an arena mapped with
+* the different dlu_mem_flags. The "first frame" touches every byte of the
+* arena the way a renderer would when filling its structs for the first time.
+*/
+
+#define ARENA_BYTES (64UL << 20)
+
+struct flag_case {
+  const char *name;
+  uint32_t mflags;
+};
+
+static long minflt(void) {
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_minflt;
+}
+
+static bool run_bench(struct flag_case *fc) {
+  dlu_otma_mems ma = { .cha_cnt = ARENA_BYTES, .mflags = fc->mflags };
+
+  long faults = minflt();
+  uint64_t start = dlu_hrnst();
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return false;
+  uint64_t setup = dlu_hrnst() - start;
+  long setup_faults = minflt() - faults;
+
+  char *bytes = dlu_alloc(DLU_SMALL_BLOCK_PRIV, ARENA_BYTES);
+  if (!bytes) { dlu_release_blocks(); return false; }
+
+  faults = minflt();
+  start = dlu_hrnst();
+  memset(bytes, 0x7F, ARENA_BYTES);
+  uint64_t frame = dlu_hrnst() - start;
+  faults = minflt() - faults;
+
+  dlu_log_me(DLU_SUCCESS, "%-20s setup: %8.3f ms %6ld faults, first frame: %8.3f ms %6ld faults",
+             fc->name, setup / 1e6, setup_faults, frame / 1e6, faults);
+
+  dlu_release_blocks();
+  return true;
+}
+
+int main(void) {
+  struct flag_case cases[] = {
+    { "default", DLU_MEM_DEFAULT },
+    { "prefault", DLU_MEM_PREFAULT },
+    { "huge pages", DLU_MEM_HUGE_PAGES },
+    { "huge pages+prefault", DLU_MEM_HUGE_PAGES | DLU_MEM_PREFAULT },
+    { "prefault+lock", DLU_MEM_PREFAULT | DLU_MEM_LOCK }
+  };
+
+  for (uint32_t i = 0; i < ARR_LEN(cases); i++)
+    if (!run_bench(&cases[i])) return EXIT_FAILURE;
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,178 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#define LUCUR_SPIRV_API
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+#include <sys/stat.h>
+
+/**
+* Simulates launching an application twice. Each launch creates its own instance and
+* device, loads the pipeline cache with dlu_load_pipeline_cache(3), creates a set of
+* compute pipeline variants, then saves the cache and tears everything down. The first
+* launch compiles every pipeline, the second should mostly hit the cache. A third launch
+* after truncating the file checks a damaged cache gets rejected. Mesa's own on-disk
+* shader cache is disabled so only the pipeline cache is measured.
+*/
+
+#define VARIANT_CNT 24
+#define CACHE_PATH "lucur-bench-pipeline.cache"
+
+static VkResult setup_device(vkcomp *app) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkPhysicalDeviceProperties device_props;
+  VkPhysicalDeviceFeatures device_feats;
+
+  err = dlu_create_instance(app, "Pipeline Cache Bench", "No Engine", 0, NULL, 0, NULL);
+  if (err) return err;
+
+  VkPhysicalDeviceType types[] = {
+    VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU
+  };
+
+  for (uint32_t i = 0; i < ARR_LEN(types); i++)
+    if (!(err = dlu_create_physical_device(app, 0, types[i], &device_props, &device_feats))) break;
+  if (err) return err;
+
+  if (!dlu_create_queue_families(app, 0, VK_QUEUE_GRAPHICS_BIT)) return VK_RESULT_MAX_ENUM;
+
+  float queue_priorities[1] = {1.0};
+  VkDeviceQueueCreateInfo dqueue_create_info[1];
+  dqueue_create_info[0] = dlu_set_device_queue_info(0, app->pd_data[0].gfam_idx, 1, queue_priorities);
+
+  return dlu_create_logical_device(app, 0, 0, 0, ARR_LEN(dqueue_create_info), dqueue_create_info, NULL, 0, NULL);
+}
+
+static VkResult launch(dlu_shader_info *shaders, bool *loaded, uint64_t *ns) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .pd_cnt = 1, .ld_cnt = 1, .gpd_cnt = 1, .gp_cnt = VARIANT_CNT };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return err;
+
+  vkcomp *app = dlu_init_vk();
+  if (!app) goto exit_launch;
+
+  if (!dlu_otba(DLU_PD_DATA, app, INDEX_IGNORE, ma.pd_cnt)) goto exit_launch;
+  if (!dlu_otba(DLU_LD_DATA, app, INDEX_IGNORE, ma.ld_cnt)) goto exit_launch;
+  if (!dlu_otba(DLU_GP_DATA, app, INDEX_IGNORE, ma.gpd_cnt)) goto exit_launch;
+  if (!dlu_otba(DLU_GP_DATA_MEMS, app, 0, ma.gp_cnt)) goto exit_launch;
+
+  err = setup_device(app);
+  if (err) goto exit_launch;
+
+  VkDescriptorSetLayoutBinding binding = dlu_set_desc_set_layout_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, NULL);
+  VkDescriptorSetLayoutCreateInfo desc_set_info[1]; desc_set_info[0] = dlu_set_desc_set_layout_info(0, 1, &binding);
+
+  err = dlu_create_pipeline_layout(app, 0, 0, ARR_LEN(desc_set_info), desc_set_info, 0, NULL, 0);
+  if (err) goto exit_launch;
+
+  uint64_t start = dlu_hrnst();
+
+  err = dlu_load_pipeline_cache(app, 0, CACHE_PATH, loaded);
+  if (err) goto exit_launch;
+
+  for (uint32_t i = 0; i < VARIANT_CNT; i++) {
+    VkShaderModule shader_module = dlu_create_shader_module(app, 0, shaders[i].bytes, shaders[i].byte_size);
+    if (!shader_module) { err = VK_RESULT_MAX_ENUM; goto exit_launch; }
+
+    VkPipelineShaderStageCreateInfo stage = dlu_set_shader_stage_info(shader_module, "main", VK_SHADER_STAGE_COMPUTE_BIT, NULL, 0);
+    err = dlu_create_compute_pipeline(app, 0, i, &stage);
+    dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, shader_module);
+    if (err) goto exit_launch;
+  }
+
+  err = dlu_save_pipeline_cache(app, CACHE_PATH);
+  *ns = dlu_hrnst() - start;
+
+exit_launch:
+  if (app) dlu_freeup_vk(app);
+  dlu_release_blocks();
+  return err;
+}
+
+int main(void) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  int ret = EXIT_FAILURE;
+  dlu_shader_info shaders[VARIANT_CNT];
+  char src[1024];
+  uint32_t compiled = 0;
+  uint64_t cold_ns = 0, warm_ns = 0, damaged_ns = 0;
+  bool cold_loaded = true, warm_loaded = false, damaged_loaded = true;
+
+  setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+  unlink(CACHE_PATH);
+
+  /* Variants only differ in constants, enough for the driver to compile each one */
+  for (; compiled < VARIANT_CNT; compiled++) {
+    snprintf(src, sizeof(src),
+      "#version 450\n"
+      "layout(local_size_x = 64) in;\n"
+      "layout(std430, binding = 0) buffer Data { float v[]; };\n"
+      "void main() {\n"
+      "  uint i = gl_GlobalInvocationID.x;\n"
+      "  float x = v[i];\n"
+      "  for (int k = 0; k < %u; k++) x = sin(x * %u.0) + cos(x + %u.0) * exp2(-abs(x));\n"
+      "  v[i] = x;\n"
+      "}", 4 + compiled % 5, compiled + 1, compiled * 3 + 2);
+
+    shaders[compiled] = dlu_compile_to_spirv(VK_SHADER_STAGE_COMPUTE_BIT, src, "variant.spv", "main");
+    if (!shaders[compiled].bytes) { compiled++; goto exit_bench; }
+  }
+
+  err = launch(shaders, &cold_loaded, &cold_ns);
+  if (err) goto exit_bench;
+
+  err = launch(shaders, &warm_loaded, &warm_ns);
+  if (err) goto exit_bench;
+
+  struct stat st;
+  if (stat(CACHE_PATH, &st) == NEG_ONE || truncate(CACHE_PATH, st.st_size - 1) == NEG_ONE) {
+    dlu_log_me(DLU_DANGER, "[x] truncate: %s", strerror(errno));
+    goto exit_bench;
+  }
+
+  err = launch(shaders, &damaged_loaded, &damaged_ns);
+  if (err) goto exit_bench;
+
+  if (cold_loaded || !warm_loaded || damaged_loaded) {
+    dlu_log_me(DLU_DANGER, "[x] Cache use was cold: %d, warm: %d, damaged: %d", cold_loaded, warm_loaded, damaged_loaded);
+    goto exit_bench;
+  }
+
+  dlu_log_me(DLU_SUCCESS, "%u compute pipeline variants, cache file %ld bytes", VARIANT_CNT, (long) st.st_size);
+  dlu_log_me(DLU_SUCCESS, "  first launch   (no cache): %10.3f ms", cold_ns / 1e6);
+  dlu_log_me(DLU_SUCCESS, "  second launch  (cached):   %10.3f ms", warm_ns / 1e6);
+  dlu_log_me(DLU_SUCCESS, "  damaged cache  (rejected): %10.3f ms", damaged_ns / 1e6);
+
+  ret = EXIT_SUCCESS;
+
+exit_bench:
+  for (uint32_t i = 0; i < compiled; i++)
+    dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shaders[i].result);
+  unlink(CACHE_PATH);
+  return ret;
+}
@@ -0,0 +1,214 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#define LUCUR_SPIRV_API
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+/**
+* Creates a few dozen graphics pipeline variants with dlu_create_graphics_pipeline_batch(3)
+* on 1, 2, 4, ... threads up to the CPU count. No pipeline cache is created and Mesa's own
+* on-disk shader cache is disabled, every run compiles every variant. Runs headless.
+*/
+
+#define FRAG_CNT 12
+#define STATE_CNT 4
+#define VARIANT_CNT (FRAG_CNT * STATE_CNT)
+
+static const char vert_src[] =
+  "#version 450\n"
+  "layout(location = 0) out vec2 uv;\n"
+  "void main() {\n"
+  "  uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);\n"
+  "  gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}";
+
+static VkResult setup_device(vkcomp *app) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkPhysicalDeviceProperties device_props;
+  VkPhysicalDeviceFeatures device_feats;
+
+  err = dlu_create_instance(app, "Pipelines Bench", "No Engine", 0, NULL, 0, NULL);
+  if (err) return err;
+
+  VkPhysicalDeviceType types[] = {
+    VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU
+  };
+
+  for (uint32_t i = 0; i < ARR_LEN(types); i++)
+    if (!(err = dlu_create_physical_device(app, 0, types[i], &device_props, &device_feats))) break;
+  if (err) return err;
+
+  if (!dlu_create_queue_families(app, 0, VK_QUEUE_GRAPHICS_BIT)) return VK_RESULT_MAX_ENUM;
+
+  float queue_priorities[1] = {1.0};
+  VkDeviceQueueCreateInfo dqueue_create_info[1];
+  dqueue_create_info[0] = dlu_set_device_queue_info(0, app->pd_data[0].gfam_idx, 1, queue_priorities);
+
+  return dlu_create_logical_device(app, 0, 0, 0, ARR_LEN(dqueue_create_info), dqueue_create_info, NULL, 0, NULL);
+}
+
+static VkShaderModule create_shader(vkcomp *app, VkShaderStageFlagBits stage, const char *src) {
+  dlu_shader_info shi = dlu_compile_to_spirv(stage, src, "variant.spv", "main");
+  VkShaderModule shader_module = (shi.bytes) ? dlu_create_shader_module(app, 0, shi.bytes, shi.byte_size) : VK_NULL_HANDLE;
+  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi.result);
+  return shader_module;
+}
+
+static VkResult setup_render_pass(vkcomp *app) {
+  VkResult err = dlu_create_pipeline_layout(app, 0, 0, 0, NULL, 0, NULL, 0);
+  if (err) return err;
+
+  VkAttachmentDescription attachment = dlu_set_attachment_desc(VK_FORMAT_B8G8R8A8_UNORM, VK_SAMPLE_COUNT_1_BIT,
+    VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+    VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+  );
+  VkAttachmentReference color_ref = dlu_set_attachment_ref(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  VkSubpassDescription subpass = dlu_set_subpass_desc(0, VK_PIPELINE_BIND_POINT_GRAPHICS, 0, NULL, 1, &color_ref, NULL, NULL, 0, NULL);
+
+  return dlu_create_render_pass(app, 0, 1, &attachment, 1, &subpass, 0, NULL, 0);
+}
+
+int main(void) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  int ret = EXIT_FAILURE;
+  VkShaderModule vert_module = VK_NULL_HANDLE, frag_modules[FRAG_CNT] = {};
+  char src[1024];
+
+  setenv("MESA_SHADER_CACHE_DISABLE", "true", 1);
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .pd_cnt = 1, .ld_cnt = 1, .gpd_cnt = 1, .gp_cnt = VARIANT_CNT };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return EXIT_FAILURE;
+
+  vkcomp *app = dlu_init_vk();
+  if (!app) goto exit_bench;
+
+  if (!dlu_otba(DLU_PD_DATA, app, INDEX_IGNORE, ma.pd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_LD_DATA, app, INDEX_IGNORE, ma.ld_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_GP_DATA, app, INDEX_IGNORE, ma.gpd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_GP_DATA_MEMS, app, 0, ma.gp_cnt)) goto exit_bench;
+
+  err = setup_device(app);
+  if (err) goto exit_bench;
+
+  err = setup_render_pass(app);
+  if (err) goto exit_bench;
+
+  vert_module = create_shader(app, VK_SHADER_STAGE_VERTEX_BIT, vert_src);
+  if (!vert_module) goto exit_bench;
+
+  /* Variants only differ in constants, enough for the driver to compile each one */
+  for (uint32_t i = 0; i < FRAG_CNT; i++) {
+    snprintf(src, sizeof(src),
+      "#version 450\n"
+      "layout(location = 0) in vec2 uv;\n"
+      "layout(location = 0) out vec4 color;\n"
+      "void main() {\n"
+      "  vec3 c = vec3(uv, 0.%u);\n"
+      "  for (int k = 0; k < %u; k++) c = sin(c * %u.0 + c.yzx) * 0.5 + 0.5;\n"
+      "  color = vec4(c, 1.0);\n"
+      "}", i, 4 + i % 4, i + 2);
+
+    frag_modules[i] = create_shader(app, VK_SHADER_STAGE_FRAGMENT_BIT, src);
+    if (!frag_modules[i]) goto exit_bench;
+  }
+
+  VkPipelineShaderStageCreateInfo stages[FRAG_CNT][2];
+  for (uint32_t i = 0; i < FRAG_CNT; i++) {
+    stages[i][0] = dlu_set_shader_stage_info(vert_module, "main", VK_SHADER_STAGE_VERTEX_BIT, NULL, 0);
+    stages[i][1] = dlu_set_shader_stage_info(frag_modules[i], "main", VK_SHADER_STAGE_FRAGMENT_BIT, NULL, 0);
+  }
+
+  VkPipelineVertexInputStateCreateInfo vertex_input_info = dlu_set_vertex_input_state_info(0, NULL, 0, NULL);
+  VkPipelineInputAssemblyStateCreateInfo input_assembly = dlu_set_input_assembly_state_info(0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+  VkViewport viewport = dlu_set_view_port(0.0f, 0.0f, 256.0f, 256.0f, 0.0f, 1.0f);
+  VkRect2D scissor = dlu_set_rect2D(0, 0, 256, 256);
+  VkPipelineViewportStateCreateInfo view_port_info = dlu_set_view_port_state_info(1, &viewport, 1, &scissor);
+
+  VkPipelineMultisampleStateCreateInfo multisampling = dlu_set_multisample_state_info(
+    VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE
+  );
+
+  /* State variants: cull mode crossed with blending on or off */
+  VkPipelineRasterizationStateCreateInfo rasterizers[2];
+  for (uint32_t r = 0; r < 2; r++)
+    rasterizers[r] = dlu_set_rasterization_state_info(VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL,
+      (r) ? VK_CULL_MODE_BACK_BIT : VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f, 1.0f);
+
+  float blend_const[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  VkPipelineColorBlendAttachmentState blend_attachments[2];
+  VkPipelineColorBlendStateCreateInfo color_blendings[2];
+  for (uint32_t b = 0; b < 2; b++) {
+    blend_attachments[b] = dlu_set_color_blend_attachment_state(
+      (b) ? VK_TRUE : VK_FALSE, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD,
+      VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+      VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+    );
+    color_blendings[b] = dlu_set_color_blend_attachment_state_info(VK_FALSE, VK_LOGIC_OP_COPY, 1, &blend_attachments[b], blend_const);
+  }
+
+  VkGraphicsPipelineCreateInfo infos[VARIANT_CNT];
+  for (uint32_t i = 0; i < VARIANT_CNT; i++) {
+    uint32_t f = i / STATE_CNT, s = i % STATE_CNT;
+    infos[i] = dlu_set_graphics_pipeline_info(ARR_LEN(stages[f]), stages[f], &vertex_input_info, &input_assembly, NULL,
+      &view_port_info, &rasterizers[s & 1], &multisampling, NULL, &color_blendings[s >> 1], NULL, VK_NULL_HANDLE, VK_NULL_HANDLE, 0);
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t max_threads = (cpus > 0) ? (uint32_t) cpus : 1;
+  uint64_t single_ns = 0;
+
+  dlu_log_me(DLU_SUCCESS, "%u graphics pipeline variants, %u CPUs", VARIANT_CNT, max_threads);
+  for (uint32_t threads = 1; ; threads = (threads * 2 > max_threads) ? max_threads : threads * 2) {
+    uint64_t start = dlu_hrnst();
+    err = dlu_create_graphics_pipeline_batch(app, 0, 0, VARIANT_CNT, infos, threads);
+    uint64_t ns = dlu_hrnst() - start;
+    if (err) goto exit_bench;
+
+    if (threads == 1) single_ns = ns;
+    dlu_log_me(DLU_SUCCESS, "  %3u thread(s): %10.3f ms, %5.2fx", threads, ns / 1e6, (double) single_ns / ns);
+
+    for (uint32_t i = 0; i < VARIANT_CNT; i++) {
+      dlu_vk_destroy(DLU_DESTROY_PIPELINE, app, 0, app->gp_data[0].graphics_pipelines[i]);
+      app->gp_data[0].graphics_pipelines[i] = VK_NULL_HANDLE;
+    }
+
+    if (threads == max_threads) break;
+  }
+
+  ret = EXIT_SUCCESS;
+
+exit_bench:
+  if (app) {
+    for (uint32_t i = 0; i < FRAG_CNT; i++)
+      dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, frag_modules[i]);
+    dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, vert_module);
+    dlu_freeup_vk(app);
+  }
+  dlu_release_blocks();
+  return ret;
+}
@@ -0,0 +1,307 @@
+/**
+* The MIT License (MIT)
+*
+* Copyright (c) 2019-2020 Vincent Davis Jr.
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+
+#define LUCUR_VKCOMP_API
+#define LUCUR_SPIRV_API
+#define LUCUR_CLOCK_API
+#include <lucom.h>
+
+#include <pthread.h>
+
+/**
+* Records the secondary command buffers of a render pass from 1, 2, 4, ... threads up to the
+* CPU count, each thread into its own pool, then executes them from one primary command buffer
+* with dlu_exec_secondary_cmd_buffs(3). The draw count stays fixed and is split across the
+* threads, so the time per frame shows how recording scales with cores. Runs headless, the
+* render pass targets an offscreen image and the primary is recorded but never submitted.
+*/
+
+#define MAX_THREADS 16
+#define DRAWS 100000
+#define ITERATIONS 20
+#define WIDTH 256
+#define HEIGHT 256
+
+static const char vert_src[] =
+  "#version 450\n"
+  "void main() {\n"
+  "  vec2 uv = vec2((gl_VertexIndex << 1) & 2, gl_VertexIndex & 2);\n"
+  "  gl_Position = vec4(uv * 2.0 - 1.0, 0.0, 1.0);\n"
+  "}";
+
+static const char frag_src[] =
+  "#version 450\n"
+  "layout(location = 0) out vec4 color;\n"
+  "void main() { color = vec4(1.0); }";
+
+struct recorder {
+  vkcomp *app;
+  uint32_t cur_pool;
+  uint32_t draws;
+  VkResult err;
+};
+
+/* Each thread only touches its own pool, the pipeline and render pass are read only */
+static void *record(void *arg) {
+  struct recorder *r = (struct recorder *) arg;
+
+  r->err = dlu_exec_begin_secondary_cmd_buffs(r->app, r->cur_pool, 0, 0, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+  if (r->err) return NULL;
+
+  dlu_bind_pipeline(r->app, r->cur_pool, 0, 0, 0, VK_PIPELINE_BIND_POINT_GRAPHICS);
+  for (uint32_t i = 0; i < r->draws; i++)
+    dlu_exec_cmd_draw(r->app, r->cur_pool, 0, 3, 1, 0, i);
+
+  r->err = dlu_exec_stop_cmd_buffs(r->app, r->cur_pool, 0);
+  return NULL;
+}
+
+static VkResult setup_device(vkcomp *app) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  VkPhysicalDeviceProperties device_props;
+  VkPhysicalDeviceFeatures device_feats;
+
+  err = dlu_create_instance(app, "Secondary Bench", "No Engine", 0, NULL, 0, NULL);
+  if (err) return err;
+
+  VkPhysicalDeviceType types[] = {
+    VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU
+  };
+
+  for (uint32_t i = 0; i < ARR_LEN(types); i++)
+    if (!(err = dlu_create_physical_device(app, 0, types[i], &device_props, &device_feats))) break;
+  if (err) return err;
+
+  if (!dlu_create_queue_families(app, 0, VK_QUEUE_GRAPHICS_BIT)) return VK_RESULT_MAX_ENUM;
+
+  float queue_priorities[1] = {1.0};
+  VkDeviceQueueCreateInfo dqueue_create_info[1];
+  dqueue_create_info[0] = dlu_set_device_queue_info(0, app->pd_data[0].gfam_idx, 1, queue_priorities);
+
+  return dlu_create_logical_device(app, 0, 0, 0, ARR_LEN(dqueue_create_info), dqueue_create_info, NULL, 0, NULL);
+}
+
+static VkShaderModule create_shader(vkcomp *app, VkShaderStageFlagBits stage, const char *src) {
+  dlu_shader_info shi = dlu_compile_to_spirv(stage, src, "secondary.spv", "main");
+  VkShaderModule shader_module = (shi.bytes) ? dlu_create_shader_module(app, 0, shi.bytes, shi.byte_size) : VK_NULL_HANDLE;
+  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi.result);
+  return shader_module;
+}
+
+/* Offscreen color image standing in for the one swap chain image */
+static VkResult setup_target(vkcomp *app) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+
+  VkAttachmentDescription attachment = dlu_set_attachment_desc(VK_FORMAT_R8G8B8A8_UNORM, VK_SAMPLE_COUNT_1_BIT,
+    VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+    VK_ATTACHMENT_STORE_OP_DONT_CARE, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+  );
+  VkAttachmentReference color_ref = dlu_set_attachment_ref(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  VkSubpassDescription subpass = dlu_set_subpass_desc(0, VK_PIPELINE_BIND_POINT_GRAPHICS, 0, NULL, 1, &color_ref, NULL, NULL, 0, NULL);
+
+  err = dlu_create_render_pass(app, 0, 1, &attachment, 1, &subpass, 0, NULL, 0);
+  if (err) return err;
+
+  VkImageCreateInfo img_info = dlu_set_image_info(0, VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, dlu_set_extent3D(WIDTH, HEIGHT, 1), 1, 1,
+    VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+    VK_SHARING_MODE_EXCLUSIVE, 0, NULL, VK_IMAGE_LAYOUT_UNDEFINED
+  );
+
+  VkComponentMapping comp_map = dlu_set_component_mapping(VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                                          VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY);
+  VkImageSubresourceRange range = dlu_set_image_sub_resource_range(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+  VkImageViewCreateInfo ivi = dlu_set_image_view_info(0, VK_NULL_HANDLE, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, comp_map, range);
+
+  err = dlu_create_texture_image(app, 0, 0, &img_info, &ivi, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  if (err) return err;
+
+  /* The view is owned by text_data[0], the framebuffer only borrows it */
+  app->sc_data[0].ldi = 0;
+  app->sc_data[0].sic = 1;
+  app->sc_data[0].sc_buffs[0].view = app->text_data[0].view;
+
+  VkImageView attachments[1];
+  return dlu_create_framebuffers(app, 0, 0, ARR_LEN(attachments), attachments, WIDTH, HEIGHT, 1);
+}
+
+static VkResult setup_pipeline(vkcomp *app, VkShaderModule vert_module, VkShaderModule frag_module) {
+  VkResult err = dlu_create_pipeline_layout(app, 0, 0, 0, NULL, 0, NULL, 0);
+  if (err) return err;
+
+  VkPipelineShaderStageCreateInfo stages[2];
+  stages[0] = dlu_set_shader_stage_info(vert_module, "main", VK_SHADER_STAGE_VERTEX_BIT, NULL, 0);
+  stages[1] = dlu_set_shader_stage_info(frag_module, "main", VK_SHADER_STAGE_FRAGMENT_BIT, NULL, 0);
+
+  VkPipelineVertexInputStateCreateInfo vertex_input_info = dlu_set_vertex_input_state_info(0, NULL, 0, NULL);
+  VkPipelineInputAssemblyStateCreateInfo input_assembly = dlu_set_input_assembly_state_info(0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+  VkViewport viewport = dlu_set_view_port(0.0f, 0.0f, (float) WIDTH, (float) HEIGHT, 0.0f, 1.0f);
+  VkRect2D scissor = dlu_set_rect2D(0, 0, WIDTH, HEIGHT);
+  VkPipelineViewportStateCreateInfo view_port_info = dlu_set_view_port_state_info(1, &viewport, 1, &scissor);
+
+  VkPipelineRasterizationStateCreateInfo rasterizer = dlu_set_rasterization_state_info(VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL,
+    VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f, 1.0f);
+  VkPipelineMultisampleStateCreateInfo multisampling = dlu_set_multisample_state_info(VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+  VkPipelineColorBlendAttachmentState blend_attachment = dlu_set_color_blend_attachment_state(
+    VK_FALSE, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD,
+    VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+  );
+  float blend_const[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  VkPipelineColorBlendStateCreateInfo color_blending = dlu_set_color_blend_attachment_state_info(VK_FALSE, VK_LOGIC_OP_COPY, 1, &blend_attachment, blend_const);
+
+  return dlu_create_graphics_pipelines(app, 0, ARR_LEN(stages), stages, &vertex_input_info, &input_assembly, NULL,
+    &view_port_info, &rasterizer, &multisampling, NULL, &color_blending, NULL, 0, VK_NULL_HANDLE, -1);
+}
+
+/* Pool 0 holds the primary, pools 1 through threads each hold one thread's secondary */
+static VkResult record_frame(vkcomp *app, uint32_t threads, struct recorder *recs, pthread_t *tids, const uint32_t *pools) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  uint32_t spawned = 0;
+
+  for (uint32_t t = 0; t < threads; t++) {
+    recs[t].app = app;
+    recs[t].cur_pool = pools[t];
+    recs[t].draws = DRAWS / threads + ((t < DRAWS % threads) ? 1 : 0);
+    recs[t].err = VK_RESULT_MAX_ENUM;
+  }
+
+  /* The calling thread records the first pool itself */
+  for (uint32_t t = 1; t < threads; t++, spawned++)
+    if (pthread_create(&tids[t], NULL, record, &recs[t])) break;
+  record(&recs[0]);
+  for (uint32_t t = 1; t <= spawned; t++)
+    pthread_join(tids[t], NULL);
+
+  if (spawned != threads - 1) return err;
+  for (uint32_t t = 0; t < threads; t++)
+    if (recs[t].err) return recs[t].err;
+
+  err = dlu_exec_begin_cmd_buffs(app, 0, 0, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT, NULL);
+  if (err) return err;
+
+  VkClearValue clear_value = { .color = { .float32 = {0.0f, 0.0f, 0.0f, 1.0f} } };
+  dlu_exec_begin_render_pass(app, 0, 0, 0, 0, 0, WIDTH, HEIGHT, 1, &clear_value, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+  dlu_exec_secondary_cmd_buffs(app, 0, 0, threads, pools);
+  dlu_exec_stop_render_pass(app, 0, 0);
+
+  return dlu_exec_stop_cmd_buffs(app, 0, 0);
+}
+
+int main(void) {
+  VkResult err = VK_RESULT_MAX_ENUM;
+  int ret = EXIT_FAILURE;
+  VkShaderModule vert_module = VK_NULL_HANDLE, frag_module = VK_NULL_HANDLE;
+  struct recorder recs[MAX_THREADS];
+  pthread_t tids[MAX_THREADS];
+  uint32_t pools[MAX_THREADS];
+
+  dlu_otma_mems ma = {
+    .vkcomp_cnt = 1, .pd_cnt = 1, .ld_cnt = 1, .scd_cnt = 1, .gpd_cnt = 1, .gp_cnt = 1, .td_cnt = 1,
+    .cmdd_cnt = MAX_THREADS + 1, .cb_cnt = MAX_THREADS + 1
+  };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) return EXIT_FAILURE;
+
+  vkcomp *app = dlu_init_vk();
+  if (!app) goto exit_bench;
+
+  if (!dlu_otba(DLU_PD_DATA, app, INDEX_IGNORE, ma.pd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_LD_DATA, app, INDEX_IGNORE, ma.ld_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_SC_DATA, app, INDEX_IGNORE, ma.scd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_GP_DATA, app, INDEX_IGNORE, ma.gpd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_CMD_DATA, app, INDEX_IGNORE, ma.cmdd_cnt)) goto exit_bench;
+  if (!dlu_otba(DLU_TEXT_DATA, app, INDEX_IGNORE, ma.td_cnt)) goto exit_bench;
+
+  /* Holds a single framebuffer, no swap chain is created */
+  if (!dlu_otba(DLU_SC_DATA_MEMS, app, 0, 0)) goto exit_bench;
+  if (!dlu_otba(DLU_GP_DATA_MEMS, app, 0, ma.gp_cnt)) goto exit_bench;
+  for (uint32_t i = 0; i < ma.cmdd_cnt; i++)
+    if (!dlu_otba(DLU_CMD_DATA_MEMS, app, i, 1)) goto exit_bench;
+
+  err = setup_device(app);
+  if (err) goto exit_bench;
+
+  err = setup_target(app);
+  if (err) goto exit_bench;
+
+  vert_module = create_shader(app, VK_SHADER_STAGE_VERTEX_BIT, vert_src);
+  frag_module = create_shader(app, VK_SHADER_STAGE_FRAGMENT_BIT, frag_src);
+  if (!vert_module || !frag_module) goto exit_bench;
+
+  err = setup_pipeline(app, vert_module, frag_module);
+  if (err) goto exit_bench;
+
+  /* Buffers are re-begun every frame, vkBeginCommandBuffer resets them implicitly */
+  for (uint32_t i = 0; i < ma.cmdd_cnt; i++) {
+    err = dlu_create_cmd_pool(app, 0, i, app->pd_data[0].gfam_idx, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
+    if (err) goto exit_bench;
+
+    err = dlu_create_cmd_buffs(app, i, 0, (i) ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY);
+    if (err) goto exit_bench;
+
+    if (i) pools[i-1] = i;
+  }
+
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t max_threads = (cpus > 0) ? (uint32_t) cpus : 1;
+  if (max_threads > MAX_THREADS) max_threads = MAX_THREADS;
+  uint64_t single_ns = 0;
+
+  dlu_log_me(DLU_SUCCESS, "%u draws per frame, %u frames, %u CPUs used", DRAWS, ITERATIONS, max_threads);
+  for (uint32_t threads = 1; ; threads = (threads * 2 > max_threads) ? max_threads : threads * 2) {
+    /* Warm up, lets the pools grow to their steady state size */
+    err = record_frame(app, threads, recs, tids, pools);
+    if (err) goto exit_bench;
+
+    uint64_t start = dlu_hrnst();
+    for (uint32_t f = 0; f < ITERATIONS; f++) {
+      err = record_frame(app, threads, recs, tids, pools);
+      if (err) goto exit_bench;
+    }
+    uint64_t ns = (dlu_hrnst() - start) / ITERATIONS;
+
+    if (threads == 1) single_ns = ns;
+    dlu_log_me(DLU_SUCCESS, "  %3u thread(s): %10.3f ms per frame, %5.2fx", threads, ns / 1e6, (double) single_ns / ns);
+
+    if (threads == max_threads) break;
+  }
+
+  ret = EXIT_SUCCESS;
+
+exit_bench:
+  if (app) {
+    if (app->sc_data && app->sc_data[0].sc_buffs) {
+      dlu_vk_destroy(DLU_DESTROY_VK_FRAME_BUFFER, app, 0, app->sc_data[0].sc_buffs[0].fb);
+      app->sc_data[0].sc_buffs[0].fb = VK_NULL_HANDLE;
+      app->sc_data[0].sc_buffs[0].view = VK_NULL_HANDLE;
+    }
+    dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, frag_module);
+    dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, vert_module);
+    dlu_freeup_vk(app);
+  }
+  dlu_release_blocks();
+  return ret;
+}
@@ -22,12 +22,16 @@
 * THE SOFTWARE.
 */
 
+#define LUCUR_DISPLAY_API
+#define LUCUR_VKCOMP_API
+#include <sys/socket.h>
+#include <sys/wait.h>
 #include <lucom.h>
 #include <check.h>
 
 START_TEST(basic_priv_alloc) {
   dlu_otma_mems ma = {
-    .inta_cnt = 1, .cha_cnt = 2,
+    .inta_cnt = 1, .cha_cnt = 2 * sizeof(char *),
     .fla_cnt = 1, .dba_cnt = 1,
   };
   if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
@@ -55,7 +59,7 @@ START_TEST(basic_priv_alloc) {
 
 START_TEST(basic_shared_alloc) {
   dlu_otma_mems ma = {
-    .inta_cnt = 1, .cha_cnt = 2,
+    .inta_cnt = 1, .cha_cnt = 2 * sizeof(char *),
     .fla_cnt = 1, .dba_cnt = 1,
   };
   if (!dlu_otma(DLU_LARGE_BLOCK_SHARED, ma)) ck_abort_msg(NULL);
@@ -81,6 +85,287 @@ START_TEST(basic_shared_alloc) {
   bytes=NULL; q=NULL;
 } END_TEST;
 
+START_TEST(thread_arena_alloc) {
+  dlu_otma_mems ma = {
+    .inta_cnt = 1,
+    .ta_cnt = 1, .ta_bytes = 4 * sizeof(int)
+  };
+
+  /* No large block yet, arena can't be carved */
+  if (dlu_otta(DLU_SMALL_BLOCK_PRIV, ma.ta_bytes)) ck_abort_msg(NULL);
+
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+  if (!dlu_otta(DLU_SMALL_BLOCK_PRIV, ma.ta_bytes)) ck_abort_msg(NULL);
+
+  /* Arena allocations are laid out back to back without metadata */
+  int *a = (int *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, 2 * sizeof(int));
+  int *b = (int *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, 2 * sizeof(int));
+  if (!a || !b || b != a + 2) ck_abort_msg(NULL);
+
+  /* Arena exhausted, falls back to the large block */
+  int *c = (int *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, sizeof(int));
+  if (!c) ck_abort_msg(NULL);
+
+  /* Large block exhausted as well, a new one gets chained on */
+  int *d = (int *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, sizeof(int));
+  if (!d) ck_abort_msg(NULL);
+
+  a[0] = a[1] = b[0] = b[1] = *c = *d = 30;
+  dlu_print_mb(DLU_SMALL_BLOCK_PRIV);
+
+  dlu_release_blocks();
+
+  /* Releasing blocks invalidates the arena */
+  if (dlu_alloc(DLU_SMALL_BLOCK_PRIV, sizeof(int))) ck_abort_msg(NULL);
+} END_TEST;
+
+START_TEST(slab_pool_reuse) {
+  dlu_otma_mems ma = {
+    .drmc_cnt = 1, .dob_cnt = 2,
+    .sp_cnt = 1, .spe_cnt = 2
+  };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+
+  dlu_disp_core *core = dlu_alloc(DLU_SMALL_BLOCK_PRIV, sizeof(dlu_disp_core));
+  if (!core) ck_abort_msg(NULL);
+
+  /* Only runtime churned resources are pooled */
+  if (dlu_otsa(DLU_SC_DATA, core, 1)) ck_abort_msg(NULL);
+
+  dlu_slab_pool *pool = dlu_otsa(DLU_DEVICE_OUTPUT_BUFF_DATA, core, ma.dob_cnt);
+  if (!pool) ck_abort_msg(NULL);
+
+  uint32_t a = dlu_slab_get(pool), b = dlu_slab_get(pool);
+  if (a != 0 || b != 1) ck_abort_msg(NULL);
+  if (dlu_slab_get(pool) != UINT32_MAX) ck_abort_msg(NULL);
+
+  core->buff_data[a].fb_id = 30;
+  core->buff_data[a].dma_buf_fds[0] = 3;
+
+  /* Freed slots are reset and handed out again */
+  if (!dlu_slab_put(pool, a)) ck_abort_msg(NULL);
+  if (dlu_slab_put(pool, a)) ck_abort_msg(NULL);
+  if (core->buff_data[a].fb_id != UINT32_MAX) ck_abort_msg(NULL);
+  if (core->buff_data[a].dma_buf_fds[0] != NEG_ONE) ck_abort_msg(NULL);
+  if (dlu_slab_get(pool) != a) ck_abort_msg(NULL);
+
+  dlu_release_blocks();
+} END_TEST;
+
+START_TEST(growable_priv_alloc) {
+  dlu_otma_mems ma = { .inta_cnt = 1 };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+
+  int *a = (int *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, sizeof(int));
+  if (!a) ck_abort_msg(NULL);
+  *a = 30;
+
+  /* Far larger than the first block, grows the chain instead of failing */
+  double *b = (double *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, 4096 * sizeof(double));
+  if (!b) ck_abort_msg(NULL);
+  b[4095] = 45.78;
+
+  /* Extra private blocks are chained, earlier pointers stay valid */
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+  if (*a != 30 || b[4095] != 45.78) ck_abort_msg(NULL);
+
+  /* Shared blocks remain a single fixed mapping */
+  if (!dlu_otma(DLU_LARGE_BLOCK_SHARED, ma)) ck_abort_msg(NULL);
+  if (dlu_otma(DLU_LARGE_BLOCK_SHARED, ma)) ck_abort_msg(NULL);
+  if (!dlu_alloc(DLU_SMALL_BLOCK_SHARED, sizeof(int))) ck_abort_msg(NULL);
+  if (dlu_alloc(DLU_SMALL_BLOCK_SHARED, sizeof(int))) ck_abort_msg(NULL);
+
+  dlu_print_mb(DLU_SMALL_BLOCK_PRIV);
+
+  dlu_release_blocks();
+} END_TEST;
+
+START_TEST(flagged_priv_alloc) {
+  dlu_otma_mems ma = {
+    .dba_cnt = 1024,
+    .mflags = DLU_MEM_HUGE_PAGES | DLU_MEM_PREFAULT | DLU_MEM_LOCK
+  };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+
+  double *d = (double *) dlu_alloc(DLU_SMALL_BLOCK_PRIV, 1024 * sizeof(double));
+  if (!d) ck_abort_msg(NULL);
+  d[0] = d[1023] = 45.78;
+
+  dlu_print_mb(DLU_SMALL_BLOCK_PRIV);
+
+  dlu_release_blocks();
+} END_TEST;
+
+START_TEST(frame_arena_alloc) {
+  dlu_otma_mems ma = { .fa_cnt = 2, .fa_bytes = 64 };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+  if (!dlu_otfa(ma.fa_cnt, ma.fa_bytes)) ck_abort_msg(NULL);
+
+  /* No frame begun yet */
+  if (dlu_frame_alloc(1)) ck_abort_msg(NULL);
+
+  dlu_frame_begin(0);
+  char *a = dlu_frame_alloc(32);
+  char *b = dlu_frame_alloc(32);
+  if (!a || !b || a == b) ck_abort_msg(NULL);
+
+  /* Slice exhausted */
+  if (dlu_frame_alloc(1)) ck_abort_msg(NULL);
+  strcpy(a, "abcdegf");
+
+  /* Next frame gets its own slice, frame 0 scratch is left alone */
+  dlu_frame_begin(1);
+  char *c = dlu_frame_alloc(32);
+  if (!c || c == a || c == b) ck_abort_msg(NULL);
+  if (strcmp(a, "abcdegf")) ck_abort_msg(NULL);
+
+  /* Frame indices wrap around the amount of slices */
+  dlu_frame_begin(2);
+  if (dlu_frame_alloc(32) != a) ck_abort_msg(NULL);
+
+  dlu_release_blocks();
+
+  /* Released along with the large block */
+  if (dlu_frame_alloc(1)) ck_abort_msg(NULL);
+} END_TEST;
+
+START_TEST(mm_stats_accounting) {
+  dlu_mm_stats before, after, data_before, data_after;
+  if (!dlu_mm_block_stats(DLU_SMALL_BLOCK_PRIV, &before)) ck_abort_msg(NULL);
+  if (!dlu_mm_data_stats(DLU_DEVICE_OUTPUT_DATA, &data_before)) ck_abort_msg(NULL);
+
+  dlu_disp_core core = {0};
+  dlu_otma_mems ma = { .dod_cnt = 1, .dob_cnt = 1, .ta_cnt = 1, .ta_bytes = sizeof(struct _drm_buff_data) };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+  if (!dlu_otba(DLU_DEVICE_OUTPUT_DATA, &core, INDEX_IGNORE, ma.dod_cnt)) ck_abort_msg(NULL);
+
+  if (!dlu_mm_block_stats(DLU_SMALL_BLOCK_PRIV, &after)) ck_abort_msg(NULL);
+  if (!dlu_mm_data_stats(DLU_DEVICE_OUTPUT_DATA, &data_after)) ck_abort_msg(NULL);
+
+  if (after.allocs != before.allocs + 1) ck_abort_msg(NULL);
+  if (after.requested - before.requested != sizeof(struct _output_data)) ck_abort_msg(NULL);
+  /* Block overhead also includes the padding that cache line aligns the array */
+  if (after.overhead - before.overhead < data_after.overhead - data_before.overhead) ck_abort_msg(NULL);
+  if ((uintptr_t) core.output_data % CACHE_LINE_SIZE) ck_abort_msg(NULL);
+  if (data_after.requested - data_before.requested != sizeof(struct _output_data)) ck_abort_msg(NULL);
+  if (after.peak < after.in_use) ck_abort_msg(NULL);
+
+  /* Arrays served from a thread arena carry no block header */
+  if (!dlu_otta(DLU_SMALL_BLOCK_PRIV, ma.ta_bytes)) ck_abort_msg(NULL);
+  if (!dlu_mm_data_stats(DLU_DEVICE_OUTPUT_BUFF_DATA, &data_before)) ck_abort_msg(NULL);
+  if (!dlu_otba(DLU_DEVICE_OUTPUT_BUFF_DATA, &core, INDEX_IGNORE, ma.dob_cnt)) ck_abort_msg(NULL);
+  if (!dlu_mm_data_stats(DLU_DEVICE_OUTPUT_BUFF_DATA, &data_after)) ck_abort_msg(NULL);
+  if (data_after.allocs != data_before.allocs + 1 || data_after.overhead != data_before.overhead) ck_abort_msg(NULL);
+
+  /* Shared block was never allocated */
+  if (dlu_alloc(DLU_SMALL_BLOCK_SHARED, 1)) ck_abort_msg(NULL);
+  if (!dlu_mm_block_stats(DLU_SMALL_BLOCK_SHARED, &after)) ck_abort_msg(NULL);
+  if (!after.failures) ck_abort_msg(NULL);
+
+  if (dlu_mm_dump_stats(-1)) ck_abort_msg(NULL);
+
+  dlu_release_blocks();
+
+  /* Only live usage is reset, the high-water mark stays */
+  if (!dlu_mm_block_stats(DLU_SMALL_BLOCK_PRIV, &after)) ck_abort_msg(NULL);
+  if (after.in_use || !after.peak) ck_abort_msg(NULL);
+} END_TEST;
+
+START_TEST(memfd_shared_alloc) {
+  int sv[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) == NEG_ONE) ck_abort_msg(NULL);
+
+  pid_t pid = fork();
+  if (pid == NEG_ONE) ck_abort_msg(NULL);
+
+  if (!pid) {
+    /* Helper process maps the same block, writes into it and sends back an offset */
+    close(sv[0]);
+    int fd = dlu_recv_shared_fd(sv[1]);
+    if (fd == NEG_ONE || !dlu_import_shared(fd)) _exit(EXIT_FAILURE);
+
+    char *str = dlu_alloc(DLU_SMALL_BLOCK_SHARED, 8);
+    if (!str) _exit(EXIT_FAILURE);
+    strcpy(str, "abcdegf");
+
+    uint64_t off = dlu_shared_off(str);
+    if (!off || write(sv[1], &off, sizeof(off)) != sizeof(off)) _exit(EXIT_FAILURE);
+
+    dlu_release_blocks();
+    _exit(EXIT_SUCCESS);
+  }
+
+  close(sv[1]);
+  dlu_otma_mems ma = { .cha_cnt = 64, .mflags = DLU_MEM_SHAREABLE };
+  if (!dlu_otma(DLU_LARGE_BLOCK_SHARED, ma)) ck_abort_msg(NULL);
+  if (dlu_shared_fd() == NEG_ONE) ck_abort_msg(NULL);
+  if (!dlu_send_shared_fd(sv[0])) ck_abort_msg(NULL);
+
+  uint64_t off = 0;
+  if (read(sv[0], &off, sizeof(off)) != sizeof(off)) ck_abort_msg(NULL);
+
+  int status = 0;
+  if (waitpid(pid, &status, 0) == NEG_ONE || !WIFEXITED(status) || WEXITSTATUS(status)) ck_abort_msg(NULL);
+
+  /* Same bytes, different address space */
+  char *str = dlu_shared_ptr(off);
+  if (!str || strcmp(str, "abcdegf")) ck_abort_msg(NULL);
+
+  /* Child's bump is seen here too, next allocation lands past it */
+  char *next = dlu_alloc(DLU_SMALL_BLOCK_SHARED, 8);
+  if (!next || next == str) ck_abort_msg(NULL);
+  if (dlu_shared_ptr(0)) ck_abort_msg(NULL);
+
+  close(sv[0]);
+  dlu_release_blocks();
+  if (dlu_shared_fd() != NEG_ONE) ck_abort_msg(NULL);
+} END_TEST;
+
+START_TEST(cache_line_aligned_alloc) {
+  dlu_otma_mems ma = { .cha_cnt = 4096, .ta_cnt = 1, .ta_bytes = 512 };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+
+  /* Shared lock-free path, header sits in front of the padding */
+  char *a = dlu_alloc(DLU_SMALL_BLOCK_PRIV, 3);
+  char *b = dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, 100, CACHE_LINE_SIZE);
+  char *c = dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, 8, 1024);
+  if (!a || !b || !c) ck_abort_msg(NULL);
+  if ((uintptr_t) b % CACHE_LINE_SIZE || (uintptr_t) c % 1024) ck_abort_msg(NULL);
+  memset(b, 'b', 100);
+  if (a[0] == 'b' || c[0] == 'b') ck_abort_msg(NULL);
+
+  if (dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, 8, 48)) ck_abort_msg(NULL);
+  if (dlu_alloc_aligned(DLU_LARGE_BLOCK_PRIV, 8, 64)) ck_abort_msg(NULL);
+
+  /* Thread arena path keeps no headers, back to back arrays are dense */
+  if (!dlu_otta(DLU_SMALL_BLOCK_PRIV, ma.ta_bytes)) ck_abort_msg(NULL);
+  char *d = dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, CACHE_LINE_SIZE, CACHE_LINE_SIZE);
+  char *e = dlu_alloc_aligned(DLU_SMALL_BLOCK_PRIV, CACHE_LINE_SIZE, CACHE_LINE_SIZE);
+  if (!d || (uintptr_t) d % CACHE_LINE_SIZE || e != d + CACHE_LINE_SIZE) ck_abort_msg(NULL);
+
+  dlu_print_mb(DLU_LARGE_BLOCK_PRIV);
+  dlu_release_blocks();
+} END_TEST;
+
+START_TEST(per_thread_cmd_data_mems) {
+  vkcomp app = {0};
+  dlu_otma_mems ma = { .cmdd_cnt = 4, .cb_cnt = 4 * 3 };
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+  if (!dlu_otba(DLU_CMD_DATA, &app, INDEX_IGNORE, ma.cmdd_cnt)) ck_abort_msg(NULL);
+
+  /* One pool per recording thread, each owns a command buffer per swap chain image */
+  for (uint32_t i = 0; i < ma.cmdd_cnt; i++) {
+    if (!dlu_otba(DLU_CMD_DATA_MEMS, &app, i, ma.cb_cnt / ma.cmdd_cnt)) ck_abort_msg(NULL);
+    if (i && app.cmd_data[i].cmd_buffs == app.cmd_data[i-1].cmd_buffs) ck_abort_msg(NULL);
+  }
+
+  dlu_mm_stats stats;
+  if (!dlu_mm_data_stats(DLU_CMD_DATA_MEMS, &stats)) ck_abort_msg(NULL);
+  if (stats.allocs < ma.cmdd_cnt || stats.requested < ma.cb_cnt * sizeof(VkCommandBuffer)) ck_abort_msg(NULL);
+
+  dlu_release_blocks();
+} END_TEST;
+
 Suite *alloc_suite(void) {
   Suite *s = NULL;
   TCase *tc_core = NULL;
@@ -92,6 +377,15 @@ Suite *alloc_suite(void) {
 
   tcase_add_test(tc_core, basic_priv_alloc);
   tcase_add_test(tc_core, basic_shared_alloc);
+  tcase_add_test(tc_core, thread_arena_alloc);
+  tcase_add_test(tc_core, slab_pool_reuse);
+  tcase_add_test(tc_core, growable_priv_alloc);
+  tcase_add_test(tc_core, flagged_priv_alloc);
+  tcase_add_test(tc_core, frame_arena_alloc);
+  tcase_add_test(tc_core, mm_stats_accounting);
+  tcase_add_test(tc_core, memfd_shared_alloc);
+  tcase_add_test(tc_core, cache_line_aligned_alloc);
+  tcase_add_test(tc_core, per_thread_cmd_data_mems);
   suite_add_tcase(s, tc_core);
 
   return s;
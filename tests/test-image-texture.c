@@ -50,7 +50,8 @@ char *concat(char *fmt, ...);
 static dlu_otma_mems ma = {
   .vkcomp_cnt = 1, .desc_cnt = NUM_DESCRIPTOR_SETS, .gp_cnt = 1, .si_cnt = 5,
   .scd_cnt = 1, .gpd_cnt = 1, .cmdd_cnt = 1, .bd_cnt = 1,
-  .dd_cnt = 1, .td_cnt = 1, .ld_cnt = 1, .pd_cnt = 1
+  .dd_cnt = 1, .td_cnt = 1, .ld_cnt = 1, .pd_cnt = 1,
+  .fa_cnt = MAX_FRAMES, .fa_bytes = 1 << 14
 };
 
 /* Be sure to make struct binary compatible with shader variable */
@@ -87,6 +88,9 @@ static bool init_buffs(vkcomp *app) {
   err = dlu_otba(DLU_TEXT_DATA, app, INDEX_IGNORE, ma.td_cnt);
   if (!err) return err;
 
+  err = dlu_otfa(ma.fa_cnt, ma.fa_bytes);
+  if (!err) return err;
+
   return err;
 }
 
@@ -329,7 +333,7 @@ START_TEST(test_vulkan_image_texture) {
 
   /* Destroy staging buffer and memory as it is no longer needed */
   dlu_vk_destroy(DLU_DESTROY_VK_BUFFER, app, cur_ld, app->buff_data[cur_bd].buff); app->buff_data[cur_bd].buff = VK_NULL_HANDLE;
-  dlu_vk_destroy(DLU_DESTROY_VK_MEMORY, app, cur_ld, app->buff_data[cur_bd].mem); app->buff_data[cur_bd].mem = VK_NULL_HANDLE;
+  dlu_vk_free_mem(DLU_VK_BUFFER, app, cur_bd);
 
   VkSamplerCreateInfo sampler = dlu_set_sampler_info(0, VK_FILTER_LINEAR, VK_FILTER_LINEAR, 0.0f, VK_SAMPLER_MIPMAP_MODE_LINEAR,
     VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT, 16.0f, VK_TRUE, VK_FALSE,
@@ -576,8 +580,6 @@ START_TEST(test_vulkan_image_texture) {
   uint64_t time = 0, start = dlu_hrnst();
   uint32_t cur_frame = 0, img_index;
 
-  VkCommandBuffer cmd_buffs[app->sc_data[cur_scd].sic];
-  VkSemaphore acquire_sems[MAX_FRAMES], render_sems[MAX_FRAMES];
   VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
 
   for (uint32_t c = 0; c < 3000; c++) {
@@ -585,12 +587,19 @@ START_TEST(test_vulkan_image_texture) {
     err = dlu_vk_sync(DLU_VK_WAIT_RENDER_FENCE, app, cur_scd, cur_frame);
     check_err(err, app, wc, NULL)
 
+    /* GPU is done with this frame, its scratch can be handed out again */
+    dlu_frame_begin(cur_frame);
+    VkCommandBuffer *cmd_buff = dlu_frame_alloc(sizeof(VkCommandBuffer));
+    VkSemaphore *acquire_sem = dlu_frame_alloc(sizeof(VkSemaphore));
+    VkSemaphore *render_sem = dlu_frame_alloc(sizeof(VkSemaphore));
+    check_err((!cmd_buff || !acquire_sem || !render_sem), app, wc, NULL)
+
     err = dlu_acquire_sc_image_index(app, cur_scd, cur_frame, &img_index);
     check_err(err, app, wc, NULL)
 
-    cmd_buffs[img_index] = app->cmd_data[cur_pool].cmd_buffs[img_index];
-    acquire_sems[cur_frame] = app->sc_data[cur_scd].syncs[cur_frame].sem.image;
-    render_sems[cur_frame] = app->sc_data[cur_scd].syncs[cur_frame].sem.render;
+    *cmd_buff = app->cmd_data[cur_pool].cmd_buffs[img_index];
+    *acquire_sem = app->sc_data[cur_scd].syncs[cur_frame].sem.image;
+    *render_sem = app->sc_data[cur_scd].syncs[cur_frame].sem.render;
 
     time = dlu_hrnst() - start;
     dlu_set_matrix(DLU_MAT4_IDENTITY, ubd.model, NULL);
@@ -603,10 +612,10 @@ START_TEST(test_vulkan_image_texture) {
     err = dlu_vk_sync(DLU_VK_RESET_RENDER_FENCE, app, cur_scd, cur_frame);
     check_err(err, app, wc, NULL)
 
-    err = dlu_queue_graphics_queue(app, cur_scd, cur_frame, 1, &cmd_buffs[img_index], 1, &acquire_sems[cur_frame], &wait_stage, 1, &render_sems[cur_frame]);
+    err = dlu_queue_graphics_queue(app, cur_scd, cur_frame, 1, cmd_buff, 1, acquire_sem, &wait_stage, 1, render_sem);
     check_err(err, app, wc, NULL)
 
-    err = dlu_queue_present_queue(app, cur_ld, 1, &render_sems[cur_frame], 1, &app->sc_data[cur_scd].swap_chain, &img_index, NULL);
+    err = dlu_queue_present_queue(app, cur_ld, 1, render_sem, 1, &app->sc_data[cur_scd].swap_chain, &img_index, NULL);
     check_err(err, app, wc, NULL)
 
     cur_frame = (cur_frame + 1) % MAX_FRAMES;
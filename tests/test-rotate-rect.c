@@ -420,7 +420,8 @@ START_TEST(test_vulkan_rotate_rect) {
     dlu_set_matrix(DLU_MAT4_IDENTITY, ubd.model, NULL);
     dlu_set_rotate(DLU_AXIS_Z, ubd.model, ((float) time / convert) * angle, spin_up);
 
-    err = dlu_vk_map_mem(DLU_VK_BUFFER, app, cur_bd, sizeof(struct uniform_block_data), &ubd, offsets[2], 0);
+    /* Buffer stays mapped, updating the uniform block is a plain copy */
+    err = dlu_vk_write_buff(app, cur_bd, offsets[2], &ubd, sizeof(struct uniform_block_data));
     check_err(err, app, wc, NULL)
 
     /* set fence to unsignal state */
@@ -25,10 +25,89 @@
 #include <check.h>
 
 #define LUCUR_VKCOMP_API
+#define LUCUR_SPIRV_API
 #include <lucom.h>
 
 #include "wayland/client.h" /* Leave for now */
 #include "test-extras.h"
+#include "test-shade.h"
+
+/**
+* Setup shared by the tests past the fifth. Allocates everything requested in ma,
+* then creates the instance and a logical device with a queue for each of flags.
+*/
+static vkcomp *init_device(dlu_otma_mems ma, char *name, VkQueueFlags flags, uint32_t ext_cnt, const char **exts) {
+  VkResult err;
+
+  if (!dlu_otma(DLU_LARGE_BLOCK_PRIV, ma)) ck_abort_msg(NULL);
+
+  vkcomp *app = dlu_init_vk();
+  check_err(!app, app, NULL, NULL)
+
+  err = dlu_otba(DLU_PD_DATA, app, INDEX_IGNORE, ma.pd_cnt);
+  if (!err) ck_abort_msg(NULL);
+
+  err = dlu_otba(DLU_LD_DATA, app, INDEX_IGNORE, ma.ld_cnt);
+  if (!err) ck_abort_msg(NULL);
+
+  if (ma.bd_cnt) {
+    err = dlu_otba(DLU_BUFF_DATA, app, INDEX_IGNORE, ma.bd_cnt);
+    if (!err) ck_abort_msg(NULL);
+  }
+
+  if (ma.td_cnt) {
+    err = dlu_otba(DLU_TEXT_DATA, app, INDEX_IGNORE, ma.td_cnt);
+    if (!err) ck_abort_msg(NULL);
+  }
+
+  if (ma.gpd_cnt) {
+    err = dlu_otba(DLU_GP_DATA, app, INDEX_IGNORE, ma.gpd_cnt);
+    if (!err) ck_abort_msg(NULL);
+
+    for (uint32_t i = 0; i < ma.gpd_cnt && ma.gp_cnt; i++) {
+      err = dlu_otba(DLU_GP_DATA_MEMS, app, i, ma.gp_cnt / ma.gpd_cnt);
+      if (!err) ck_abort_msg(NULL);
+    }
+  }
+
+  if (ma.cmdd_cnt) {
+    err = dlu_otba(DLU_CMD_DATA, app, INDEX_IGNORE, ma.cmdd_cnt);
+    if (!err) ck_abort_msg(NULL);
+
+    for (uint32_t i = 0; i < ma.cmdd_cnt && ma.cb_cnt; i++) {
+      err = dlu_otba(DLU_CMD_DATA_MEMS, app, i, ma.cb_cnt / ma.cmdd_cnt);
+      if (!err) ck_abort_msg(NULL);
+    }
+  }
+
+  err = dlu_create_instance(app, name, "No Engine", 0, NULL, 0, NULL);
+  check_err(err, app, NULL, NULL)
+
+  VkPhysicalDeviceProperties device_props;
+  VkPhysicalDeviceFeatures device_feats;
+  err = dlu_create_physical_device(app, 0, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, &device_props, &device_feats);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_create_queue_families(app, 0, flags);
+  check_err(!err, app, NULL, NULL)
+
+  /* No surface, so the graphics family is whatever the transfer search didn't pick */
+  if (app->pd_data[0].gfam_idx == UINT32_MAX) app->pd_data[0].gfam_idx = 0;
+
+  float queue_priorities[1] = {1.0};
+  uint32_t dqc = ((flags & VK_QUEUE_TRANSFER_BIT) && app->pd_data[0].tfam_idx != app->pd_data[0].gfam_idx) ? 2 : 1;
+  VkDeviceQueueCreateInfo dqueue_create_info[2];
+  dqueue_create_info[0] = dlu_set_device_queue_info(0, app->pd_data[0].gfam_idx, 1, queue_priorities);
+  dqueue_create_info[1] = dlu_set_device_queue_info(0, app->pd_data[0].tfam_idx, 1, queue_priorities);
+
+  err = dlu_create_logical_device(app, 0, 0, 0, dqc, dqueue_create_info, &device_feats, ext_cnt, exts);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_create_device_queue(app, 0, 0, flags);
+  check_err(err, app, NULL, NULL)
+
+  return app;
+}
 
 START_TEST(test_init_vulkan) {
   dlu_otma_mems ma = { .vkcomp_cnt = 1 };
@@ -169,6 +248,609 @@ START_TEST(test_set_logical_device) {
   FREEME(app, NULL)
 } END_TEST;
 
+START_TEST(test_device_mem_suballoc) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "SIXTH TEST");
+
+  uint32_t buff_cnt = 1000;
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = buff_cnt };
+  vkcomp *app = init_device(ma, "Device Memory", VK_QUEUE_GRAPHICS_BIT, 0, NULL);
+
+  /* Thousands of small uniform buffers should only cost a handful of vkAllocateMemory calls */
+  for (uint32_t i = 0; i < buff_cnt; i++) {
+    err = dlu_create_vk_buffer(app, 0, i, 256, 0, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL,
+                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    check_err(err, app, NULL, NULL)
+  }
+
+  dlu_vk_mem_stats stats, total = {0};
+  for (uint32_t heap = 0; heap < VK_MAX_MEMORY_HEAPS; heap++) {
+    if (!dlu_vk_get_mem_stats(app, 0, heap, &stats)) ck_abort_msg(NULL);
+    total.block_cnt += stats.block_cnt;
+    total.alloc_cnt += stats.alloc_cnt;
+    total.allocated += stats.allocated;
+  }
+
+  if (total.alloc_cnt != buff_cnt) ck_abort_msg(NULL);
+  if (total.block_cnt > 4) ck_abort_msg(NULL);
+
+  /* No VK_EXT_memory_budget, usage is estimated from the sub-allocator */
+  dlu_vk_heap_budget budgets[VK_MAX_MEMORY_HEAPS];
+  uint32_t heap_cnt = dlu_vk_get_mem_budget(app, 0, budgets);
+  if (!heap_cnt) ck_abort_msg(NULL);
+
+  VkDeviceSize usage = 0;
+  for (uint32_t heap = 0; heap < heap_cnt; heap++) {
+    if (budgets[heap].usage > budgets[heap].budget) ck_abort_msg(NULL);
+    usage += budgets[heap].usage;
+  }
+
+  if (usage != total.allocated) ck_abort_msg(NULL);
+
+  /* Memory goes back to the sub-allocator, not the driver */
+  for (uint32_t i = 0; i < buff_cnt; i += 2) {
+    dlu_vk_destroy(DLU_DESTROY_VK_BUFFER, app, 0, app->buff_data[i].buff); app->buff_data[i].buff = VK_NULL_HANDLE;
+    dlu_vk_free_mem(DLU_VK_BUFFER, app, i);
+  }
+
+  total.alloc_cnt = 0;
+  for (uint32_t heap = 0; heap < VK_MAX_MEMORY_HEAPS; heap++) {
+    if (!dlu_vk_get_mem_stats(app, 0, heap, &stats)) ck_abort_msg(NULL);
+    total.alloc_cnt += stats.alloc_cnt;
+  }
+
+  if (total.alloc_cnt != buff_cnt / 2) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_async_upload) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "SEVENTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = 3, .cmdd_cnt = 1, .cb_cnt = 1 };
+  vkcomp *app = init_device(ma, "Async Upload", VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT, 0, NULL);
+
+  err = dlu_vk_create_uploader(app, 0, 1 << 20);
+  check_err(err, app, NULL, NULL)
+
+  VkDeviceSize size = 1 << 16;
+  err = dlu_create_vk_buffer(app, 0, 0, size, 0, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_create_vk_buffer(app, 0, 1, size, 0, VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT |
+                             VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  check_err(err, app, NULL, NULL)
+
+  /* Read back the device local buffer after the round trip */
+  err = dlu_create_vk_buffer(app, 0, 2, size, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  check_err(err, app, NULL, NULL)
+
+  /* Every slot can be recorded into without waiting, the next one has to report busy */
+  uint32_t slots[DLU_VK_UPLOAD_SLOTS], slot;
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    VkCommandBuffer cmd_buff = dlu_vk_upload_begin(app, &slots[i]);
+    check_err(!cmd_buff, app, NULL, NULL)
+    dlu_exec_copy_buffer(app, 0, 1, 0, 0, size, cmd_buff);
+    dlu_vk_upload_release_buff(app, slots[i], 1, 0, size);
+  }
+
+  VkCommandBuffer busy = dlu_vk_upload_begin(app, &slot);
+  check_err(busy, app, NULL, NULL)
+
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    err = dlu_vk_upload_submit(app, slots[i], false);
+    check_err(err, app, NULL, NULL)
+  }
+
+  for (uint32_t i = 0; i < DLU_VK_UPLOAD_SLOTS; i++) {
+    err = dlu_vk_upload_wait(app, slots[i], UINT64_MAX);
+    check_err(err, app, NULL, NULL)
+    if (!dlu_vk_upload_done(app, slots[i])) ck_abort_msg(NULL);
+  }
+
+  /* A finished slot is recycled */
+  VkCommandBuffer recycled = dlu_vk_upload_begin(app, &slot);
+  check_err(!recycled, app, NULL, NULL)
+  err = dlu_vk_upload_submit(app, slot, false);
+  check_err(err, app, NULL, NULL)
+
+  /* Round trip, the transfer queue releases what it uploaded and graphics acquires it to copy it back */
+  uint32_t words[1024];
+  for (uint32_t i = 0; i < ARR_LEN(words); i++) words[i] = 0xc0de0000 + i;
+
+  VkCommandBuffer cmd_buff = dlu_vk_upload_begin(app, &slot);
+  check_err(!cmd_buff, app, NULL, NULL)
+
+  err = dlu_vk_upload_buff(app, slot, 1, 0, words, sizeof(words));
+  check_err(err, app, NULL, NULL)
+
+  dlu_vk_upload_release_buff(app, slot, 1, 0, sizeof(words));
+
+  err = dlu_vk_upload_submit(app, slot, true);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_create_frame_cmd_pool(app, 0, 0, app->pd_data[0].gfam_idx);
+  check_err(err, app, NULL, NULL)
+
+  cmd_buff = dlu_exec_begin_frame(app, 0);
+  check_err(!cmd_buff, app, NULL, NULL)
+
+  dlu_vk_upload_acquire_buff(app, 1, 0, sizeof(words), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, cmd_buff);
+  dlu_exec_copy_buffer(app, 1, 2, 0, 0, sizeof(words), cmd_buff);
+
+  err = dlu_exec_stop_frame(app, 0);
+  check_err(err, app, NULL, NULL)
+
+  VkSemaphore upload_sem = dlu_vk_upload_wait_sem(app, slot);
+  check_err(!upload_sem, app, NULL, NULL)
+
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  VkSubmitInfo submit_info = {};
+  submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+  submit_info.waitSemaphoreCount = 1;
+  submit_info.pWaitSemaphores = &upload_sem;
+  submit_info.pWaitDstStageMask = &wait_stage;
+  submit_info.commandBufferCount = 1;
+  submit_info.pCommandBuffers = &cmd_buff;
+
+  err = vkQueueSubmit(app->ld_data[0].graphics, 1, &submit_info, VK_NULL_HANDLE);
+  check_err(err, app, NULL, NULL)
+
+  err = vkQueueWaitIdle(app->ld_data[0].graphics);
+  check_err(err, app, NULL, NULL)
+
+  if (memcmp(app->buff_data[2].mapped, words, sizeof(words))) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_batched_upload) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "EIGHTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = 1 };
+  vkcomp *app = init_device(ma, "Batched Upload", VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_TRANSFER_BIT, 0, NULL);
+
+  err = dlu_vk_create_uploader(app, 0, 1 << 20);
+  check_err(err, app, NULL, NULL)
+
+  /* Read back through the persistent mapping */
+  uint32_t chunk_cnt = 500, chunk[64];
+  VkDeviceSize size = chunk_cnt * sizeof(chunk);
+  err = dlu_create_vk_buffer(app, 0, 0, size, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  check_err(err, app, NULL, NULL)
+
+  uint32_t slot;
+  VkCommandBuffer cmd_buff = dlu_vk_upload_begin(app, &slot);
+  check_err(!cmd_buff, app, NULL, NULL)
+
+  /* Every copy goes out with a single submit */
+  for (uint32_t i = 0; i < chunk_cnt; i++) {
+    for (uint32_t j = 0; j < ARR_LEN(chunk); j++) chunk[j] = i;
+    err = dlu_vk_upload_buff(app, slot, 0, i * sizeof(chunk), chunk, sizeof(chunk));
+    check_err(err, app, NULL, NULL)
+  }
+
+  dlu_vk_upload_release_buff(app, slot, 0, 0, size);
+
+  err = dlu_vk_upload_submit(app, slot, false);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_vk_upload_wait(app, slot, UINT64_MAX);
+  check_err(err, app, NULL, NULL)
+
+  uint32_t *data = app->buff_data[0].mapped;
+  for (uint32_t i = 0; i < chunk_cnt; i++)
+    if (data[i * ARR_LEN(chunk)] != i) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_aliased_images) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "NINTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .td_cnt = 3 };
+  vkcomp *app = init_device(ma, "Aliased Images", VK_QUEUE_GRAPHICS_BIT, 0, NULL);
+
+  /* Three render targets of different sizes used one after the other */
+  VkImageCreateInfo img_infos[3];
+  VkImageViewCreateInfo ivis[3];
+  VkImageSubresourceRange range = dlu_set_image_sub_resource_range(VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1);
+  VkComponentMapping comp_map = dlu_set_component_mapping(VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                                                          VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY);
+
+  for (uint32_t i = 0; i < ARR_LEN(img_infos); i++) {
+    img_infos[i] = dlu_set_image_info(0, VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, dlu_set_extent3D(256 << i, 256 << i, 1), 1, 1,
+                                      VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_TILING_OPTIMAL,
+                                      VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+                                      VK_SHARING_MODE_EXCLUSIVE, 0, NULL, VK_IMAGE_LAYOUT_UNDEFINED);
+    ivis[i] = dlu_set_image_view_info(0, VK_NULL_HANDLE, VK_IMAGE_VIEW_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, comp_map, range);
+  }
+
+  err = dlu_create_aliased_images(app, 0, 0, ARR_LEN(img_infos), img_infos, ivis, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  check_err(err, app, NULL, NULL)
+
+  for (uint32_t i = 1; i < ARR_LEN(img_infos); i++) {
+    if (app->text_data[i].mem != app->text_data[0].mem) ck_abort_msg(NULL);
+    if (app->text_data[i].offset != app->text_data[0].offset) ck_abort_msg(NULL);
+  }
+
+  dlu_vk_mem_stats stats;
+  uint32_t alloc_cnt = 0;
+  for (uint32_t heap = 0; heap < VK_MAX_MEMORY_HEAPS; heap++) {
+    if (!dlu_vk_get_mem_stats(app, 0, heap, &stats)) ck_abort_msg(NULL);
+    alloc_cnt += stats.alloc_cnt;
+  }
+
+  if (alloc_cnt != 1) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_instance_stream) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "TENTH TEST");
+
+  uint32_t frames = 3, instances = 4096;
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = 1 };
+  vkcomp *app = init_device(ma, "Instance Stream", VK_QUEUE_GRAPHICS_BIT, 0, NULL);
+
+  /* One model matrix per instance, frames in flight never share a slice */
+  VkDeviceSize instance_size = 16 * sizeof(float);
+  err = dlu_create_instance_stream(app, 0, 0, instance_size, instances, frames);
+  check_err(err, app, NULL, NULL)
+
+  VkDeviceSize offsets[3];
+  for (uint32_t f = 0; f < frames; f++) {
+    float (*models)[16] = dlu_vk_instance_stream_frame(app, 0, f, &offsets[f]);
+    if (!models || offsets[f] % 256) ck_abort_msg(NULL);
+    if (f && offsets[f] - offsets[f-1] < instances * instance_size) ck_abort_msg(NULL);
+
+    memset(models, 0, instances * instance_size);
+    models[instances-1][12] = (float) f;
+
+    err = dlu_vk_flush_buff(app, 0, offsets[f], instances * instance_size);
+    check_err(err, app, NULL, NULL)
+  }
+
+  for (uint32_t f = 0; f < frames; f++) {
+    float (*models)[16] = (float (*)[16]) (app->buff_data[0].mapped + offsets[f]);
+    if (models[instances-1][12] != (float) f) ck_abort_msg(NULL);
+  }
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_render_graph) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "ELEVENTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = 5, .rg_cnt = 1 };
+  vkcomp *app = init_device(ma, "Render Graph", VK_QUEUE_GRAPHICS_BIT, 0, NULL);
+
+  VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+  err = dlu_create_vk_buffer(app, 0, 0, 4096, 0, usage, VK_SHARING_MODE_EXCLUSIVE, 0, NULL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  check_err(err, app, NULL, NULL)
+
+  dlu_render_graph *graph = dlu_create_render_graph(app, 0);
+  check_err(!graph, app, NULL, NULL)
+
+  uint32_t out = dlu_graph_import_buff(graph, 0);
+  uint32_t a = dlu_graph_create_buff(graph, 1, 4096, usage);
+  uint32_t b = dlu_graph_create_buff(graph, 2, 4096, usage);
+  uint32_t c = dlu_graph_create_buff(graph, 3, 4096, usage);
+  uint32_t unused = dlu_graph_create_buff(graph, 4, 4096, usage);
+
+  VkPipelineStageFlags xfer = VK_PIPELINE_STAGE_TRANSFER_BIT;
+  uint32_t gen = dlu_graph_add_pass(graph, "gen", NULL, NULL);
+  dlu_graph_use(graph, gen, a, xfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+
+  uint32_t mid = dlu_graph_add_pass(graph, "mid", NULL, NULL);
+  dlu_graph_use(graph, mid, a, xfer, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+  dlu_graph_use(graph, mid, b, xfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+
+  uint32_t dead = dlu_graph_add_pass(graph, "dead", NULL, NULL);
+  dlu_graph_use(graph, dead, b, xfer, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+  dlu_graph_use(graph, dead, unused, xfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+
+  uint32_t late = dlu_graph_add_pass(graph, "late", NULL, NULL);
+  dlu_graph_use(graph, late, b, xfer, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+  dlu_graph_use(graph, late, c, xfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED);
+
+  uint32_t resolve = dlu_graph_add_pass(graph, "resolve", NULL, NULL);
+  if (!dlu_graph_use(graph, resolve, c, xfer, VK_ACCESS_TRANSFER_READ_BIT, VK_IMAGE_LAYOUT_UNDEFINED)) ck_abort_msg(NULL);
+  if (!dlu_graph_use(graph, resolve, out, xfer, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_UNDEFINED)) ck_abort_msg(NULL);
+
+  err = dlu_graph_compile(app, graph);
+  check_err(err, app, NULL, NULL)
+
+  /* Nothing reads what dead writes, a and c never overlap so they share memory */
+  if (!graph->passes[dead].culled || graph->passes[resolve].culled) ck_abort_msg(NULL);
+  if (dlu_graph_buff(app, graph, unused)) ck_abort_msg(NULL);
+  if (graph->res[a].slot != graph->res[c].slot || graph->res[a].slot == graph->res[b].slot) ck_abort_msg(NULL);
+  if (app->buff_data[1].mem != app->buff_data[3].mem) ck_abort_msg(NULL);
+
+  /* Read after write within the graph needs one merged memory barrier */
+  if (graph->passes[mid].batch.mbc != 1 || graph->passes[mid].batch.ibc) ck_abort_msg(NULL);
+
+  if (!dlu_graph_dump(graph, STDOUT_FILENO)) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_timeline_submit) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "TWELFTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1 };
+  const char *timeline_ext[] = { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+  vkcomp *app = init_device(ma, "Timeline Submit", VK_QUEUE_GRAPHICS_BIT, ARR_LEN(timeline_ext), timeline_ext);
+
+  err = dlu_create_timelines(app, 0);
+  check_err(err, app, NULL, NULL)
+
+  /* Empty batches still signal, each one waits on the one before it */
+  uint64_t value = 0, done = 0;
+  dlu_queue_type wait_queue = DLU_VK_GRAPHICS_QUEUE;
+  VkPipelineStageFlags wait_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+
+  for (uint32_t i = 0; i < 8; i++) {
+    err = dlu_queue_timeline_submit(app, 0, DLU_VK_GRAPHICS_QUEUE, 0, NULL, (value) ? 1 : 0, &wait_queue, &value, &wait_stage, &value);
+    check_err(err, app, NULL, NULL)
+  }
+
+  if (value != 8) ck_abort_msg(NULL);
+
+  err = dlu_vk_wait_timeline(app, 0, DLU_VK_GRAPHICS_QUEUE, value, UINT64_MAX);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_vk_get_timeline(app, 0, DLU_VK_GRAPHICS_QUEUE, &done);
+  check_err(err, app, NULL, NULL)
+
+  if (done < value) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_pipeline_dedup) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "THIRTEENTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .gpd_cnt = 2, .gp_cnt = 4 };
+  vkcomp *app = init_device(ma, "Pipeline Dedup", VK_QUEUE_GRAPHICS_BIT, 0, NULL);
+
+  /* Render passes only differing in load ops are compatible, pipelines made for one work with the other */
+  VkAttachmentDescription attachments[2];
+  for (uint32_t i = 0; i < 2; i++)
+    attachments[i] = dlu_set_attachment_desc(VK_FORMAT_B8G8R8A8_UNORM, VK_SAMPLE_COUNT_1_BIT,
+      (i) ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+      VK_ATTACHMENT_STORE_OP_DONT_CARE, (i) ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL
+    );
+  VkAttachmentReference color_ref = dlu_set_attachment_ref(0, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL);
+  VkSubpassDescription subpass = dlu_set_subpass_desc(0, VK_PIPELINE_BIND_POINT_GRAPHICS, 0, NULL, 1, &color_ref, NULL, NULL, 0, NULL);
+
+  for (uint32_t i = 0; i < ma.gpd_cnt; i++) {
+    err = dlu_create_pipeline_layout(app, 0, i, 0, NULL, 0, NULL, 0);
+    check_err(err, app, NULL, NULL)
+
+    err = dlu_create_render_pass(app, i, 1, &attachments[i], 1, &subpass, 0, NULL, 0);
+    check_err(err, app, NULL, NULL)
+  }
+
+  dlu_shader_info shi_vert = dlu_compile_to_spirv(VK_SHADER_STAGE_VERTEX_BIT, shader_vert_src, "vert.spv", "main");
+  check_err(!shi_vert.bytes, app, NULL, NULL)
+  dlu_shader_info shi_frag = dlu_compile_to_spirv(VK_SHADER_STAGE_FRAGMENT_BIT, shader_frag_src, "frag.spv", "main");
+  check_err(!shi_frag.bytes, app, NULL, NULL)
+
+  VkShaderModule vert_shader_module = dlu_create_shader_module(app, 0, shi_vert.bytes, shi_vert.byte_size);
+  VkShaderModule frag_shader_module = dlu_create_shader_module(app, 0, shi_frag.bytes, shi_frag.byte_size);
+  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi_vert.result);
+  dlu_freeup_spriv_bytes(DLU_LIB_SHADERC_SPRIV, shi_frag.result);
+  check_err((!vert_shader_module || !frag_shader_module), app, NULL, NULL)
+
+  VkPipelineShaderStageCreateInfo shader_stages[2];
+  shader_stages[0] = dlu_set_shader_stage_info(vert_shader_module, "main", VK_SHADER_STAGE_VERTEX_BIT, NULL, 0);
+  shader_stages[1] = dlu_set_shader_stage_info(frag_shader_module, "main", VK_SHADER_STAGE_FRAGMENT_BIT, NULL, 0);
+
+  VkVertexInputBindingDescription vi_binding = dlu_set_vertex_input_binding_desc(0, 5 * sizeof(float), VK_VERTEX_INPUT_RATE_VERTEX);
+  VkVertexInputAttributeDescription vi_attribs[2];
+  vi_attribs[0] = dlu_set_vertex_input_attrib_desc(0, 0, VK_FORMAT_R32G32_SFLOAT, 0);
+  vi_attribs[1] = dlu_set_vertex_input_attrib_desc(1, 0, VK_FORMAT_R32G32B32_SFLOAT, 2 * sizeof(float));
+  VkPipelineVertexInputStateCreateInfo vertex_input_info = dlu_set_vertex_input_state_info(1, &vi_binding, 2, vi_attribs);
+  VkPipelineInputAssemblyStateCreateInfo input_assembly = dlu_set_input_assembly_state_info(0, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
+
+  VkViewport viewport = dlu_set_view_port(0.0f, 0.0f, 64.0f, 64.0f, 0.0f, 1.0f);
+  VkRect2D scissor = dlu_set_rect2D(0, 0, 64, 64);
+  VkPipelineViewportStateCreateInfo view_port_info = dlu_set_view_port_state_info(1, &viewport, 1, &scissor);
+
+  VkPipelineRasterizationStateCreateInfo rasterizers[2];
+  for (uint32_t i = 0; i < 2; i++)
+    rasterizers[i] = dlu_set_rasterization_state_info(VK_FALSE, VK_FALSE, VK_POLYGON_MODE_FILL,
+      (i) ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT, VK_FRONT_FACE_CLOCKWISE, VK_FALSE, 0.0f, 0.0f, 0.0f, 1.0f);
+
+  VkPipelineMultisampleStateCreateInfo multisampling = dlu_set_multisample_state_info(VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f, NULL, VK_FALSE, VK_FALSE);
+
+  VkPipelineColorBlendAttachmentState color_blend_attachment = dlu_set_color_blend_attachment_state(
+    VK_FALSE, VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD,
+    VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD,
+    VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT
+  );
+  float blend_const[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+  VkPipelineColorBlendStateCreateInfo color_blending = dlu_set_color_blend_attachment_state_info(VK_FALSE, VK_LOGIC_OP_COPY, 1, &color_blend_attachment, blend_const);
+
+  for (uint32_t i = 0; i < ma.gpd_cnt; i++) {
+    err = dlu_create_graphics_pipelines(app, i, ARR_LEN(shader_stages), shader_stages, &vertex_input_info, &input_assembly, NULL,
+      &view_port_info, &rasterizers[0], &multisampling, NULL, &color_blending, NULL, 0, VK_NULL_HANDLE, -1);
+    check_err(err, app, NULL, NULL)
+  }
+
+  /* Same state in another gp_data, compiled once */
+  VkPipeline shared = app->gp_data[0].graphics_pipelines[0];
+  if (shared != app->gp_data[1].graphics_pipelines[0]) ck_abort_msg(NULL);
+  if (dlu_graphics_pipeline_refs(app, shared) != 2) ck_abort_msg(NULL);
+
+  /* Batch with an existing state and a new one */
+  VkGraphicsPipelineCreateInfo infos[2];
+  for (uint32_t i = 0; i < 2; i++)
+    infos[i] = dlu_set_graphics_pipeline_info(ARR_LEN(shader_stages), shader_stages, &vertex_input_info, &input_assembly, NULL,
+      &view_port_info, &rasterizers[i], &multisampling, NULL, &color_blending, NULL,
+      app->gp_data[1].pipeline_layout, app->gp_data[1].render_pass, 0);
+
+  /* Layout and render pass have to be known objects, or neither state is hashable */
+  uint64_t hashes[2] = { dlu_hash_graphics_pipeline(app, 0, &infos[0]), dlu_hash_graphics_pipeline(app, 0, &infos[1]) };
+  if (!hashes[0] || !hashes[1] || hashes[0] == hashes[1]) ck_abort_msg(NULL);
+
+  err = dlu_create_graphics_pipeline_batch(app, 1, 0, ARR_LEN(infos), infos, 0);
+  check_err(err, app, NULL, NULL)
+
+  /* Slot 0 of gp_data[1] is overwritten with the same pipeline, the reference it held is dropped */
+  if (app->gp_data[1].graphics_pipelines[0] != shared || app->gp_data[1].graphics_pipelines[1] == shared) ck_abort_msg(NULL);
+  if (dlu_graphics_pipeline_refs(app, shared) != 2) ck_abort_msg(NULL);
+
+  dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, frag_shader_module);
+  dlu_vk_destroy(DLU_DESTROY_VK_SHADER, app, 0, vert_shader_module);
+
+  /* Destroyed modules can't be hashed, such states are never shared */
+  if (dlu_hash_graphics_pipeline(app, 0, &infos[0])) ck_abort_msg(NULL);
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_frame_pool) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "FOURTEENTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = 1, .cmdd_cnt = 1, .cb_cnt = 1 };
+  const char *timeline_ext[] = { VK_KHR_TIMELINE_SEMAPHORE_EXTENSION_NAME };
+  vkcomp *app = init_device(ma, "Frame Pool", VK_QUEUE_GRAPHICS_BIT, ARR_LEN(timeline_ext), timeline_ext);
+
+  err = dlu_create_timelines(app, 0);
+  check_err(err, app, NULL, NULL)
+
+  VkDeviceSize size = 4096;
+  err = dlu_create_vk_buffer(app, 0, 0, size, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  check_err(err, app, NULL, NULL)
+
+  err = dlu_create_frame_cmd_pool(app, 0, 0, app->pd_data[0].gfam_idx);
+  check_err(err, app, NULL, NULL)
+
+  VkCommandPool pool = app->cmd_data[0].cmd_pool;
+  VkCommandBuffer first = app->cmd_data[0].cmd_buffs[0];
+  uint64_t value = 0;
+
+  /* Every frame records different content into the same pool and buffer */
+  for (uint32_t f = 0; f < 8; f++) {
+    VkCommandBuffer cmd_buff = dlu_exec_begin_frame(app, 0);
+    check_err(!cmd_buff, app, NULL, NULL)
+
+    /* Reset, not reallocated */
+    if (cmd_buff != first || app->cmd_data[0].cmd_pool != pool) ck_abort_msg(NULL);
+
+    dlu_exec_fill_buffer(app, 0, 0, size, 0xf00d0000 + f, cmd_buff);
+
+    err = dlu_exec_stop_frame(app, 0);
+    check_err(err, app, NULL, NULL)
+
+    err = dlu_queue_timeline_submit(app, 0, DLU_VK_GRAPHICS_QUEUE, 1, &cmd_buff, 0, NULL, NULL, NULL, &value);
+    check_err(err, app, NULL, NULL)
+
+    /* The pool may only be reset once the GPU is done with it */
+    err = dlu_vk_wait_timeline(app, 0, DLU_VK_GRAPHICS_QUEUE, value, UINT64_MAX);
+    check_err(err, app, NULL, NULL)
+
+    uint32_t *data = app->buff_data[0].mapped;
+    if (data[0] != 0xf00d0000 + f || data[size / sizeof(uint32_t) - 1] != 0xf00d0000 + f) ck_abort_msg(NULL);
+  }
+
+  FREEME(app, NULL)
+} END_TEST;
+
+START_TEST(test_one_shot_recycle) {
+  VkResult err;
+  dlu_log_me(DLU_WARNING, "FIFTEENTH TEST");
+
+  dlu_otma_mems ma = { .vkcomp_cnt = 1, .ld_cnt = 1, .pd_cnt = 1, .bd_cnt = 1, .cmdd_cnt = 1 };
+  vkcomp *app = init_device(ma, "One Shot Recycle", VK_QUEUE_GRAPHICS_BIT, 0, NULL);
+
+  /* Only selects the logical device, one time buffers come from the library's own pool */
+  err = dlu_create_cmd_pool(app, 0, 0, app->pd_data[0].gfam_idx, 0);
+  check_err(err, app, NULL, NULL)
+
+  /* Three rounds through every slot, each one-shot fills its own region */
+  uint32_t count = 3 * DLU_VK_ONE_SHOT_CNT;
+  VkDeviceSize region = 256;
+  err = dlu_create_vk_buffer(app, 0, 0, count * region, 0, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_SHARING_MODE_EXCLUSIVE, 0, NULL,
+                             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  check_err(err, app, NULL, NULL)
+
+  struct _ld_data *ld = &app->ld_data[0];
+  VkCommandBuffer cmd_buffs[DLU_VK_ONE_SHOT_CNT];
+  VkFence fences[DLU_VK_ONE_SHOT_CNT];
+
+  for (uint32_t i = 0; i < count; i++) {
+    VkCommandBuffer cmd_buff = dlu_exec_begin_single_time_cmd_buff(app, 0);
+    check_err(!cmd_buff, app, NULL, NULL)
+
+    dlu_exec_fill_buffer(app, 0, i * region, region, i, cmd_buff);
+
+    /* Never waits, past the first round begin has to wait for a slot to free up */
+    err = dlu_exec_submit_single_time_cmd_buff(app, 0, &cmd_buff);
+    check_err(err, app, NULL, NULL)
+
+    if (i == DLU_VK_ONE_SHOT_CNT - 1) {
+      for (uint32_t j = 0; j < DLU_VK_ONE_SHOT_CNT; j++) {
+        cmd_buffs[j] = ld->one_shots[j].cmd_buff;
+        fences[j] = ld->one_shots[j].fence;
+      }
+    }
+
+    /* Every slot is used once, then recycled rather than reallocated */
+    if (i >= DLU_VK_ONE_SHOT_CNT) {
+      bool reused = false;
+      for (uint32_t j = 0; j < DLU_VK_ONE_SHOT_CNT; j++) {
+        if (ld->one_shots[j].cmd_buff != cmd_buffs[j] || ld->one_shots[j].fence != fences[j]) ck_abort_msg(NULL);
+        reused |= (cmd_buff == cmd_buffs[j]);
+      }
+      if (!reused) ck_abort_msg(NULL);
+    }
+  }
+
+  err = vkQueueWaitIdle(ld->graphics);
+  check_err(err, app, NULL, NULL)
+
+  uint32_t *data = app->buff_data[0].mapped;
+  for (uint32_t i = 0; i < count; i++)
+    if (data[i * region / sizeof(uint32_t)] != i) ck_abort_msg(NULL);
+
+  /* Slot 0's fence now never signals, ending another buffer must not wait on it */
+  err = vkResetFences(ld->device, 1, &ld->one_shots[0].fence);
+  check_err(err, app, NULL, NULL)
+
+  VkCommandBuffer cmd_buff = dlu_exec_begin_single_time_cmd_buff(app, 0);
+  check_err(!cmd_buff, app, NULL, NULL)
+  if (cmd_buff == ld->one_shots[0].cmd_buff) ck_abort_msg(NULL);
+
+  err = dlu_exec_end_single_time_cmd_buff(app, 0, &cmd_buff);
+  check_err(err, app, NULL, NULL)
+
+  if (vkGetFenceStatus(ld->device, ld->one_shots[0].fence) != VK_NOT_READY) ck_abort_msg(NULL);
+
+  /* An empty submission signals it again */
+  err = vkQueueSubmit(ld->graphics, 0, NULL, ld->one_shots[0].fence);
+  check_err(err, app, NULL, NULL)
+
+  err = vkQueueWaitIdle(ld->graphics);
+  check_err(err, app, NULL, NULL)
+
+  FREEME(app, NULL)
+} END_TEST;
+
 Suite *vulkan_suite(void) {
   Suite *s = NULL;
   TCase *tc_core = NULL;
@@ -183,6 +865,16 @@ Suite *vulkan_suite(void) {
   tcase_add_test(tc_core, test_create_instance);
   tcase_add_test(tc_core, test_enumerate_device);
   tcase_add_test(tc_core, test_set_logical_device);
+  tcase_add_test(tc_core, test_device_mem_suballoc);
+  tcase_add_test(tc_core, test_async_upload);
+  tcase_add_test(tc_core, test_batched_upload);
+  tcase_add_test(tc_core, test_aliased_images);
+  tcase_add_test(tc_core, test_instance_stream);
+  tcase_add_test(tc_core, test_render_graph);
+  tcase_add_test(tc_core, test_timeline_submit);
+  tcase_add_test(tc_core, test_pipeline_dedup);
+  tcase_add_test(tc_core, test_frame_pool);
+  tcase_add_test(tc_core, test_one_shot_recycle);
   suite_add_tcase(s, tc_core);
 
   return s;